@@ -26,13 +26,15 @@
 #include <vector>
 
 #include "basictypes.hpp"
+#include "channelregistry.hpp"
 #include "constants.hpp"
 #include "datastore.hpp"
 #include "utilities.hpp"
 #include "outputsocket.hpp"
+#include "recordframing.hpp"
 
 
-#define CAP_LOG_DEFAULT_CHANNEL 0
+#define CAP_LOG_DEFAULT_CHANNEL CAP::CHANNEL::channelIdFromName("DEFAULT")
 
 namespace CAP {
 
@@ -41,14 +43,14 @@ namespace Impl{
 struct PrintPrefix {
     unsigned int processId;
     unsigned int threadId;
-    unsigned int channelId;
+    uint32_t channelId;
 };
 
 inline std::ostream& operator<<(std::ostream& os, const PrintPrefix& printPrefix) {
     os << CAP_MAIN_PREFIX_DELIMITER << INSERT_THREAD_ID << " : "
        << CAP_PROCESS_ID_DELIMITER << printPrefix.processId << " " << CAP_THREAD_ID_DELIMITER
-       << printPrefix.threadId << " " << CAP_CHANNEL_ID_DELIMITER << std::setw(3)
-       << std::setfill('0') << printPrefix.channelId << " ";
+       << printPrefix.threadId << " " << CAP_CHANNEL_ID_DELIMITER
+       << CHANNEL::ChannelIdFormat{printPrefix.channelId} << " ";
     return os;
 }
 
@@ -63,59 +65,85 @@ inline std::ostream& operator<<(std::ostream& os, const TabDelims& tabDelims) {
     return os;
 }
 
-inline void writeOutput(const std::string& messageBuffer, unsigned int processId, unsigned int threadId,
-                 unsigned int channelId, unsigned int depth) {
-    // Note: newline characters are inconsistently required in different loggers, so we don't count
-    // as part of the line length and instead just added a bit of padding to the max chars for the
-    // cases where it's needed.
-    std::stringstream completeOutputStream;
-    completeOutputStream << PrintPrefix{processId, threadId, channelId} << TabDelims{depth}
-                         << messageBuffer;
-    size_t outputStringSize = (size_t) completeOutputStream.tellp();
-
-    size_t log_line_character_limit =
-                 (size_t) CAP::OutputModeToLogLineCharLimit[static_cast<int>(CAP::DefaultOutputMode)];
-    if (outputStringSize < log_line_character_limit) {
-        completeOutputStream
-                << CAP::OutputModeToNewLineChar[static_cast<int>(CAP::DefaultOutputMode)];
-        PRINT_TO_LOG(completeOutputStream.str().c_str());
+// Writes one formatted line to a single output, using that output's line framing.
+// line is shared between all the outputs a channel writes to and always ends in "\n".
+template <OutputMode mode>
+inline void writeLineToOutput(const std::string& line, const PrintPrefix& printPrefix) {
+    constexpr const LineFraming lineFraming = CAP::OutputModeToLineFraming[static_cast<int>(mode)];
+    constexpr const char* newLine = CAP::OutputModeToNewLineChar[static_cast<int>(mode)];
+
+    if constexpr (mode == OutputMode::Noop) {
+        return;
+    } else if constexpr (lineFraming == LineFraming::LengthPrefixed) {
+        static_assert(mode == OutputMode::File, "only the file output writes record headers");
+        static_assert(newLine[0] == '\n' && newLine[1] == '\0');
+        std::string recordHeader;
+        RecordFraming::appendRecordHeader(recordHeader, line.size() - 1);
+        FileLogger::writeToOutputFile(recordHeader, line);
+    } else if constexpr (lineFraming == LineFraming::Transport) {
+        static_assert(newLine[0] == '\n' && newLine[1] == '\0');
+        writeToOutput(mode, line);
     } else {
-        std::string completeOutputString = completeOutputStream.str();
+        // Note: newline characters are inconsistently required in different loggers, so we don't
+        // count as part of the line length and instead just added a bit of padding to the max
+        // chars for the cases where it's needed.
+        const std::string_view completeOutputString(line.data(), line.size() - 1);
+        size_t log_line_character_limit =
+                (size_t) CAP::OutputModeToLogLineCharLimit[static_cast<int>(mode)];
+        if (completeOutputString.size() < log_line_character_limit) {
+            writeToOutput(mode, std::string(completeOutputString) + newLine);
+            return;
+        }
+
         std::stringstream concatBeginStream;
-        concatBeginStream << PrintPrefix{processId, threadId, channelId}
-                          << CAP_CONCAT_DELIMITER_BEGIN;
+        concatBeginStream << printPrefix << CAP_CONCAT_DELIMITER_BEGIN;
         const std::string concatBeginString = concatBeginStream.str();
         size_t concatBeginLength = concatBeginString.size();
         size_t substrMax = log_line_character_limit -
                            concatBeginLength;  // TODO don't use 1, use size of newline.
-        std::string currentLine =
-                concatBeginString + completeOutputString.substr(0, substrMax) +
-                CAP::OutputModeToNewLineChar[static_cast<int>(CAP::DefaultOutputMode)];
+        std::string currentLine = concatBeginString +
+                                  std::string(completeOutputString.substr(0, substrMax)) + newLine;
         size_t index = substrMax;
-        PRINT_TO_LOG(currentLine.c_str());
+        writeToOutput(mode, currentLine);
 
         std::stringstream concatContinueStream;
-        concatContinueStream << PrintPrefix{processId, threadId, channelId}
-                             << CAP_CONCAT_DELIMITER_CONTINUE;
+        concatContinueStream << printPrefix << CAP_CONCAT_DELIMITER_CONTINUE;
         const std::string concatContinueString = concatContinueStream.str();
         size_t concatContinueLength = concatContinueString.size();
         assert(concatContinueLength < log_line_character_limit);
         substrMax = log_line_character_limit - concatContinueLength;
         while (index < completeOutputString.size()) {
             std::string appendedLine =
-                    concatContinueString + completeOutputString.substr(index, substrMax) +
-                    CAP::OutputModeToNewLineChar[static_cast<int>(CAP::DefaultOutputMode)];
+                    concatContinueString +
+                    std::string(completeOutputString.substr(index, substrMax)) + newLine;
             index += substrMax;
-            PRINT_TO_LOG(appendedLine.c_str());
+            writeToOutput(mode, appendedLine);
         }
 
         std::stringstream concatEndStream;
-        concatEndStream << PrintPrefix{processId, threadId, channelId} << CAP_CONCAT_DELIMITER_END
-                        << +CAP::OutputModeToNewLineChar[static_cast<int>(CAP::DefaultOutputMode)];
-        const std::string concatEndString = concatEndStream.str();
-        PRINT_TO_LOG(concatEndString.c_str());
+        concatEndStream << printPrefix << CAP_CONCAT_DELIMITER_END << newLine;
+        writeToOutput(mode, concatEndStream.str());
     }
 }
+
+// Formats the line once, then hands the same string to every output in outputSinks.  outputSinks
+// comes from the channel's constexpr sinks, so in the common single sink case this is one bit test
+// per output mode.
+inline void writeOutput(const std::string& messageBuffer, unsigned int processId, unsigned int threadId,
+                 uint32_t channelId, unsigned int depth,
+                 uint32_t outputSinks = DefaultOutputSinks) {
+    const PrintPrefix printPrefix{processId, threadId, channelId};
+    std::stringstream completeOutputStream;
+    completeOutputStream << printPrefix << TabDelims{depth} << messageBuffer << "\n";
+    const std::string line = completeOutputStream.str();
+
+#define OUTPUT_MODE(name, log_line_character_limit, newline_character, function, framing) \
+    if (outputSinks & OutputSink::name##Sink) {                                          \
+        writeLineToOutput<OutputMode::name>(line, printPrefix);                          \
+    }
+    OUTPUT_MODES
+#undef OUTPUT_MODE
+}
 }  // namespace Impl
 
 struct TLSScopeBlock {
@@ -165,16 +193,17 @@ class BlockLogger {
     BlockLogger() = default;
 
     // NOTE: need to always have a default channel
-    BlockLogger(const void* thisPointer, size_t channelId, uint32_t enabledMode, std::string_view fileId,
-                std::string_view processId) 
+    BlockLogger(const void* thisPointer, uint32_t channelId, uint32_t enabledMode, std::string_view fileId,
+                std::string_view processId, uint32_t outputSinks = DefaultOutputSinks)
             : mEnabledMode(enabledMode),
+            mOutputSinks(outputSinks),
             mlogInfoBuffer(),
             mcustomMessageBuffer(),
             mId(0),
             mDepth(0),
             mThreadId(0),
             mProcessId(0),
-            mChannel((unsigned int)channelId),
+            mChannel(channelId),
             mThisPointer(thisPointer) {
         if (mEnabledMode & CAN_WRITE_TO_OUTPUT) {
             tlsScopeStack_ = &CAP::TLSScopeStack::getThreadLocalInstance();
@@ -197,7 +226,7 @@ class BlockLogger {
             std::stringstream ss;
             ss << CAP_PRIMARY_LOG_END_DELIMITER << " " << mId 
                << mlogInfoBuffer << " " << mThisPointer;
-            Impl::writeOutput(ss.str(), mProcessId, mThreadId, mChannel, mDepth);
+            Impl::writeOutput(ss.str(), mProcessId, mThreadId, mChannel, mDepth, mOutputSinks);
 
             if (tlsScopeStack_ != nullptr) {
                 tlsScopeStack_->blocks.pop();
@@ -218,7 +247,7 @@ class BlockLogger {
             ss << CAP_PRIMARY_LOG_BEGIN_DELIMITER
             << " " << mId << mlogInfoBuffer << " "
             << mThisPointer;
-            Impl::writeOutput(ss.str(), mProcessId, mThreadId, mChannel, mDepth);
+            Impl::writeOutput(ss.str(), mProcessId, mThreadId, mChannel, mDepth, mOutputSinks);
 
             // The macro which calls this hardcodes a " " to get around some macro limitations regarding
             // zero/1/multi argument __VA_ARGS__
@@ -231,12 +260,21 @@ class BlockLogger {
     void dumpToFile(int line, std::string_view filename, const void* pointerToBuffer,
                     size_t numberOfBytes) {
         if (mEnabledMode & CAN_WRITE_TO_OUTPUT) {
+            // The dump itself goes straight to the output; only this small index record goes
+            // through the text path.
+            std::optional<uint64_t> dumpFileOffset =
+                    writeToBinaryFile(mOutputSinks, filename, pointerToBuffer, numberOfBytes);
+
             std::stringstream ss;
             ss << CAP_ADD_LOG_DELIMITER << CAP_ADD_LOG_SECOND_DELIMITER
             << " " << mId << " " << "[" << line
             << "] LOG: DUMP_TO_FILE | filename: [" << filename << "] | pointerToBuffer: ["
             << pointerToBuffer << "] | numberOfBytes: [" << numberOfBytes << "]";
 
+            if (dumpFileOffset) {
+                ss << " | fileOffset: [" << *dumpFileOffset << "]";
+            }
+
             // TODO: use this after introducing file dump type
             // ss << CAP_ADD_FILEDUMP_DELIMITER <<
             // CAP_ADD_FILEDUMP_SECOND_DELIMITER << " " << mId << " "
@@ -244,9 +282,7 @@ class BlockLogger {
             // << "] | pointerToBuffer: [" << pointerToBuffer << "] | numberOfBytes: [" << numberOfBytes
             // << "]";
 
-            Impl::writeOutput(ss.str(), mProcessId, mThreadId, mChannel, mDepth);
-
-            PRINT_TO_BINARY_FILE(filename, pointerToBuffer, numberOfBytes);
+            Impl::writeOutput(ss.str(), mProcessId, mThreadId, mChannel, mDepth, mOutputSinks);
         }
     }
 
@@ -263,7 +299,7 @@ class BlockLogger {
                 ss << messageBuffer.substr(0, CAP::LogAbsoluteCharacterLimitForUserLog);
             }
 
-            Impl::writeOutput(ss.str(), mProcessId, mThreadId, mChannel, mDepth);
+            Impl::writeOutput(ss.str(), mProcessId, mThreadId, mChannel, mDepth, mOutputSinks);
         }
     }
 
@@ -273,7 +309,7 @@ class BlockLogger {
             ss << CAP_ADD_LOG_DELIMITER << CAP_ADD_LOG_SECOND_DELIMITER
             << " " << mId << " " << "["
             << line << "] " << "ERROR: " << messageBuffer;
-            Impl::writeOutput(ss.str(), mProcessId, mThreadId, mChannel, mDepth);
+            Impl::writeOutput(ss.str(), mProcessId, mThreadId, mChannel, mDepth, mOutputSinks);
         }
     }
 
@@ -324,7 +360,7 @@ class BlockLogger {
             << line << "] "
             << "PRINTING ALL STATE IN STORE: StoreKey='"
             << to_string(key);
-            Impl::writeOutput(ss.str(), mProcessId, mThreadId, mChannel, mDepth);
+            Impl::writeOutput(ss.str(), mProcessId, mThreadId, mChannel, mDepth, mOutputSinks);
 
             for (const auto& row : allStates) {
                 printStateImpl(line, "PRINT STATE", to_string(key), row.first, row.second);
@@ -359,7 +395,7 @@ class BlockLogger {
             << line << "] "
             << "RELEASE ALL STATE IN STORE: StoreKey='"
             << to_string(key) << "' NumDeleted='" << deletedCount << "'";
-            Impl::writeOutput(ss.str(), mProcessId, mThreadId, mChannel, mDepth);
+            Impl::writeOutput(ss.str(), mProcessId, mThreadId, mChannel, mDepth, mOutputSinks);
         }
     }
 
@@ -371,7 +407,7 @@ class BlockLogger {
            << " " << mId << " [" << line << "] " << logCommand << ": "
            << "StoreKey='" << storeKey << "' : StateName='" << varName << "' : Value='"
            << value.value_or("N/A") << "'";
-        Impl::writeOutput(ss.str(), mProcessId, mThreadId, mChannel, mDepth);
+        Impl::writeOutput(ss.str(), mProcessId, mThreadId, mChannel, mDepth, mOutputSinks);
     }
 
     TLSScopeStack* tlsScopeStack_ = nullptr;
@@ -379,13 +415,14 @@ class BlockLogger {
     std::string_view functionId_;
 
     const uint32_t mEnabledMode = FULLY_DISABLED;
+    const uint32_t mOutputSinks = DefaultOutputSinks;
     std::string mlogInfoBuffer;
     std::string mcustomMessageBuffer;
     unsigned int mId;
     unsigned int mDepth;
     unsigned int mThreadId;
     unsigned int mProcessId;
-    unsigned int mChannel;
+    uint32_t mChannel;
     const void* mThisPointer;
 }; 
 
@@ -52,9 +52,9 @@ want to branch if __VA_ARGS__ is empty and call setPrimaryLog without passing it
   [[maybe_unused]] constexpr bool channelCompileNotDisabled = CAP_CHANNEL(channel)::enableMode(); \
   [[maybe_unused]] constexpr bool channelCompileEnabledOutput = CAP_CHANNEL(channel)::enableMode() & CAP::CAN_WRITE_TO_OUTPUT; \
   [[maybe_unused]] constexpr bool channelCompileEnabledState = CAP_CHANNEL(channel)::enableMode() & CAP::CAN_WRITE_TO_STATE; \
-  [[maybe_unused]] const size_t channelId = CAP_CHANNEL(channel)::id(); \
+  [[maybe_unused]] constexpr uint32_t channelId = CAP_CHANNEL(channel)::id(); \
   CAP::BlockLogger blockScopeLog = channelCompileNotDisabled \
-    ? CAP::BlockLogger{pointer, channelId, CAP_CHANNEL_OUTPUT_MODE(channel), __CAP_FILENAME__, __PRETTY_FUNCTION__} \
+    ? CAP::BlockLogger{pointer, channelId, CAP_CHANNEL_OUTPUT_MODE(channel), __CAP_FILENAME__, __PRETTY_FUNCTION__, CAP_CHANNEL_OUTPUT_SINKS(channel)} \
     : CAP::BlockLogger{}; \
   CAP::BlockLogger* blockScope = &blockScopeLog; \
   PRAGMA_IGNORE_SHADOW_END                                                                  \
@@ -261,5 +261,6 @@ want to branch if __VA_ARGS__ is empty and call setPrimaryLog without passing it
 
 #define DEFINE_CAP_LOG_CHANNEL(...)
 #define DEFINE_CAP_LOG_CHANNEL_CHILD(...)
+#define DEFINE_CAP_LOG_CHANNEL_WITH_SINKS(...)
 
 #endif // ENABLE_CAP_LOGGER_IMPL
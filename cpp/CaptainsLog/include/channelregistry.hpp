@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "basictypes.hpp"
+#include "constants.hpp"
+#include "output.hpp"
+#include "utilities.hpp"
+
+namespace CAP::CHANNEL {
+
+/// @brief Channel ids are a hash of the channel name (32 bit FNV-1a), so they're the same in every
+/// process and every run, and they're known at compile time.
+constexpr uint32_t channelIdFromName(std::string_view channelName) {
+    uint32_t hash = 2166136261u;
+    for (char c : channelName) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/// @brief Every line prints the channel id like this; the channel table uses the same format so
+/// the two can be matched up.
+struct ChannelIdFormat {
+    uint32_t channelId;
+};
+
+inline std::ostream& operator<<(std::ostream& os, const ChannelIdFormat& channelIdFormat) {
+    os << std::hex << std::setw(8) << std::setfill('0') << channelIdFormat.channelId << std::dec;
+    return os;
+}
+
+inline void printChannel(std::stringstream& ss, unsigned int processId, unsigned int threadId,
+                         unsigned int depth, uint32_t channelId, std::string_view channelName,
+                         uint32_t enabledMode, int verbosityLevel) {
+
+    ss << CAP_MAIN_PREFIX_DELIMITER << INSERT_THREAD_ID << " : "
+       << CAP_PROCESS_ID_DELIMITER << processId << " " << CAP_THREAD_ID_DELIMITER
+       << threadId
+       << " CHANNEL-ID=" << ChannelIdFormat{channelId};
+
+    if (enabledMode == FULLY_ENABLED) {
+        ss << " : FULLY ENABLED        ";
+    } else if (enabledMode == ENABLED_NO_OUTPUT) {
+        ss << " : ENABLED BUT NO OUTPUT";
+    } else if (enabledMode == FULLY_DISABLED) {
+        ss << " : FULLY DISABLED       ";
+    } else {
+        ss << " : UNKNOWN MODE!        ";
+    }
+
+    ss << " : VERBOSITY=" << verbosityLevel << " : ";
+
+    for (unsigned int i = 0; i < depth; ++i) {
+        ss << ">  ";
+    }
+
+    ss << channelName << CAP::OutputModeToNewLineChar[static_cast<int>(CAP::DefaultOutputMode)];
+}
+
+/// @brief Every channel defined with DEFINE_CAP_LOG_CHANNEL* registers itself here during static
+/// initialization.  This is where id collisions are caught, and it's what the channel table
+/// printed at startup is built from.
+class ChannelRegistry {
+  public:
+    struct ChannelInfo {
+        uint32_t channelId;
+        std::string_view channelName;
+        uint32_t enabledMode;
+        int verbosityLevel;
+        unsigned int depth;
+    };
+
+    static bool registerChannel(const ChannelInfo& channelInfo) {
+        ChannelRegistry& registry = getInstance();
+        const std::lock_guard<std::mutex> guard(registry.mMut);
+        for (const auto& registeredChannel : registry.mChannels) {
+            if (registeredChannel.channelId != channelInfo.channelId) {
+                continue;
+            }
+
+            // the same channel seen again (eg. from a second copy of a dynamic lib) is fine.
+            if (registeredChannel.channelName != channelInfo.channelName) {
+                writeToPlatformOut("CAPLOG: Channel id collision.  Rename one of: [" +
+                                   std::string(registeredChannel.channelName) + "] [" +
+                                   std::string(channelInfo.channelName) + "]\n");
+                assert(false && "caplog channel id collision");
+            }
+            return false;
+        }
+
+        registry.mChannels.push_back(channelInfo);
+        return true;
+    }
+
+    /// @brief Copy of the registered channels, in registration order.
+    static std::vector<ChannelInfo> getChannels() {
+        ChannelRegistry& registry = getInstance();
+        const std::lock_guard<std::mutex> guard(registry.mMut);
+        return registry.mChannels;
+    }
+
+  private:
+    static ChannelRegistry& getInstance() {
+        static ChannelRegistry registry;
+        return registry;
+    }
+
+    std::mutex mMut;
+    std::vector<ChannelInfo> mChannels;
+};
+
+}  // namespace CAP::CHANNEL
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <algorithm>
+
 #include "basictypes.hpp"
+#include "channelregistry.hpp"
 #include "constants.hpp"
 #include "output.hpp"
 #include "utilities.hpp"
@@ -21,32 +24,51 @@
 // Public macros
 // (... params are a list of parent channels that are AND'd together then AND'd with this channel)
 // Example, if parent is disabled but this channel is enabled, final result will also be disabled.
+// The channel writes to the same outputs (sinks) as its parents.
 #define DEFINE_CAP_LOG_CHANNEL(channelname, verboseLevel, enabledMode, ...) \
 DEFINE_CAP_LOG_CHANNEL_CHILD_IMPL(channelname, verboseLevel, CAP::ChannelEnabledMode:: enabledMode, CHANNEL_ROOT_ALL_LOGS CAP_VA_ARGS(__VA_ARGS__))
 
+// Same as DEFINE_CAP_LOG_CHANNEL, but the channel (and children that don't override it) write to
+// outputSinks instead of the parents' sinks.  outputSinks is a CAP::OutputSink mask, eg.
+//   DEFINE_CAP_LOG_CHANNEL_WITH_SINKS(RENDER_FRAME_TIMES, 5, FULLY_ENABLED, FlightRecorderSink, RENDER)
+// It's a compile time constant; nothing is looked up when a log is written.
+// outputSinks has to be part of CAP::ProcessOutputSinks (eg. -DCAPLOG_ADDITIONAL_OUTPUT_SINKS),
+// or the sink never gets the process lines and channel table its output needs to be read.
+#define DEFINE_CAP_LOG_CHANNEL_WITH_SINKS(channelname, verboseLevel, enabledMode, outputSinks, ...) \
+DEFINE_CAP_LOG_CHANNEL_CHILD_WITH_SINKS_IMPL(channelname, verboseLevel, CAP::ChannelEnabledMode:: enabledMode, outputSinks, CHANNEL_ROOT_ALL_LOGS CAP_VA_ARGS(__VA_ARGS__))
+
 ////////////////
 // Implementation Details
 #define CHANNEL_OUTPUT_MODE_AND(...) channelOutputModeAnd<__VA_ARGS__>()
+#define CHANNEL_OUTPUT_SINKS_OR(...) channelOutputSinksOr<__VA_ARGS__>()
+#define CHANNEL_DEPTH(...) channelDepthFromParents<__VA_ARGS__>()
 
-#define DEFINE_CAP_LOG_CHANNEL_IMPL(channelname, verboseLevel, enabledMode, overrideMode) \
+#define DEFINE_CAP_LOG_CHANNEL_IMPL(channelname, verboseLevel, enabledMode, overrideMode, outputSinks) \
 namespace CAP::CHANNEL { \
 constexpr const std::string_view channelname {#channelname}; \
-DEFINE_CAP_LOG_CHANNEL_CHILD_FROM_CONSTEXPR_STRINGVIEW_IMPL(channelname, verboseLevel, enabledMode, overrideMode) \
+DEFINE_CAP_LOG_CHANNEL_CHILD_FROM_CONSTEXPR_STRINGVIEW_IMPL(channelname, verboseLevel, enabledMode, overrideMode, outputSinks, 0) \
 }
 
 #define DEFINE_CAP_LOG_CHANNEL_CHILD_IMPL(channelname, verboseLevel, enabledMode, ...) \
 namespace CAP::CHANNEL { \
 constexpr const std::string_view channelname {#channelname}; \
-DEFINE_CAP_LOG_CHANNEL_CHILD_FROM_CONSTEXPR_STRINGVIEW_IMPL(channelname, verboseLevel, enabledMode, CHANNEL_OUTPUT_MODE_AND(__VA_ARGS__)) \
+DEFINE_CAP_LOG_CHANNEL_CHILD_FROM_CONSTEXPR_STRINGVIEW_IMPL(channelname, verboseLevel, enabledMode, CHANNEL_OUTPUT_MODE_AND(__VA_ARGS__), CHANNEL_OUTPUT_SINKS_OR(__VA_ARGS__), CHANNEL_DEPTH(__VA_ARGS__)) \
+}
+
+#define DEFINE_CAP_LOG_CHANNEL_CHILD_WITH_SINKS_IMPL(channelname, verboseLevel, enabledMode, outputSinks, ...) \
+namespace CAP::CHANNEL { \
+static_assert(((outputSinks) & ~CAP::ProcessOutputSinks) == 0, \
+  #channelname " is routed to a sink that doesn't get the process lines; add it to CAPLOG_ADDITIONAL_OUTPUT_SINKS"); \
+constexpr const std::string_view channelname {#channelname}; \
+DEFINE_CAP_LOG_CHANNEL_CHILD_FROM_CONSTEXPR_STRINGVIEW_IMPL(channelname, verboseLevel, enabledMode, CHANNEL_OUTPUT_MODE_AND(__VA_ARGS__), outputSinks, CHANNEL_DEPTH(__VA_ARGS__)) \
 }
 
 // TODO print once what the mode is in english (eg. enabled || enabled and printing)
-#define DEFINE_CAP_LOG_CHANNEL_CHILD_FROM_CONSTEXPR_STRINGVIEW_IMPL(channelname, verboseLevel, enabledMode, inheritedOutputMode) \
+#define DEFINE_CAP_LOG_CHANNEL_CHILD_FROM_CONSTEXPR_STRINGVIEW_IMPL(channelname, verboseLevel, enabledMode, inheritedOutputMode, channelOutputSinks, channelDepth) \
 template <> \
 struct Channel<CAP::CHANNEL::as_sequence<channelname>::type> { \
-    static size_t id() { \
-      static size_t uniqueID = ChannelID::getNextChannelUniqueID(); \
-      return uniqueID; \
+    constexpr static uint32_t id() { \
+      return channelIdFromName(channelname); \
     } \
     constexpr static uint32_t enableMode() { \
       return ForceEnableAllChannels ? ChannelEnabledMode::FULLY_ENABLED : inheritedOutputMode & enabledMode; \
@@ -54,6 +76,14 @@ struct Channel<CAP::CHANNEL::as_sequence<channelname>::type> { \
     constexpr static int verbosityLevel() { \
       return verboseLevel; \
     } \
+    constexpr static uint32_t outputSinks() { \
+      return channelOutputSinks; \
+    } \
+    constexpr static unsigned int depth() { \
+      return channelDepth; \
+    } \
+    inline static const bool registered = ChannelRegistry::registerChannel( \
+      {id(), channelname, enableMode(), verbosityLevel(), depth()}); \
 };
 
 #define CAP_CHANNEL(channel) \
@@ -62,6 +92,9 @@ CAP::CHANNEL::Channel<CAP::CHANNEL::as_sequence<channel>::type>
 #define CAP_CHANNEL_OUTPUT_MODE(channel) \
 CAP_CHANNEL(channel)::enableMode()
 
+#define CAP_CHANNEL_OUTPUT_SINKS(channel) \
+CAP_CHANNEL(channel)::outputSinks()
+
 namespace CAP::CHANNEL {
 
 #ifdef CAP_LOGGER_FORCE_ALL_CHANNELS_ENABLED_IMPL
@@ -70,13 +103,6 @@ constexpr const bool ForceEnableAllChannels = true;
 constexpr const bool ForceEnableAllChannels = false;
 #endif
 
-struct ChannelID {
-    static size_t getNextChannelUniqueID() {
-        static std::atomic<size_t> currentChannelUniqueID = 0;
-        return currentChannelUniqueID++;
-    }
-};
-
 // struct ChannelPrinter {
 //   ChannelPrinter() {
 //     size_t processTimestampInstanceKey = BlockLoggerDataStore::getCurrentProcessTimestampInstanceKey();
@@ -108,11 +134,11 @@ struct as_sequence<sv, std::index_sequence<II...>> {
 template <char... chars>
 using tstring = std::integer_sequence<char, chars...>;
 
+// Channels that were never defined.  They're always disabled, so the id is never printed.
 template <typename>
 struct Channel {
-  static size_t id() {
-    static size_t uniqueID = ChannelID::getNextChannelUniqueID();
-    return uniqueID;
+  constexpr static uint32_t id() {
+    return 0;
   }
   constexpr static uint32_t enableMode() {
     return ChannelEnabledMode::FULLY_DISABLED;
@@ -120,6 +146,12 @@ struct Channel {
   constexpr static int verbosityLevel() {
     return 0;
   }
+  constexpr static uint32_t outputSinks() {
+    return DefaultOutputSinks;
+  }
+  constexpr static unsigned int depth() {
+    return 0;
+  }
 };
 
 // template<typename... Args>
@@ -128,41 +160,32 @@ constexpr uint32_t channelOutputModeAnd() {
   return (CAP::CHANNEL::Channel<typename CAP::CHANNEL::as_sequence<sv>::type>::enableMode() & ...);
 }
 
-inline void printChannel(std::stringstream& ss, unsigned int processId, unsigned int threadId,
-                         unsigned int depth, unsigned int channelId, std::string_view channelName,
-                         uint32_t enabledMode, int verbosityLevel) {
-
-    ss << CAP_MAIN_PREFIX_DELIMITER << INSERT_THREAD_ID << " : "
-       << CAP_PROCESS_ID_DELIMITER << processId << " " << CAP_THREAD_ID_DELIMITER
-       << threadId
-       << " CHANNEL-ID=" << std::setw(3) << std::setfill('0') << channelId;
-
-    if (enabledMode == FULLY_ENABLED) {
-        ss << " : FULLY ENABLED        ";
-    } else if (enabledMode == ENABLED_NO_OUTPUT) {
-        ss << " : ENABLED BUT NO OUTPUT";
-    } else if (enabledMode == FULLY_DISABLED) {
-        ss << " : FULLY DISABLED       ";
-    } else {
-        ss << " : UNKNOWN MODE!        ";
-    }
-
-    ss << " : VERBOSITY=" << verbosityLevel << " : ";
-
-    for (unsigned int i = 0; i < depth; ++i) {
-        ss << ">  ";
-    }
+// only used to indent the channel table.
+template<const std::string_view& ...sv>
+constexpr unsigned int channelDepthFromParents() {
+  return std::max({CAP::CHANNEL::Channel<typename CAP::CHANNEL::as_sequence<sv>::type>::depth()...}) + 1;
+}
 
-    ss << channelName << CAP::OutputModeToNewLineChar[static_cast<int>(CAP::DefaultOutputMode)];
+// root is the implicit CHANNEL_ROOT_ALL_LOGS parent.  It only contributes its sinks when the channel
+// has no other parents, otherwise a child of a FlightRecorderSink channel would also go to the
+// default output.
+template<const std::string_view& root, const std::string_view& ...sv>
+constexpr uint32_t channelOutputSinksOr() {
+  if constexpr (sizeof...(sv) == 0) {
+    return CAP::CHANNEL::Channel<typename CAP::CHANNEL::as_sequence<root>::type>::outputSinks();
+  } else {
+    return (CAP::CHANNEL::Channel<typename CAP::CHANNEL::as_sequence<sv>::type>::outputSinks() | ...);
+  }
 }
 
 }  // namespace CAP::CHANNEL
 
 // declare the default channels.  We're already in the CAP namespace,
 // so we use the inner "impl" versions.  Root is default enabled.
-DEFINE_CAP_LOG_CHANNEL_IMPL(CHANNEL_ROOT_ALL_LOGS,  0, ChannelEnabledMode::FULLY_ENABLED, CAP_LOGGER_ROOT_CHANNEL_MODE)
+DEFINE_CAP_LOG_CHANNEL_IMPL(CHANNEL_ROOT_ALL_LOGS,  0, ChannelEnabledMode::FULLY_ENABLED, CAP_LOGGER_ROOT_CHANNEL_MODE, DefaultOutputSinks)
 DEFINE_CAP_LOG_CHANNEL_CHILD_IMPL(DEFAULT, 0, ChannelEnabledMode::FULLY_ENABLED, CHANNEL_ROOT_ALL_LOGS)
 DEFINE_CAP_LOG_CHANNEL_CHILD_IMPL(LEGACY, 0, ChannelEnabledMode::FULLY_ENABLED, CHANNEL_ROOT_ALL_LOGS, DEFAULT)
 
 // Error logs are considered to be a different "top level"
-DEFINE_CAP_LOG_CHANNEL_IMPL(CHANNEL_ROOT_ALL_ERRORS,  0, ChannelEnabledMode::FULLY_ENABLED, CAP_LOGGER_ROOT_CHANNEL_MODE)
+// and have their own sinks (see ErrorOutputSinks).
+DEFINE_CAP_LOG_CHANNEL_IMPL(CHANNEL_ROOT_ALL_ERRORS,  0, ChannelEnabledMode::FULLY_ENABLED, CAP_LOGGER_ROOT_CHANNEL_MODE, ErrorOutputSinks)
@@ -0,0 +1,242 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+// Minimal LZ4-compatible block codec.  It has no dependencies outside of the standard library
+// so it can be shared by the logger (compress) and the validator (decompress).
+//
+// The caplog stream is extremely repetitive; every line repeats the
+// "CAP_LOG : P=... T=... C=..." prefix and most repeat a file/function signature, so a single
+// probe greedy matcher is more than enough to get most of the gain.
+//
+// Block format (same as LZ4):
+//   [token][literal length ext...][literals][offset lo][offset hi][match length ext...]
+//   token high nibble = literal length, low nibble = match length - MinMatch.
+//   The last sequence only contains literals.
+
+namespace CAP::Compression {
+
+constexpr const size_t MinMatch = 4;
+// the last LastLiterals bytes are always emitted as literals, and no match may start in the
+// last MatchFindLimit bytes.  Same constraints as LZ4 so the output stays LZ4 compatible.
+constexpr const size_t LastLiterals = 5;
+constexpr const size_t MatchFindLimit = 12;
+constexpr const size_t MaxOffset = 65535;
+constexpr const int HashLog = 12;
+
+inline size_t compressBound(size_t inputSize) {
+    return inputSize + (inputSize / 255) + 16;
+}
+
+// The most a block of compressedSize bytes can decompress to: every byte but the token and offset
+// of the first match is a length extension worth 255 bytes.  A decompressed size above this can't
+// be right, whatever the sender says.
+inline size_t decompressBound(size_t compressedSize) {
+    return compressedSize * 255 + 16;
+}
+
+namespace Impl {
+
+inline uint32_t read32(const char* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline uint32_t hashSequence(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - HashLog);
+}
+
+inline void writeLengthExtension(std::string& out, size_t length) {
+    while (length >= 255) {
+        out.push_back(static_cast<char>(255));
+        length -= 255;
+    }
+    out.push_back(static_cast<char>(length));
+}
+
+inline size_t writeLiterals(std::string& out, const char* literals, size_t literalLength) {
+    size_t tokenIndex = out.size();
+    if (literalLength >= 15) {
+        out.push_back(static_cast<char>(15 << 4));
+        writeLengthExtension(out, literalLength - 15);
+    } else {
+        out.push_back(static_cast<char>(literalLength << 4));
+    }
+    out.append(literals, literalLength);
+    return tokenIndex;
+}
+
+inline void writeMatch(std::string& out, size_t tokenIndex, size_t offset, size_t matchLength) {
+    out.push_back(static_cast<char>(offset & 0xFF));
+    out.push_back(static_cast<char>((offset >> 8) & 0xFF));
+
+    size_t matchCode = matchLength - MinMatch;
+    if (matchCode >= 15) {
+        out[tokenIndex] = static_cast<char>(out[tokenIndex] | 15);
+        writeLengthExtension(out, matchCode - 15);
+    } else {
+        out[tokenIndex] = static_cast<char>(out[tokenIndex] | matchCode);
+    }
+}
+
+}  // namespace Impl
+
+/// @brief Compresses input and appends the compressed block to out.
+/// @param input bytes to compress.
+/// @param out compressed block is appended to this buffer.  Existing content is left untouched.
+inline void compress(std::string_view input, std::string& out) {
+    const char* base = input.data();
+    const size_t inputSize = input.size();
+
+    std::array<uint32_t, (1 << HashLog)> positionTable{};
+
+    size_t anchor = 0;
+    size_t cursor = 0;
+
+    if (inputSize >= MatchFindLimit + MinMatch) {
+        const size_t matchStartLimit = inputSize - MatchFindLimit;
+        const size_t matchEndLimit = inputSize - LastLiterals;
+
+        while (cursor <= matchStartLimit) {
+            const uint32_t sequence = Impl::read32(base + cursor);
+            const uint32_t hash = Impl::hashSequence(sequence);
+            size_t candidate = positionTable[hash];
+            positionTable[hash] = static_cast<uint32_t>(cursor);
+
+            if ((candidate >= cursor) || (cursor - candidate > MaxOffset) ||
+                (Impl::read32(base + candidate) != sequence)) {
+                ++cursor;
+                continue;
+            }
+
+            size_t matchLength = MinMatch;
+            while ((cursor + matchLength < matchEndLimit) &&
+                   (base[candidate + matchLength] == base[cursor + matchLength])) {
+                ++matchLength;
+            }
+
+            // grow the match backwards into pending literals
+            while ((cursor > anchor) && (candidate > 0) &&
+                   (base[cursor - 1] == base[candidate - 1])) {
+                --cursor;
+                --candidate;
+                ++matchLength;
+            }
+
+            size_t tokenIndex = Impl::writeLiterals(out, base + anchor, cursor - anchor);
+            Impl::writeMatch(out, tokenIndex, cursor - candidate, matchLength);
+
+            cursor += matchLength;
+            anchor = cursor;
+
+            // prime the table with the position just before the next search so back to back
+            // repeats (eg. the same prefix on consecutive lines) get picked up.
+            if (cursor - 2 <= matchStartLimit) {
+                positionTable[Impl::hashSequence(Impl::read32(base + cursor - 2))] =
+                        static_cast<uint32_t>(cursor - 2);
+            }
+        }
+    }
+
+    Impl::writeLiterals(out, base + anchor, inputSize - anchor);
+}
+
+/// @brief Decompresses a block produced by compress() and appends it to out.
+/// @param input the compressed block.
+/// @param decompressedSize exact size of the decompressed data.  Must be sent along with the block.
+/// @param out decompressed bytes are appended to this buffer.
+/// @return false if the block is malformed (including a decompressedSize bigger than the block
+/// could decompress to).  out is left unchanged in that case.
+inline bool decompress(std::string_view input, size_t decompressedSize, std::string& out) {
+    if (decompressedSize > decompressBound(input.size())) {
+        return false;
+    }
+
+    const size_t outStart = out.size();
+    out.resize(outStart + decompressedSize);
+    char* dst = out.data() + outStart;
+
+    const unsigned char* src = reinterpret_cast<const unsigned char*>(input.data());
+    const size_t srcSize = input.size();
+
+    size_t srcCursor = 0;
+    size_t dstCursor = 0;
+
+    auto readLengthExtension = [&](size_t& length) -> bool {
+        unsigned char extension = 255;
+        while (extension == 255) {
+            if (srcCursor >= srcSize) {
+                return false;
+            }
+            extension = src[srcCursor++];
+            length += extension;
+        }
+        return true;
+    };
+
+    bool valid = true;
+    while (valid && (srcCursor < srcSize)) {
+        const unsigned char token = src[srcCursor++];
+
+        size_t literalLength = token >> 4;
+        if ((literalLength == 15) && !readLengthExtension(literalLength)) {
+            valid = false;
+            break;
+        }
+
+        if ((srcCursor + literalLength > srcSize) ||
+            (dstCursor + literalLength > decompressedSize)) {
+            valid = false;
+            break;
+        }
+        memcpy(dst + dstCursor, src + srcCursor, literalLength);
+        srcCursor += literalLength;
+        dstCursor += literalLength;
+
+        // last sequence is literals only.
+        if (srcCursor == srcSize) {
+            break;
+        }
+
+        if (srcCursor + 2 > srcSize) {
+            valid = false;
+            break;
+        }
+        const size_t offset = static_cast<size_t>(src[srcCursor]) |
+                              (static_cast<size_t>(src[srcCursor + 1]) << 8);
+        srcCursor += 2;
+
+        size_t matchLength = token & 15;
+        if ((matchLength == 15) && !readLengthExtension(matchLength)) {
+            valid = false;
+            break;
+        }
+        matchLength += MinMatch;
+
+        if ((offset == 0) || (offset > dstCursor) ||
+            (dstCursor + matchLength > decompressedSize)) {
+            valid = false;
+            break;
+        }
+
+        // matches may overlap the bytes they produce (eg. runs), so copy forward byte by byte.
+        const char* matchSrc = dst + dstCursor - offset;
+        for (size_t i = 0; i < matchLength; ++i) {
+            dst[dstCursor + i] = matchSrc[i];
+        }
+        dstCursor += matchLength;
+    }
+
+    if (!valid || (dstCursor != decompressedSize)) {
+        out.resize(outStart);
+        return false;
+    }
+    return true;
+}
+
+}  // namespace CAP::Compression
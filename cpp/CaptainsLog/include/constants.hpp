@@ -14,5 +14,6 @@
 #define CAP_CONCAT_DELIMITER_BEGIN "|+ "
 #define CAP_CONCAT_DELIMITER_CONTINUE "++ "
 #define CAP_CONCAT_DELIMITER_END "+| END"
+#define CAP_RECORD_LENGTH_DELIMITER "#"
 #define CAP_TAB_DELIMITER ":"
 
@@ -1,8 +1,10 @@
 #pragma once
 
+#include "channelregistry.hpp"
 #include "output.hpp"
 #include "utilities.hpp"
 
+#include <atomic>
 #include <vector>
 #include <array>
 
@@ -343,6 +345,11 @@ static BlockLoggerDataStore& getInstance() {
     mProcessTimestampInstanceKey = generateProcessTimestampInstanceKey();
     PRINT_TO_LOG(std::string("Child Forked.  Generating new Process timestamp key") +
                  CAP::OutputModeToNewLineChar[static_cast<int>(CAP::DefaultOutputMode)]);
+
+    // readers key the channel table by process.
+    auto logData = newBlockLoggerInstance();
+    printChannelTable(logData);
+    removeBlockLoggerInstance();
 }
 
   LoggerData newBlockLoggerInstance() {
@@ -416,14 +423,25 @@ static BlockLoggerDataStore& getInstance() {
       auto logData = newBlockLoggerInstance();
 
       // Print the max chars per line
-      std::stringstream ss;
-      printLogLineCharacterLimit(ss, logData.processTimestampInstanceKey);
-      PRINT_TO_LOG(ss.str().c_str());
+      writeLogLineCharacterLimit(CAP::ProcessOutputSinks, logData.processTimestampInstanceKey);
 
+      // Channel ids are a hash of the channel name; this is the only place the names are printed.
+      printChannelTable(logData);
 
       removeBlockLoggerInstance();
     }
 
+    void printChannelTable(const LoggerData& logData) {
+      for (const auto& channel : CHANNEL::ChannelRegistry::getChannels()) {
+        std::stringstream ss;
+        CHANNEL::printChannel(ss, (unsigned int)logData.processTimestampInstanceKey,
+                              (unsigned int)logData.relativeThreadIdx, channel.depth,
+                              channel.channelId, channel.channelName, channel.enabledMode,
+                              channel.verbosityLevel);
+        PRINT_TO_LOG(ss.str());
+      }
+    }
+
     size_t generateProcessTimestampInstanceKey() {
       return generatePidTimestampKey() ^ (uintptr_t)(void*)this;
     }
@@ -1,13 +1,16 @@
 #pragma once
 
 #include "outputfile.hpp"
+#include "outputflightrecorder.hpp"
 #include "outputsocket.hpp"
 #include "outputstdout.hpp"
 #include "utilities.hpp"
 
-#define PRINT_TO_LOG(outputString) CAP::writeToOutput(CAP::DefaultOutputMode, outputString)
+// Process level lines (version, new process, new thread...) go to every sink a channel could be
+// routed to so that each output can be read on its own.
+#define PRINT_TO_LOG(outputString) CAP::writeToOutputSinks(CAP::ProcessOutputSinks, outputString)
 #define PRINT_TO_BINARY_FILE(filename, pointerToBuffer, numberOfBytes) \
-    CAP::writeToBinaryFile(CAP::DefaultOutputMode, filename, pointerToBuffer, numberOfBytes);
+    CAP::writeToBinaryFile(CAP::DefaultOutputSinks, filename, pointerToBuffer, numberOfBytes)
 
 // Reference for getting the default newline char/string:
 //   CAP::OutputModeToNewLineChar[static_cast<int>(CAP::DefaultOutputMode)];
@@ -26,27 +29,42 @@ constexpr const int pipe_size = PIPE_BUF;
 constexpr const int pipe_size = 4096;
 #endif
 
+// How a line longer than log_line_character_limit gets to the output.
+enum class LineFraming {
+    // split into CONCAT pieces that the readers stitch back together.
+    Split,
+    // written in one piece with a length prefix; see recordframing.hpp.  The limit is ignored.
+    LengthPrefixed,
+    // written in one piece; the transport already carries the length of each write.  The limit
+    // is ignored.
+    Transport,
+};
+
 // 1 - enum
-// 3 - log_line_character_limit
+// 2 - log_line_character_limit
 // 3 - newline character
 // 4 - function to alias for text output
-#define OUTPUT_MODES                                                      \
-    OUTPUT_MODE(StandardOut, 100000, "\n", writeToStandardOut)            \
-    OUTPUT_MODE(Logcat, 150, "", writeToLogcat)                           \
-    OUTPUT_MODE(File, pipe_size - 4, "\n", FileLogger::writeToOutputFile) \
-    OUTPUT_MODE(Socket, 1000, "\n", SocketLogger::writeToSocket)          \
-    OUTPUT_MODE(Noop, 100000, "", noop)
+// 5 - line framing
+#define OUTPUT_MODES                                                                          \
+    OUTPUT_MODE(StandardOut, 100000, "\n", writeToStandardOut, LineFraming::Split)            \
+    OUTPUT_MODE(Logcat, 150, "", writeToLogcat, LineFraming::Split)                           \
+    OUTPUT_MODE(File, pipe_size - 4, "\n", FileLogger::writeToOutputFile,                     \
+                LineFraming::LengthPrefixed)                                                  \
+    OUTPUT_MODE(Socket, 1000, "\n", SocketLogger::writeToSocket, LineFraming::Transport)      \
+    OUTPUT_MODE(Noop, 100000, "", noop, LineFraming::Split)                                   \
+    OUTPUT_MODE(FlightRecorder, 100000, "\n", FlightRecorder::writeToFlightRecorder,           \
+                LineFraming::Transport)
 
 inline void noop(const std::string&) {}
 
 enum class OutputMode {
-#define OUTPUT_MODE(name, log_line_character_limit, newline_character, function) name,
+#define OUTPUT_MODE(name, log_line_character_limit, newline_character, function, framing) name,
     OUTPUT_MODES
 #undef OUTPUT_MODE
 };
 
 constexpr const char* OutputModeToString[] = {
-#define OUTPUT_MODE(name, log_line_character_limit, newline_character, function) #name,
+#define OUTPUT_MODE(name, log_line_character_limit, newline_character, function, framing) #name,
         OUTPUT_MODES
 #undef OUTPUT_MODE
 };
@@ -56,21 +74,37 @@ constexpr const char* OutputModeToString[] = {
 // So to be safe, we scale back our log_line_character_limit max a bit to account for an optional
 // newline that we might need to insert.
 constexpr const int OutputModeToLogLineCharLimit[] = {
-#define OUTPUT_MODE(name, log_line_character_limit, newline_character, function) \
+#define OUTPUT_MODE(name, log_line_character_limit, newline_character, function, framing) \
     log_line_character_limit,
         OUTPUT_MODES
 #undef OUTPUT_MODE
 };
 
+constexpr const LineFraming OutputModeToLineFraming[] = {
+#define OUTPUT_MODE(name, log_line_character_limit, newline_character, function, framing) framing,
+        OUTPUT_MODES
+#undef OUTPUT_MODE
+};
+
 constexpr const char* OutputModeToNewLineChar[] = {
-#define OUTPUT_MODE(name, log_line_character_limit, newline_character, function) newline_character,
+#define OUTPUT_MODE(name, log_line_character_limit, newline_character, function, framing) newline_character,
         OUTPUT_MODES
 #undef OUTPUT_MODE
 };
 
+// A channel can write to several outputs at once.  Its sinks are a bitmask of these, resolved at
+// compile time when the channel is defined (see DEFINE_CAP_LOG_CHANNEL_WITH_SINKS).
+// eg. FileSink | SocketSink
+enum OutputSink : uint32_t {
+#define OUTPUT_MODE(name, log_line_character_limit, newline_character, function, framing) \
+    name##Sink = 1u << static_cast<uint32_t>(OutputMode::name),
+    OUTPUT_MODES
+#undef OUTPUT_MODE
+};
+
 inline void writeToOutput(OutputMode mode, const std::string& output) {
     switch (mode) {
-#define OUTPUT_MODE(name, log_line_character_limit, newline_character, function) \
+#define OUTPUT_MODE(name, log_line_character_limit, newline_character, function, framing) \
     case OutputMode::name:                                                       \
         function(output);                                                        \
         break;
@@ -81,31 +115,85 @@ inline void writeToOutput(OutputMode mode, const std::string& output) {
     }
 }
 
-inline void writeToBinaryFile(OutputMode mode, std::string_view filename,
-                              const void* pointerToBuffer, size_t numberOfBytes) {
-    // only currently supported for socket output mode
-    if (mode == OutputMode::Socket) {
+inline void writeToOutputSinks(uint32_t outputSinks, const std::string& output) {
+#define OUTPUT_MODE(name, log_line_character_limit, newline_character, function, framing) \
+    if (outputSinks & OutputSink::name##Sink) {                                          \
+        function(output);                                                                \
+    }
+    OUTPUT_MODES
+#undef OUTPUT_MODE
+}
+
+// Returns the offset of the dump within its file when it's written locally (File sink).
+// Only the Socket and File sinks support binary dumps; other sinks are skipped.
+inline std::optional<uint64_t> writeToBinaryFile(uint32_t outputSinks, std::string_view filename,
+                                                 const void* pointerToBuffer,
+                                                 size_t numberOfBytes) {
+    std::optional<uint64_t> fileOffset;
+    if (outputSinks & OutputSink::SocketSink) {
         SocketLogger::writeBinaryStreamToSocket(filename, pointerToBuffer, numberOfBytes);
     }
+    if (outputSinks & OutputSink::FileSink) {
+        fileOffset = FileLogger::writeBinaryFile(filename, pointerToBuffer, numberOfBytes);
+    }
+    return fileOffset;
 }
 
 // make sure that none of the log line limits are smaller than 100, of the'll format poorly.
-#define OUTPUT_MODE(name, log_line_character_limit, newline_character, function) \
+#define OUTPUT_MODE(name, log_line_character_limit, newline_character, function, framing) \
     static_assert(log_line_character_limit >= 100, "log_line_character_limit must be >= 100");
 OUTPUT_MODES
 #undef OUTPUT_MODE
 
-#ifdef CAPLOG_SOCKET_ENABLED
+// eg. -DCAPLOG_DEFAULT_OUTPUT_MODE=File
+#ifdef CAPLOG_DEFAULT_OUTPUT_MODE
+constexpr const OutputMode DefaultOutputMode = OutputMode::CAPLOG_DEFAULT_OUTPUT_MODE;
+#elif defined(CAPLOG_SOCKET_ENABLED)
 constexpr const OutputMode DefaultOutputMode = OutputMode::Socket;
 #else
 constexpr const OutputMode DefaultOutputMode = OutputMode::StandardOut;
 #endif
 
-inline void printLogLineCharacterLimit(std::stringstream& ss, size_t processId) {
+// Channels that don't name their sinks inherit them from their parents (OR'd together).  The
+// roots default to DefaultOutputMode.
+constexpr const uint32_t DefaultOutputSinks = 1u << static_cast<uint32_t>(DefaultOutputMode);
+
+// Sinks for CHANNEL_ROOT_ALL_ERRORS and its children.  eg.
+// -DCAPLOG_ERROR_OUTPUT_SINKS="DefaultOutputSinks|FileSink" to keep a local copy of errors.
+#ifdef CAPLOG_ERROR_OUTPUT_SINKS
+constexpr const uint32_t ErrorOutputSinks = CAPLOG_ERROR_OUTPUT_SINKS;
+#else
+constexpr const uint32_t ErrorOutputSinks = DefaultOutputSinks;
+#endif
+
+// Any other sinks that channels are routed to with DEFINE_CAP_LOG_CHANNEL_WITH_SINKS; these also
+// receive the process level lines.  eg. -DCAPLOG_ADDITIONAL_OUTPUT_SINKS=FlightRecorderSink
+#ifdef CAPLOG_ADDITIONAL_OUTPUT_SINKS
+constexpr const uint32_t AdditionalOutputSinks = CAPLOG_ADDITIONAL_OUTPUT_SINKS;
+#else
+constexpr const uint32_t AdditionalOutputSinks = 0;
+#endif
+
+constexpr const uint32_t ProcessOutputSinks =
+        DefaultOutputSinks | ErrorOutputSinks | AdditionalOutputSinks;
+
+inline void printLogLineCharacterLimit(std::stringstream& ss, OutputMode mode, size_t processId) {
     ss << CAP_MAIN_PREFIX_DELIMITER << INSERT_THREAD_ID << " : "
        << CAP_PROCESS_ID_DELIMITER << processId << " " << CAP_MAX_CHAR_SIZE_DELIMITER
-       << CAP::OutputModeToLogLineCharLimit[static_cast<int>(CAP::DefaultOutputMode)]
-       << CAP::OutputModeToNewLineChar[static_cast<int>(CAP::DefaultOutputMode)];
+       << CAP::OutputModeToLogLineCharLimit[static_cast<int>(mode)]
+       << CAP::OutputModeToNewLineChar[static_cast<int>(mode)];
+}
+
+// Each sink splits lines at its own limit, so each one is told its own.
+inline void writeLogLineCharacterLimit(uint32_t outputSinks, size_t processId) {
+#define OUTPUT_MODE(name, log_line_character_limit, newline_character, function, framing) \
+    if (outputSinks & OutputSink::name##Sink) {                                          \
+        std::stringstream ss;                                                            \
+        printLogLineCharacterLimit(ss, OutputMode::name, processId);                     \
+        function(ss.str());                                                              \
+    }
+    OUTPUT_MODES
+#undef OUTPUT_MODE
 }
 
 }  // namespace CAP
@@ -1,6 +1,30 @@
 #pragma once
 
+#if defined LINUX || defined(__linux__) || defined ANDROID || defined __ANDROID__ || \
+        defined APPLE || defined __APPLE__
+#define CAPLOG_FILE_DUMP_POSIX
+#endif
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#ifdef CAPLOG_FILE_DUMP_POSIX
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <filesystem>
+#endif
+
 #include "outputstdout.hpp"
+#include "utilities.hpp"
 
 namespace CAP {
 
@@ -11,16 +35,45 @@ constexpr const char* outputFileName = CAPTAINS_LOG_STRINGIFY(CAPLOGGER_LOG_TO_F
 constexpr const char* outputFileName = "captains_log.clog";
 #endif
 
+// Binary dumps (CAP_DUMP_TO_FILE) are written to a sidecar directory next to the log file; eg.
+// "captains_log.clog.dumps/".  Dumps to the same filename are appended, matching what the
+// validator does for socket dumps.
+constexpr const char* outputDumpDirectorySuffix = ".dumps";
+
 class FileLogger {
   public:
-    static void writeToOutputFile(const std::string& output) {
+    static FileLogger& getFileLogger() {
         static FileLogger logger;
+        return logger;
+    }
+
+    static void writeToOutputFile(const std::string& output) {
+        writeToOutputFile(std::string_view{}, output);
+    }
+
+    // header and record are written back to back without anything from another thread between
+    // them.  Lets a record that's shared with other outputs be written without copying it.
+    static void writeToOutputFile(std::string_view header, std::string_view record) {
+        FileLogger& logger = getFileLogger();
         if (logger.pFile != nullptr) {
-            fprintf(logger.pFile, "%s", output.c_str());
+            const std::lock_guard<std::mutex> guard(logger.mWriteMut);
+            fwrite(header.data(), 1, header.size(), logger.pFile);
+            fwrite(record.data(), 1, record.size(), logger.pFile);
             fflush(logger.pFile);
         }
     }
 
+    // Writes the buffer as-is to the dump directory under filename.  The buffer never goes through the
+    // text formatting path; the space is reserved up front and the bytes are written straight
+    // from the caller's buffer with pwrite, so concurrent dumps don't serialize on the write.
+    // The space is reserved in the file itself, so other processes logging to the same file
+    // (including forked children) get their own.
+    // Returns the offset of this dump within the file, or std::nullopt if it failed.
+    static std::optional<uint64_t> writeBinaryFile(std::string_view filename, const void* buffer,
+                                                   size_t numberOfBytes) {
+        return getFileLogger().writeDump(filename, buffer, numberOfBytes);
+    }
+
   private:
     FileLogger() {
         writeToPlatformOut(std::string("Opening CAPLOG log file: ") + outputFileName + "\n");
@@ -34,9 +87,213 @@ class FileLogger {
         }
     }
 
-    ~FileLogger() { fclose(pFile); }
+    ~FileLogger() {
+        if (pFile != nullptr) {
+            fclose(pFile);
+        }
+#ifdef CAPLOG_FILE_DUMP_POSIX
+        for (auto& [filename, dumpFile] : mDumpFiles) {
+            close(dumpFile.fd);
+        }
+#endif
+    }
+
+    static std::string dumpDirectory() {
+        return std::string(outputFileName) + outputDumpDirectorySuffix;
+    }
+
+#ifdef CAPLOG_FILE_DUMP_POSIX
+    // Dump files are kept open between dumps, at most this many at a time (dumps are often to a
+    // new file each time, eg. one per frame), closing the least recently used one to make room.
+    static constexpr size_t maxOpenDumpFiles = 32;
+
+    struct DumpFile {
+        int fd = -1;
+        // dumps being written to fd outside of mDumpMut; it isn't closed until they're done.
+        size_t writerCount = 0;
+        // when it was last used, in dumps since the process started.
+        uint64_t lastUsed = 0;
+    };
+
+    std::optional<uint64_t> writeDump(std::string_view filename, const void* buffer,
+                                      size_t numberOfBytes) {
+        DumpFile* dumpFile = nullptr;
+        uint64_t offset = 0;
+        {
+            // only the offset reservation is serialized.  The write itself is not.
+            const std::lock_guard<std::mutex> guard(mDumpMut);
+            dumpFile = getDumpFileLocked(filename);
+            if (dumpFile == nullptr) {
+                return std::nullopt;
+            }
+            std::optional<uint64_t> reservedOffset =
+                    reserveLocked(filename, dumpFile->fd, numberOfBytes);
+            if (!reservedOffset) {
+                return std::nullopt;
+            }
+            offset = *reservedOffset;
+            ++dumpFile->writerCount;
+        }
+
+        std::optional<uint64_t> writtenOffset =
+                writeReserved(filename, dumpFile->fd, offset, buffer, numberOfBytes);
+
+        const std::lock_guard<std::mutex> guard(mDumpMut);
+        --dumpFile->writerCount;
+        return writtenOffset;
+    }
+
+    // Writes the dump to the space reserveLocked reserved for it.
+    static std::optional<uint64_t> writeReserved(std::string_view filename, int fd, uint64_t offset,
+                                                 const void* buffer, size_t numberOfBytes) {
+#if defined(__linux__) || defined(__ANDROID__)
+        // best effort; keeps large dumps contiguous and reports ENOSPC before we start writing.
+        posix_fallocate(fd, static_cast<off_t>(offset), static_cast<off_t>(numberOfBytes));
+#endif
+
+        const char* bufferPtr = static_cast<const char*>(buffer);
+        size_t bytesWritten = 0;
+        while (bytesWritten < numberOfBytes) {
+            ssize_t retVal = pwrite(fd, bufferPtr + bytesWritten, numberOfBytes - bytesWritten,
+                                    static_cast<off_t>(offset + bytesWritten));
+            if (retVal == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                writeToPlatformOut("CAPLOG: Failed to write dump file: [" + std::string(filename) +
+                                   "] | Errno: [" + std::to_string(errno) +
+                                   "] | Error String: [" + strerror(errno) + "] \n");
+                return std::nullopt;
+            }
+            bytesWritten += static_cast<size_t>(retVal);
+        }
+
+        return offset;
+    }
+
+    // Grows the file by numberOfBytes and returns where the new space starts.  The file's flock'd
+    // while it's grown, so processes sharing it never reserve the same space; a dump that's never
+    // written (eg. the process dies first) leaves zeros.  mDumpMut must be held.
+    static std::optional<uint64_t> reserveLocked(std::string_view filename, int fd,
+                                                 size_t numberOfBytes) {
+        while (flock(fd, LOCK_EX) == -1) {
+            if (errno != EINTR) {
+                writeToPlatformOut("CAPLOG: Failed to lock dump file: [" + std::string(filename) +
+                                   "] | Errno: [" + std::to_string(errno) + "] \n");
+                return std::nullopt;
+            }
+        }
+
+        std::optional<uint64_t> offset;
+        struct stat fileStat;
+        if ((fstat(fd, &fileStat) == 0) &&
+            (ftruncate(fd, fileStat.st_size + static_cast<off_t>(numberOfBytes)) == 0)) {
+            offset = static_cast<uint64_t>(fileStat.st_size);
+        } else {
+            writeToPlatformOut("CAPLOG: Failed to reserve space in dump file: [" +
+                               std::string(filename) + "] | Errno: [" + std::to_string(errno) +
+                               "] \n");
+        }
+
+        flock(fd, LOCK_UN);
+        return offset;
+    }
+
+    // mDumpMut must be held.  The DumpFile stays put until it's closed, which isn't while it has
+    // writers.
+    DumpFile* getDumpFileLocked(std::string_view filename) {
+        // A forked child inherits the parent's descriptors, which share the parent's flocks; it
+        // opens the files again for its own.
+        if (mDumpFilesPid != getpid()) {
+            for (auto& [openFilename, dumpFile] : mDumpFiles) {
+                close(dumpFile.fd);
+            }
+            mDumpFiles.clear();
+            mDumpFilesPid = getpid();
+        }
+
+        ++mDumpCount;
+        std::string filenameString(filename);
+        if (auto dumpFileIter = mDumpFiles.find(filenameString); dumpFileIter != mDumpFiles.end()) {
+            dumpFileIter->second.lastUsed = mDumpCount;
+            return &dumpFileIter->second;
+        }
+
+        if (mDumpFiles.size() >= maxOpenDumpFiles) {
+            closeLeastRecentlyUsedLocked();
+        }
+
+        if (!mDumpDirectoryCreated) {
+            if ((mkdir(dumpDirectory().c_str(), 0755) == -1) && (errno != EEXIST)) {
+                writeToPlatformOut("CAPLOG: Failed to create dump directory: " + dumpDirectory() +
+                                   "\n");
+                return nullptr;
+            }
+            mDumpDirectoryCreated = true;
+        }
+
+        std::string path = dumpDirectory() + "/" + filenameString;
+        int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+        if (fd == -1) {
+            writeToPlatformOut("CAPLOG: Failed to open dump file: [" + path + "] | Errno: [" +
+                               std::to_string(errno) + "] \n");
+            return nullptr;
+        }
+
+        return &mDumpFiles.emplace(std::move(filenameString), DumpFile{fd, 0, mDumpCount})
+                        .first->second;
+    }
+
+    // Closes the least recently used file that isn't being written to.  If they all are, none is
+    // closed, and more than maxOpenDumpFiles stay open until they're done.  maxOpenDumpFiles is
+    // small, so this is a scan rather than keeping a list in order.  mDumpMut must be held.
+    void closeLeastRecentlyUsedLocked() {
+        auto leastRecentIter = mDumpFiles.end();
+        for (auto dumpFileIter = mDumpFiles.begin(); dumpFileIter != mDumpFiles.end();
+             ++dumpFileIter) {
+            if ((dumpFileIter->second.writerCount == 0) &&
+                ((leastRecentIter == mDumpFiles.end()) ||
+                 (dumpFileIter->second.lastUsed < leastRecentIter->second.lastUsed))) {
+                leastRecentIter = dumpFileIter;
+            }
+        }
+        if (leastRecentIter != mDumpFiles.end()) {
+            close(leastRecentIter->second.fd);
+            mDumpFiles.erase(leastRecentIter);
+        }
+    }
+
+    std::mutex mDumpMut;
+    bool mDumpDirectoryCreated = false;
+    std::unordered_map<std::string, DumpFile> mDumpFiles;
+    // the process mDumpFiles were opened in.
+    pid_t mDumpFilesPid = getpid();
+    uint64_t mDumpCount = 0;
+#else
+    std::optional<uint64_t> writeDump(std::string_view filename, const void* buffer,
+                                      size_t numberOfBytes) {
+        const std::lock_guard<std::mutex> guard(mDumpMut);
+        std::filesystem::create_directories(dumpDirectory());
+        std::string path = dumpDirectory() + "/" + std::string(filename);
+        FILE* dumpFile = fopen(path.c_str(), "ab");
+        if (dumpFile == nullptr) {
+            return std::nullopt;
+        }
+        fseek(dumpFile, 0, SEEK_END);
+        long offset = ftell(dumpFile);
+        size_t bytesWritten = fwrite(buffer, 1, numberOfBytes, dumpFile);
+        fclose(dumpFile);
+        if ((offset < 0) || (bytesWritten != numberOfBytes)) {
+            return std::nullopt;
+        }
+        return static_cast<uint64_t>(offset);
+    }
+
+    std::mutex mDumpMut;
+#endif
 
   private:
+    std::mutex mWriteMut;
     FILE* pFile;
 };
 
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace CAP {
+
+// Size of the in memory ring that channels routed to the FlightRecorder sink write to.  Once it's
+// full the oldest lines are overwritten, so it always holds the most recent history.
+#ifdef CAPLOG_FLIGHT_RECORDER_BYTES
+constexpr const size_t flightRecorderBytes = CAPLOG_FLIGHT_RECORDER_BYTES;
+#else
+constexpr const size_t flightRecorderBytes = 1024 * 1024;
+#endif
+
+// Nothing in the ring leaves the process until someone asks for it; eg. a crash handler or a test
+// that failed can call writeSnapshotToFile().  This keeps high volume channels cheap; a write is a
+// memcpy into the ring.
+class FlightRecorder {
+  public:
+    static void writeToFlightRecorder(const std::string& output) {
+        getFlightRecorder().append(output);
+    }
+
+    // Contents of the ring, oldest line first.  If the ring has wrapped, the oldest line was
+    // partially overwritten, so it's dropped.
+    static std::string snapshot() {
+        FlightRecorder& recorder = getFlightRecorder();
+        const std::lock_guard<std::mutex> guard(recorder.mMut);
+        return recorder.snapshotLocked();
+    }
+
+    static bool writeSnapshotToFile(const char* filename) {
+        std::string contents = snapshot();
+        FILE* pFile = fopen(filename, "wb");
+        if (pFile == nullptr) {
+            return false;
+        }
+        size_t bytesWritten = fwrite(contents.data(), 1, contents.size(), pFile);
+        fclose(pFile);
+        return bytesWritten == contents.size();
+    }
+
+  private:
+    static FlightRecorder& getFlightRecorder() {
+        static FlightRecorder recorder;
+        return recorder;
+    }
+
+    FlightRecorder() : mRing(flightRecorderBytes) {}
+
+    void append(std::string_view output) {
+        const std::lock_guard<std::mutex> guard(mMut);
+        const size_t ringSize = mRing.size();
+        if (output.size() >= ringSize) {
+            output = output.substr(output.size() - ringSize);
+        }
+
+        size_t firstPart = std::min(output.size(), ringSize - mHead);
+        memcpy(mRing.data() + mHead, output.data(), firstPart);
+        memcpy(mRing.data(), output.data() + firstPart, output.size() - firstPart);
+
+        if (mHead + output.size() >= ringSize) {
+            mWrapped = true;
+        }
+        mHead = (mHead + output.size()) % ringSize;
+    }
+
+    std::string snapshotLocked() const {
+        if (!mWrapped) {
+            return std::string(mRing.data(), mHead);
+        }
+
+        std::string contents;
+        contents.reserve(mRing.size());
+        contents.append(mRing.data() + mHead, mRing.size() - mHead);
+        contents.append(mRing.data(), mHead);
+
+        size_t firstNewLine = contents.find('\n');
+        contents.erase(0, firstNewLine == std::string::npos ? contents.size() : firstNewLine + 1);
+        return contents;
+    }
+
+    std::mutex mMut;
+    std::vector<char> mRing;
+    size_t mHead = 0;
+    bool mWrapped = false;
+};
+
+}  // namespace CAP
@@ -14,6 +14,7 @@
 // #include <netinet/in.h> // for internet sockets... can't get it to work
 #include <fcntl.h>
 #include <poll.h>
+#include <pthread.h>
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <unistd.h>
@@ -22,9 +23,14 @@
 #include <signal.h>
 #include <cstring>
 #include <iostream>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
 #include <mutex>
+#include <thread>
 #include <vector>
 
+#include "compression.hpp"
 #include "outputstdout.hpp"
 #include "utilities.hpp"
 
@@ -41,6 +47,21 @@ namespace CAP {
 constexpr const char* caplogHostAddress = CAPTAINS_LOG_STRINGIFY(CAPLOG_SOCKET_HOST_IP);
 constexpr const size_t caplogHostPort = CAPLOG_SOCKET_PORT;
 
+// When enabled, text records are batched and sent as a single compressed frame (see
+// compression.hpp) instead of one frame per line.  The validator decompresses transparently.
+#ifdef CAPLOG_SOCKET_COMPRESSION
+constexpr const bool socketCompressionEnabled = true;
+#else
+constexpr const bool socketCompressionEnabled = false;
+#endif
+
+// A batch is sent once it grows past this size, or once the oldest record in it is older than
+// socketCompressionMaxBatchAge (by a background thread, so a process that goes quiet still gets
+// its last records sent).  Batches are also flushed before any binary stream is sent so that
+// ordering is kept.
+constexpr const size_t socketCompressionBatchBytes = 32 * 1024;
+constexpr const std::chrono::milliseconds socketCompressionMaxBatchAge{50};
+
 class SocketLogger {
   public:
     struct Header {
@@ -49,6 +70,15 @@ class SocketLogger {
     };
     static_assert(sizeof(Header) == 16, "Header must be 16 bytes");
 
+    // header.payload[2] values
+    enum PayloadType : uint32_t {
+        TEXT = 0,
+        BINARY_STREAM = 1,
+        // body is [uint32_t decompressed size][compressed block].  The decompressed bytes are a
+        // sequence of [uint32_t length][text] records, one per writeToSocket call.
+        COMPRESSED_TEXT_BATCH = 2,
+    };
+
     static SocketLogger& getSocketLogger() {
         static SocketLogger logger;
         return logger;
@@ -81,11 +111,14 @@ class SocketLogger {
     static void writeToSocket(const std::string& output) {
         SocketLogger& logger = getSocketLogger();
         if (logger.mSocketFD != -1) {
-            // TODO formalize this
-            // header[0] == type, header[1] == length in bytes.
-            // type = 0 == text, type = 1 == binary stream.
+            if constexpr (socketCompressionEnabled) {
+                logger.writeToBatch(output);
+                return;
+            }
+
+            // header[2] == type, header[3] == length in bytes.
             Header header{};
-            header.payload[2] = 0;
+            header.payload[2] = PayloadType::TEXT;
             header.payload[3] = static_cast<uint32_t>(output.size());
 
             bool success = false;
@@ -112,18 +145,17 @@ class SocketLogger {
                                           size_t numberOfBytes) {
         SocketLogger& logger = getSocketLogger();
         if (logger.mSocketFD != -1) {
-            // TODO formalize this
-            // header[0] == type, header[1] == length in bytes.
-            // type = 0 == text, type = 1 == binary stream.
+            // header[2] == type, header[3] == length in bytes.
             Header header{};
-            header.payload[2] = 1;
+            header.payload[2] = PayloadType::BINARY_STREAM;
             std::string bodyFilenamePart = std::string(filename) + std::string("||");
             header.payload[3] = (uint32_t)(bodyFilenamePart.size() + numberOfBytes);
 
             bool success = false;
             {
                 const std::lock_guard<std::mutex> guard(logger.mMut);
-                if (sendBufferOverSocket(logger.mSocketFD, header.payload, sizeof(Header))) {
+                if (logger.sendBatchLocked() &&
+                    sendBufferOverSocket(logger.mSocketFD, header.payload, sizeof(Header))) {
                     if (sendBufferOverSocket(logger.mSocketFD, bodyFilenamePart.data(),
                                              (uint32_t)bodyFilenamePart.size())) {
                         if (sendBufferOverSocket(logger.mSocketFD, data, numberOfBytes)) {
@@ -146,6 +178,13 @@ class SocketLogger {
 
         closeSocket();
 
+        // after a fork the child must not resend the parent's pending records.
+        mBatch.clear();
+
+        if constexpr (socketCompressionEnabled) {
+            startBatchFlusher();
+        }
+
         writeToPlatformOut("CAPLOG: Trying to connect to socket listener \n");
 
         writeToPlatformOut("CAPLOG: Host IP: " + std::string(caplogHostAddress) + ":" + std::to_string(caplogHostPort) + " \n");
@@ -290,7 +329,104 @@ class SocketLogger {
     }
 
   private:
-    SocketLogger() { reset(); }
+    SocketLogger() {
+        if constexpr (socketCompressionEnabled) {
+            // the batch flusher can be holding mMut when another thread forks; this keeps the
+            // child's copy of it unlocked.
+            pthread_atfork([]() { getSocketLogger().mMut.lock(); },
+                           []() { getSocketLogger().mMut.unlock(); },
+                           []() { getSocketLogger().mMut.unlock(); });
+        }
+        reset();
+    }
+
+    // Threads don't survive a fork, so a child (see CAP_LOG_ON_FORK) starts its own; the parent's
+    // std::thread is leaked in the child, since there's nothing there to join.  So is the condition
+    // variable the parent's flusher waits on: the child's copy still counts that waiter, and can't
+    // be waited on or destroyed.
+    void startBatchFlusher() {
+        if (mBatchFlusherPid == getpid()) {
+            return;
+        }
+        mBatchFlusher.release();
+        mBatchPending.release();
+        mBatchFlusherPid = getpid();
+        mBatchPending = std::make_unique<std::condition_variable>();
+        mBatchFlusher = std::make_unique<std::thread>([this]() { runBatchFlusher(); });
+    }
+
+    // sends the batch once its oldest record is socketCompressionMaxBatchAge old, if nothing
+    // else has sent it by then.
+    void runBatchFlusher() {
+        std::unique_lock<std::mutex> lock(mMut);
+        while (!mIsStopping) {
+            if (mBatch.empty()) {
+                mBatchPending->wait(lock);
+                continue;
+            }
+
+            const auto sendTime = mBatchStartTime + socketCompressionMaxBatchAge;
+            if (std::chrono::steady_clock::now() < sendTime) {
+                mBatchPending->wait_until(lock, sendTime);
+                continue;
+            }
+
+            if (mSocketFD == -1) {
+                mBatch.clear();
+            } else if (!sendBatchLocked()) {
+                closeSocket();
+            }
+        }
+    }
+
+    void writeToBatch(const std::string& output) {
+        bool success = true;
+        {
+            const std::lock_guard<std::mutex> guard(mMut);
+            if (mBatch.empty()) {
+                mBatchStartTime = std::chrono::steady_clock::now();
+                if (mBatchPending) {
+                    mBatchPending->notify_one();
+                }
+            }
+
+            uint32_t recordLength = static_cast<uint32_t>(output.size());
+            mBatch.append(reinterpret_cast<const char*>(&recordLength), sizeof(recordLength));
+            mBatch.append(output);
+
+            if ((mBatch.size() >= socketCompressionBatchBytes) ||
+                (std::chrono::steady_clock::now() - mBatchStartTime >=
+                 socketCompressionMaxBatchAge)) {
+                success = sendBatchLocked();
+            }
+        }
+
+        if (!success) {
+            closeSocket();
+        }
+    }
+
+    // mMut must be held.  Returns false if the send failed.
+    bool sendBatchLocked() {
+        if (mBatch.empty() || (mSocketFD == -1)) {
+            return true;
+        }
+
+        uint32_t decompressedSize = static_cast<uint32_t>(mBatch.size());
+        mCompressedBatch.clear();
+        mCompressedBatch.reserve(sizeof(decompressedSize) + Compression::compressBound(mBatch.size()));
+        mCompressedBatch.append(reinterpret_cast<const char*>(&decompressedSize),
+                                sizeof(decompressedSize));
+        Compression::compress(mBatch, mCompressedBatch);
+        mBatch.clear();
+
+        Header header{};
+        header.payload[2] = PayloadType::COMPRESSED_TEXT_BATCH;
+        header.payload[3] = static_cast<uint32_t>(mCompressedBatch.size());
+
+        return sendBufferOverSocket(mSocketFD, header.payload, sizeof(Header)) &&
+               sendBufferOverSocket(mSocketFD, mCompressedBatch.data(), mCompressedBatch.size());
+    }
 
     void closeSocket() {
         if (mSocketFD != -1) {
@@ -301,13 +437,44 @@ class SocketLogger {
         }
     }
 
-    ~SocketLogger() { closeSocket(); }
+    ~SocketLogger() {
+        if (mBatchFlusherPid != getpid()) {
+            // a forked child that didn't call CAP_LOG_ON_FORK: the flusher (which can't be joined
+            // here, see startBatchFlusher) and the pending batch are the parent's, and the parent's
+            // still sending on this socket, so nothing's sent.  (Without compression there's no
+            // flusher or batch, and this does nothing.)
+            mBatchFlusher.release();
+            mBatchPending.release();
+            const std::lock_guard<std::mutex> guard(mMut);
+            mBatch.clear();
+        } else {
+            {
+                const std::lock_guard<std::mutex> guard(mMut);
+                sendBatchLocked();
+                mIsStopping = true;
+            }
+            mBatchPending->notify_one();
+            mBatchFlusher->join();
+        }
+        closeSocket();
+    }
 
   private:
     // Streams can end up partially written, but each send needs to be "atomic".  That is,
     // header+payload needs to be kept together.
     std::mutex mMut;
     int mSocketFD = -1;
+
+    // only used when socketCompressionEnabled.  Guarded by mMut.
+    std::string mBatch;
+    std::string mCompressedBatch;
+    std::chrono::steady_clock::time_point mBatchStartTime;
+    // mBatchPending and mBatchFlusher belong to the process that started them.
+    std::unique_ptr<std::condition_variable> mBatchPending;
+    bool mIsStopping = false;
+    std::unique_ptr<std::thread> mBatchFlusher;
+    // the process mBatchFlusher was started in.
+    pid_t mBatchFlusherPid = -1;
 };
 
 }  // namespace CAP
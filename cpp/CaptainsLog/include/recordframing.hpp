@@ -0,0 +1,188 @@
+#pragma once
+
+#include <charconv>
+#include <istream>
+#include <string>
+#include <string_view>
+
+#include "constants.hpp"
+
+// Length prefixed records for outputs that don't have a line length limit (see LineFraming in
+// output.hpp).  Instead of splitting a long line into CONCAT pieces, the whole line is written
+// in one piece with its length up front:
+//
+//   #<decimal length of record>#<record>\n
+//
+// The record is the exact line that would otherwise have been written (without its newline), so
+// once the header is stripped readers handle it like any other line.  The length lets a record
+// contain newlines and lets readers skip scanning for the end of it.
+//
+// Lines without the header (eg. older captures, or ones from Logcat/stdout) are passed through as
+// is, so readers can be pointed at either.  Every record starts with CAP_MAIN_PREFIX_DELIMITER, so
+// a header is only taken to be one when that follows it; other output that happens to start with
+// #<digits># is passed through too.  And if the lines after a header don't add up to its length
+// (the capture's cut off or corrupt), only the header's own line is taken as the record, and the
+// lines after it are read on their own.
+
+namespace CAP::RecordFraming {
+
+constexpr const char delimiter = CAP_RECORD_LENGTH_DELIMITER[0];
+
+/// @brief Appends the header for a record of recordLength bytes to out.
+inline void appendRecordHeader(std::string& out, size_t recordLength) {
+    char digits[24];
+    auto [end, ec] = std::to_chars(digits, digits + sizeof(digits), recordLength);
+    out += delimiter;
+    out.append(digits, static_cast<size_t>(end - digits));
+    out += delimiter;
+}
+
+/// @brief Parses a record header at the start of line.
+/// @param recordLength set to the length of the record if a header was found.
+/// @return the size of the header in bytes, or 0 if line doesn't start with a header (followed by
+/// the start of a record).
+inline size_t parseRecordHeader(std::string_view line, size_t& recordLength) {
+    if (line.size() < 3 || line[0] != delimiter) {
+        return 0;
+    }
+    const char* begin = line.data() + 1;
+    const char* end = line.data() + line.size();
+    size_t length = 0;
+    auto [lengthEnd, ec] = std::from_chars(begin, end, length);
+    if (ec != std::errc() || lengthEnd == begin || lengthEnd == end || *lengthEnd != delimiter) {
+        return 0;
+    }
+    const size_t headerLength = static_cast<size_t>(lengthEnd - line.data()) + 1;
+    constexpr std::string_view recordPrefix = CAP_MAIN_PREFIX_DELIMITER;
+    if (line.substr(headerLength, recordPrefix.size()) != recordPrefix) {
+        return 0;
+    }
+    recordLength = length;
+    return headerLength;
+}
+
+/// @brief Whether a line read after a record's header can be the next line of that record, which
+/// has recordLength bytes and has read readLength of them so far.  It can't if it'd make the record
+/// too long, or if it's the header of another record.
+inline bool isRecordContinuation(std::string_view line, size_t readLength, size_t recordLength) {
+    size_t nextRecordLength = 0;
+    return (readLength + 1 + line.size() <= recordLength) &&
+           (parseRecordHeader(line, nextRecordLength) == 0);
+}
+
+/// @brief Drop in replacement for std::getline that reassembles length prefixed records.
+/// @param record receives the next record with the header stripped, or the next line as is if it
+/// isn't framed.
+/// @return false at end of stream, same as std::getline.
+inline bool readRecord(std::istream& inputStream, std::string& record) {
+    if (!std::getline(inputStream, record)) {
+        return false;
+    }
+
+    size_t recordLength = 0;
+    size_t headerLength = parseRecordHeader(record, recordLength);
+    if (headerLength == 0) {
+        return true;
+    }
+
+    record.erase(0, headerLength);
+
+    // the record had newlines in it; keep reading until we have all of it.  If it can't be had, the
+    // stream's put back to the line after the header's (unless it can't seek, eg. a pipe).
+    const size_t headerLineLength = record.size();
+    const std::streampos continuationBegin = inputStream.tellg();
+    std::string continuation;
+    while (record.size() < recordLength) {
+        if (!std::getline(inputStream, continuation) ||
+            !isRecordContinuation(continuation, record.size(), recordLength)) {
+            if (continuationBegin != std::streampos(-1)) {
+                inputStream.clear();
+                inputStream.seekg(continuationBegin);
+                record.resize(headerLineLength);
+            } else if (inputStream) {
+                record += '\n';
+                record += continuation;
+            }
+            break;
+        }
+        record += '\n';
+        record += continuation;
+    }
+    return true;
+}
+
+namespace detail {
+
+enum class ReadResult {
+    // there was nothing left to read.
+    End,
+    Read,
+    // a record whose lines run past the end of the buffer; only its header's line was read.
+    Incomplete,
+};
+
+inline ReadResult readRecord(std::string_view buffer, size_t& offset, std::string_view& record) {
+    if (offset >= buffer.size()) {
+        return ReadResult::End;
+    }
+
+    size_t lineEnd = buffer.find('\n', offset);
+    lineEnd = (lineEnd == std::string_view::npos) ? buffer.size() : lineEnd;
+
+    size_t recordLength = 0;
+    size_t headerLength = parseRecordHeader(buffer.substr(offset, lineEnd - offset), recordLength);
+    size_t recordBegin = offset + headerLength;
+
+    // the record had newlines in it; take lines until we have all of it, or until it's clear it
+    // can't be had, and then it's just the header's line.
+    ReadResult result = ReadResult::Read;
+    size_t recordEnd = lineEnd;
+    while (headerLength != 0 && recordEnd - recordBegin < recordLength) {
+        if (recordEnd + 1 >= buffer.size()) {
+            result = ReadResult::Incomplete;
+            recordEnd = lineEnd;
+            break;
+        }
+        size_t nextLineEnd = buffer.find('\n', recordEnd + 1);
+        nextLineEnd = (nextLineEnd == std::string_view::npos) ? buffer.size() : nextLineEnd;
+        if (!isRecordContinuation(buffer.substr(recordEnd + 1, nextLineEnd - recordEnd - 1),
+                                  recordEnd - recordBegin, recordLength)) {
+            recordEnd = lineEnd;
+            break;
+        }
+        recordEnd = nextLineEnd;
+    }
+
+    record = buffer.substr(recordBegin, recordEnd - recordBegin);
+    offset = recordEnd + 1;
+    return result;
+}
+
+}  // namespace detail
+
+/// @brief Same as the istream readRecord, for a capture that's already in memory (eg. mmap'd).
+/// Nothing is copied; record is a view into buffer.
+/// @param offset where to read from in buffer; moved past the record (and its newline).
+/// @return false once offset reaches the end of buffer.
+inline bool readRecord(std::string_view buffer, size_t& offset, std::string_view& record) {
+    return detail::readRecord(buffer, offset, record) != detail::ReadResult::End;
+}
+
+/// @brief Same as the string_view readRecord, for a buffer that's still being appended to (eg. a
+/// capture that's being followed while it's written).  A record is only read once all of it, and
+/// its newline, is in buffer.
+/// @return false if there's no complete record at offset yet; offset and record are unchanged.
+inline bool readCompleteRecord(std::string_view buffer, size_t& offset, std::string_view& record) {
+    size_t recordEnd = offset;
+    std::string_view completeRecord;
+    if (detail::readRecord(buffer, recordEnd, completeRecord) != detail::ReadResult::Read ||
+        recordEnd > buffer.size()) {
+        return false;
+    }
+
+    offset = recordEnd;
+    record = completeRecord;
+    return true;
+}
+
+}  // namespace CAP::RecordFraming
@@ -8,6 +8,9 @@ DEFINE_CAP_LOG_CHANNEL(CHANNEL_ONE, 2, FULLY_ENABLED)
   DEFINE_CAP_LOG_CHANNEL(CHANNEL_THREE, 8, FULLY_ENABLED, CHANNEL_ONE)
     DEFINE_CAP_LOG_CHANNEL(CHANNEL_THREE_B, 4, ENABLED_NO_OUTPUT, CHANNEL_THREE)
       DEFINE_CAP_LOG_CHANNEL(CHANNEL_THREE_C, 4, FULLY_ENABLED, CHANNEL_THREE_B)
+  DEFINE_CAP_LOG_CHANNEL_WITH_SINKS(CHANNEL_HIGH_VOLUME, 8, FULLY_ENABLED, FlightRecorderSink, CHANNEL_ONE)
+    DEFINE_CAP_LOG_CHANNEL(CHANNEL_HIGH_VOLUME_B, 8, FULLY_ENABLED, CHANNEL_HIGH_VOLUME)
+DEFINE_CAP_LOG_CHANNEL(CHANNEL_ERRORS, 0, FULLY_ENABLED, CHANNEL_ROOT_ALL_ERRORS)
       
 ///////
 
@@ -26,5 +29,21 @@ int main() {
   printf("Channel CHANNEL_THREE_B is %zu\n", (size_t) CAP_CHANNEL_OUTPUT_MODE(CAP_LOG_CHANNEL_STRING(CHANNEL_THREE_B)));
   printf("Channel CHANNEL_THREE_C is %zu\n", (size_t) CAP_CHANNEL_OUTPUT_MODE(CAP_LOG_CHANNEL_STRING(CHANNEL_THREE_C)));
 
+  printf("Channel CHANNEL_ONE sinks %zu\n", (size_t) CAP_CHANNEL_OUTPUT_SINKS(CAP_LOG_CHANNEL_STRING(CHANNEL_ONE)));
+  printf("Channel CHANNEL_HIGH_VOLUME sinks %zu\n", (size_t) CAP_CHANNEL_OUTPUT_SINKS(CAP_LOG_CHANNEL_STRING(CHANNEL_HIGH_VOLUME)));
+  printf("Channel CHANNEL_HIGH_VOLUME_B sinks %zu\n", (size_t) CAP_CHANNEL_OUTPUT_SINKS(CAP_LOG_CHANNEL_STRING(CHANNEL_HIGH_VOLUME_B)));
+  printf("Channel CHANNEL_ERRORS sinks %zu\n", (size_t) CAP_CHANNEL_OUTPUT_SINKS(CAP_LOG_CHANNEL_STRING(CHANNEL_ERRORS)));
+
+  for (int i = 0; i < 3; ++i) {
+    CAP_LOG_SCOPE_NO_THIS(CHANNEL_HIGH_VOLUME_B, "frame %d", i);
+  }
+  {
+    CAP_LOG_SCOPE_NO_THIS(CHANNEL_ERRORS);
+    CAP_LOG_ERROR("an error");
+  }
+
+  std::string flightRecorderContents = CAP::FlightRecorder::snapshot();
+  printf("Flight recorder has %zu bytes:\n%s", flightRecorderContents.size(), flightRecorderContents.c_str());
+
   return 0;
 }
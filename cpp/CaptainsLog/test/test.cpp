@@ -2,6 +2,9 @@
 #include <vector>
 #include <sstream>
 
+#include <sys/wait.h>
+#include <unistd.h>
+
 DEFINE_CAP_LOG_CHANNEL(RENDER, 0, FULLY_ENABLED)
   DEFINE_CAP_LOG_CHANNEL(RENDER_SUB_CHANNEL_A, 0, FULLY_ENABLED, RENDER)
   DEFINE_CAP_LOG_CHANNEL(RENDER_SUB_CHANNEL_A_VERBOSE, 5, FULLY_ENABLED, RENDER)
@@ -320,6 +323,7 @@ int main() {
   {
     CAP_LOG_BLOCK_NO_THIS(CAP::CHANNEL::RENDER_SUB_CHANNEL_A_VERBOSE);
     CAP_LOG("%s", giantString.c_str());
+    CAP_DUMP_TO_FILE("giantString.bin", giantString.data(), giantString.size());
   }
 
 
@@ -335,5 +339,19 @@ int main() {
   std::cout << "PARENT2 " << CAP_CHANNEL_OUTPUT_MODE(CAP::CHANNEL::PARENT2) << std::endl;
   std::cout << "CHILD1 " << CAP_CHANNEL_OUTPUT_MODE(CAP::CHANNEL::CHILD1) << std::endl;
 
+  // a child that exits normally without calling CAP_LOG_ON_FORK still runs the loggers'
+  // destructors, on the state it got from this process.
+  CAP_LOG("forking a child that exits without CAP_LOG_ON_FORK");
+  pid_t childPid = fork();
+  if (childPid == 0) {
+    exit(0);
+  }
+  int childStatus = 0;
+  waitpid(childPid, &childStatus, 0);
+  if (!WIFEXITED(childStatus) || WEXITSTATUS(childStatus) != 0) {
+    std::cout << "forked child didn't exit cleanly" << std::endl;
+    return 1;
+  }
+
   return 0;
 }
\ No newline at end of file
@@ -0,0 +1,301 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * The .clogidx sidecar that processClog writes next to a processed log (<output>.clogidx), so
+ * readers can jump around a huge log without parsing it from the top.
+ *
+ * The file is the Header followed by flat arrays of the structs below, in host byte order, each
+ * starting on an 8 byte boundary.  It's meant to be mmap'd and read in place (see Reader):
+ *
+ *   nodes      one Node per stack node, in output order.  Node indices are the ids used everywhere
+ *              else in the index.
+ *   threads    one Thread per (process, thread), sorted by id, each with the list of its nodes.
+ *   channels   one Key per channel id, sorted by name, each with the list of its nodes.
+ *   functions  one Key per function name, sorted by name, each with the list of the nodes that
+ *              open a call to it.
+ *   postings   the node lists of the above; each list is in ascending node order.
+ *   strings    the names of the Keys.
+ **/
+
+namespace ClogIndex {
+
+constexpr const char magic[8] = {'C', 'L', 'O', 'G', 'I', 'D', 'X', '\0'};
+constexpr const uint32_t version = 1;
+
+// callerIdx, parentIdx and pairedIdx of a node that doesn't have one.
+constexpr const uint64_t noNode = UINT64_MAX;
+
+struct Section {
+  uint64_t offset;
+  uint64_t count;
+};
+
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t nodeSize;
+  // size of the processed log when the index was written, to catch an index that's out of date.
+  uint64_t outputFileSize;
+  Section nodes;
+  Section threads;
+  Section channels;
+  Section functions;
+  Section postings;
+  Section strings;
+};
+
+struct Node {
+  // where the node's line starts in the processed log; in bytes and in lines (from 0).
+  uint64_t outputOffset;
+  uint64_t outputLine;
+  // the caller processClog linked the node to.
+  uint64_t callerIdx;
+  // the innermost scope the node is in, ie. the BLOCK_SCOPE_OPEN it's nested under.
+  uint64_t parentIdx;
+  // for a BLOCK_SCOPE_OPEN its BLOCK_SCOPE_CLOSE and the other way around.
+  uint64_t pairedIdx;
+  uint32_t threadIdx;
+  uint32_t depth;
+  // a CapLogType.
+  uint32_t logLineType;
+  uint32_t reserved;
+};
+
+struct Thread {
+  uint64_t uniqueProcessId;
+  uint64_t uniqueThreadId;
+  uint64_t postingsBegin;
+  uint64_t postingsCount;
+};
+
+struct Key {
+  uint64_t stringOffset;
+  uint64_t stringLength;
+  uint64_t postingsBegin;
+  uint64_t postingsCount;
+};
+
+// A list of node indices in the index.
+class NodeList {
+public:
+  NodeList() = default;
+  NodeList(const uint64_t* begin, size_t count): mBegin(begin), mCount(count) {}
+
+  const uint64_t* begin() const { return mBegin; }
+  const uint64_t* end() const { return mBegin + mCount; }
+  size_t size() const { return mCount; }
+  bool empty() const { return mCount == 0; }
+  uint64_t operator[](size_t idx) const { return mBegin[idx]; }
+
+private:
+  const uint64_t* mBegin = nullptr;
+  size_t mCount = 0;
+};
+
+/**
+ * Reads a .clogidx in place.  Lookups by line, thread, channel or function are binary searches,
+ * so they're O(log n) plus the size of what they return.
+ **/
+class Reader {
+public:
+  explicit Reader(const char* filename) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+      return;
+    }
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) == 0 && static_cast<size_t>(fileStat.st_size) >= sizeof(Header)) {
+      void* mapped = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (mapped != MAP_FAILED) {
+        mMapped = static_cast<const char*>(mapped);
+        mMappedSize = fileStat.st_size;
+      }
+    }
+    close(fd);
+
+    if (mMapped && !validate()) {
+      munmap(const_cast<char*>(mMapped), mMappedSize);
+      mMapped = nullptr;
+    }
+  }
+
+  ~Reader() {
+    if (mMapped) {
+      munmap(const_cast<char*>(mMapped), mMappedSize);
+    }
+  }
+
+  Reader(const Reader&) = delete;
+  Reader& operator=(const Reader&) = delete;
+
+  // false if the file couldn't be read or isn't a .clogidx this version can read.
+  bool isOpen() const {
+    return mMapped != nullptr;
+  }
+
+  // false if processedFilename isn't the size it was when the index was written, ie. it's been
+  // processed again (or appended to) since, and the index no longer describes it.
+  bool isCurrentFor(const char* processedFilename) const {
+    struct stat fileStat;
+    return isOpen() && stat(processedFilename, &fileStat) == 0
+      && static_cast<uint64_t>(fileStat.st_size) == header().outputFileSize;
+  }
+
+  const Header& header() const {
+    return *reinterpret_cast<const Header*>(mMapped);
+  }
+
+  size_t nodeCount() const {
+    return header().nodes.count;
+  }
+
+  const Node& node(size_t nodeIdx) const {
+    return section<Node>(header().nodes)[nodeIdx];
+  }
+
+  // The node whose text is on outputLine (a multi-line payload spans several lines), or noNode if
+  // the line is before the first node.
+  uint64_t nodeOnOutputLine(uint64_t outputLine) const {
+    const Node* nodes = section<Node>(header().nodes);
+    const Node* after = std::upper_bound(nodes, nodes + nodeCount(), outputLine,
+      [](uint64_t line, const Node& node) { return line < node.outputLine; });
+    return after == nodes ? noNode : static_cast<uint64_t>(after - nodes - 1);
+  }
+
+  // The scopes nodeIdx is in, innermost first.
+  std::vector<uint64_t> callStack(uint64_t nodeIdx) const {
+    std::vector<uint64_t> scopes;
+    for (uint64_t scopeIdx = node(nodeIdx).parentIdx; scopeIdx != noNode; scopeIdx = node(scopeIdx).parentIdx) {
+      scopes.push_back(scopeIdx);
+    }
+    return scopes;
+  }
+
+  NodeList threadNodes(uint64_t uniqueProcessId, uint64_t uniqueThreadId) const {
+    const Thread* threads = section<Thread>(header().threads);
+    const Thread* threadsEnd = threads + header().threads.count;
+    const Thread* found = std::lower_bound(threads, threadsEnd, std::make_pair(uniqueProcessId, uniqueThreadId),
+      [](const Thread& thread, const std::pair<uint64_t, uint64_t>& id) {
+        return std::make_pair(thread.uniqueProcessId, thread.uniqueThreadId) < id;
+      });
+    if (found == threadsEnd || found->uniqueProcessId != uniqueProcessId || found->uniqueThreadId != uniqueThreadId) {
+      return NodeList();
+    }
+    return postings(found->postingsBegin, found->postingsCount);
+  }
+
+  NodeList channelNodes(std::string_view channelId) const {
+    return findKey(header().channels, channelId);
+  }
+
+  // The BLOCK_SCOPE_OPEN nodes of every call to functionName.
+  NodeList functionCalls(std::string_view functionName) const {
+    return findKey(header().functions, functionName);
+  }
+
+private:
+  template <typename T>
+  const T* section(const Section& sectionEntry) const {
+    return reinterpret_cast<const T*>(mMapped + sectionEntry.offset);
+  }
+
+  NodeList postings(uint64_t postingsBegin, uint64_t postingsCount) const {
+    return NodeList(section<uint64_t>(header().postings) + postingsBegin, postingsCount);
+  }
+
+  std::string_view keyString(const Key& key) const {
+    return std::string_view(section<char>(header().strings) + key.stringOffset, key.stringLength);
+  }
+
+  NodeList findKey(const Section& keySection, std::string_view name) const {
+    const Key* keys = section<Key>(keySection);
+    const Key* keysEnd = keys + keySection.count;
+    const Key* found = std::lower_bound(keys, keysEnd, name,
+      [this](const Key& key, std::string_view name) { return keyString(key) < name; });
+    if (found == keysEnd || keyString(*found) != name) {
+      return NodeList();
+    }
+    return postings(found->postingsBegin, found->postingsCount);
+  }
+
+  bool validSection(const Section& sectionEntry, size_t entrySize) const {
+    return sectionEntry.offset % 8 == 0
+      && sectionEntry.offset <= mMappedSize
+      && sectionEntry.count <= (mMappedSize - sectionEntry.offset) / entrySize;
+  }
+
+  bool validNode(uint64_t nodeIdx) const {
+    return nodeIdx == noNode || nodeIdx < nodeCount();
+  }
+
+  bool validPostings(uint64_t postingsBegin, uint64_t postingsCount) const {
+    const uint64_t postingsSize = header().postings.count;
+    if (postingsBegin > postingsSize || postingsCount > postingsSize - postingsBegin) {
+      return false;
+    }
+    const NodeList nodes = postings(postingsBegin, postingsCount);
+    return std::all_of(nodes.begin(), nodes.end(), [this](uint64_t nodeIdx) { return nodeIdx < nodeCount(); });
+  }
+
+  bool validKeys(const Section& keySection) const {
+    const uint64_t stringsSize = header().strings.count;
+    const Key* keys = section<Key>(keySection);
+    return std::all_of(keys, keys + keySection.count, [this, stringsSize](const Key& key) {
+      return key.stringOffset <= stringsSize && key.stringLength <= stringsSize - key.stringOffset
+        && validPostings(key.postingsBegin, key.postingsCount);
+    });
+  }
+
+  // Everything the lookups follow is checked here, once, so they don't have to: every index into
+  // another section has to be in it, and a node's parent has to come before it (so callStack
+  // can't go round in circles).
+  bool validate() const {
+    const Header& indexHeader = header();
+    if (std::memcmp(indexHeader.magic, magic, sizeof(magic)) != 0
+        || indexHeader.version != version
+        || indexHeader.nodeSize != sizeof(Node)) {
+      return false;
+    }
+    if (!validSection(indexHeader.nodes, sizeof(Node))
+        || !validSection(indexHeader.threads, sizeof(Thread))
+        || !validSection(indexHeader.channels, sizeof(Key))
+        || !validSection(indexHeader.functions, sizeof(Key))
+        || !validSection(indexHeader.postings, sizeof(uint64_t))
+        || !validSection(indexHeader.strings, 1)) {
+      return false;
+    }
+
+    for (uint64_t nodeIdx = 0; nodeIdx < nodeCount(); ++nodeIdx) {
+      const Node& indexNode = node(nodeIdx);
+      if (!validNode(indexNode.callerIdx)
+          || !validNode(indexNode.pairedIdx)
+          || (indexNode.parentIdx != noNode && indexNode.parentIdx >= nodeIdx)
+          || indexNode.threadIdx >= indexHeader.threads.count) {
+        return false;
+      }
+    }
+    const Thread* threads = section<Thread>(indexHeader.threads);
+    return std::all_of(threads, threads + indexHeader.threads.count,
+        [this](const Thread& thread) { return validPostings(thread.postingsBegin, thread.postingsCount); })
+      && validKeys(indexHeader.channels)
+      && validKeys(indexHeader.functions);
+  }
+
+  const char* mMapped = nullptr;
+  size_t mMappedSize = 0;
+};
+
+} // namespace ClogIndex
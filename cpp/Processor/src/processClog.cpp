@@ -1,8 +1,7 @@
 #include <iostream>
-#include <iterator>
-#include <regex>
+#include <charconv>
 #include <string>
-#include <fstream>
+#include <string_view>
 #include <unordered_map>
 #include <map>
 #include <memory>
@@ -10,24 +9,42 @@
 #include <vector>
 #include <cassert>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <future>
+#include <thread>
+#include <variant>
 #include <cstdlib>
 #include <assert.h>
+#include <cerrno>
 #include <cmath> // for progress bar
-#include <string>
+#include <cstring>
+#include <limits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
 
 #include <CaptainsLog/include/caplogger.hpp>
+#include <CaptainsLog/include/recordframing.hpp>
+
+#include "clogIndex.hpp"
 
 /*
 ------------------------------------------------------------------------------
 CHANNEL MESSAGE (always the first caplog message to get displayed per process)
 ------------------------------------------------------------------------------
-1         2            3   4                5             6               7     8     
-CAP_LOG : P=4165984483 T=0 CHANNEL-ID=002 : ENABLED=YES : VERBOSITY : 0 : >  >  RENDER_SUB_CHANNEL_A
+1         2            3   4                     5             6               7     8     
+CAP_LOG : P=4165984483 T=0 CHANNEL-ID=bcdf644c : ENABLED=YES : VERBOSITY : 0 : >  >  RENDER_SUB_CHANNEL_A
 
 1 - main delimiter
 2 - process timestamp (used to uniquely identify this log to the process).  Remaps to a smaller number in vsix.
 3 - relative thread id
-4 - channel ID (3 digits)
+4 - channel ID (8 hex digits; a hash of the channel name, see channelIdFromName)
 5 - If the channel is enabled or not
 6 - verbosity level
 7 - tabs to show channel hierarchical relationship
@@ -37,15 +54,15 @@ CAP_LOG : P=4165984483 T=0 CHANNEL-ID=002 : ENABLED=YES : VERBOSITY : 0 : >  >
 LOG LINES:
 ------------------------------------------------------------------------------
 
-1         2            3   4     5  6 7     8           9                                               10
-CAP_LOG : P=4293102038 T=0 C=005 :F 3 [25]::[test.cpp]::[something::TestNetwork::TestNetwork()] 0x7ffecc005730
-CAP_LOG : P=4293102038 T=0 C=005 :-> 3 [25] LOG: Testing format = hello 
-CAP_LOG : P=4293102038 T=0 C=005 :L 3 [25]::[test.cpp]::[something::TestNetwork::TestNetwork()] 0x7ffecc005730
+1         2            3   4          5  6 7     8           9                                               10
+CAP_LOG : P=4293102038 T=0 C=60b0d865 :F 3 [25]::[test.cpp]::[something::TestNetwork::TestNetwork()] 0x7ffecc005730
+CAP_LOG : P=4293102038 T=0 C=60b0d865 :-> 3 [25] LOG: Testing format = hello 
+CAP_LOG : P=4293102038 T=0 C=60b0d865 :L 3 [25]::[test.cpp]::[something::TestNetwork::TestNetwork()] 0x7ffecc005730
 
 1 - main delimiter
 2 - process timestamp (used to uniquely identify this log to the process).  Remaps to a smaller number in vsix.
 3 - relative thread id
-4 - channel ID (3 digits)
+4 - channel ID (8 hex digits; a hash of the channel name, see channelIdFromName)
 5 - PRIMARY_LOG_BEGIN_DELIMITER (start of block)
     F = start of block
     -> = log within block
@@ -60,88 +77,256 @@ CAP_LOG : P=4293102038 T=0 C=005 :L 3 [25]::[test.cpp]::[something::TestNetwork:
 
 namespace {
 /**
- * This will match all the channel logs
- * the sub-expressions:
- * 0 - The full string
- * 1 - The caplog string
+ * The line formats above are fixed, so instead of regexes the lines are parsed with a single
+ * left to right scan.  Fields are string_views into the line being parsed; nothing is copied
+ * until a StackNode is built.
+ *
+ * Each scan matches exactly what the regex in its comment used to.  Captures written (.+?) end at
+ * the first occurrence of the text that follows them, and are never empty.
+ **/
+constexpr const std::string_view caplogDelimiter = "CAP_LOG : ";
+
+/**
+ * Finds the caplog line within an input line (which may have a prefix, eg. from logcat).
+ * regex_search: "(.*CAP_LOG : .*)"
+ * Returns the line from the start of the (sub)line holding the first "CAP_LOG : " to the end
+ * of that (sub)line, or nullopt if there is no caplog message.
+ **/
+std::optional<std::string_view> scanCaplogLine(std::string_view inputLine) {
+  size_t delimiterPos = inputLine.find(caplogDelimiter);
+  if (delimiterPos == std::string_view::npos) {
+    return std::nullopt;
+  }
+
+  // '.' doesn't match line terminators, and a length prefixed record can hold several lines.
+  size_t lineBegin = inputLine.find_last_of("\r\n", delimiterPos);
+  lineBegin = (lineBegin == std::string_view::npos) ? 0 : lineBegin + 1;
+  size_t lineEnd = inputLine.find_first_of("\r\n", delimiterPos + caplogDelimiter.size());
+  lineEnd = (lineEnd == std::string_view::npos) ? inputLine.size() : lineEnd;
+  return inputLine.substr(lineBegin, lineEnd - lineBegin);
+}
+
+/**
+ * Walks a single line, matching one piece of the pattern at a time.
  **/
-std::regex caplogRegex(
-  "(.*CAP_LOG : .*)",
-  std::regex_constants::ECMAScript);
+class LineScanner {
+public:
+  explicit LineScanner(std::string_view line) : mLine(line) {}
+
+  // .*?literal
+  bool skipPast(std::string_view literal) {
+    size_t literalPos = mLine.find(literal, mPos);
+    if (literalPos == std::string_view::npos) {
+      return false;
+    }
+    mPos = literalPos + literal.size();
+    return true;
+  }
+
+  // (.+?)literal
+  bool captureUntil(std::string_view literal, std::string_view& capture) {
+    size_t literalPos = mLine.find(literal, mPos + 1);
+    if (literalPos == std::string_view::npos) {
+      return false;
+    }
+    capture = mLine.substr(mPos, literalPos - mPos);
+    mPos = literalPos + literal.size();
+    return true;
+  }
+
+  // (.*) or, with allowEmpty false, a trailing (.+?)
+  bool captureRest(std::string_view& capture, bool allowEmpty) {
+    if (!allowEmpty && mPos >= mLine.size()) {
+      return false;
+    }
+    capture = mLine.substr(mPos);
+    mPos = mLine.size();
+    return true;
+  }
+
+private:
+  std::string_view mLine;
+  size_t mPos = 0;
+};
 
 /**
- * This will match the character limit line
- * the sub-expressions:
- * 0 - the full string
- * 1 - ProcessId
- * 2 - the max number of characters per line
+ * The character limit line
+ * regex_match: ".*?CAP_LOG : P=(.+?) MAX-CHAR-SIZE=(.+?)"
  **/
-std::regex maxCharsLineRegex(
-  ".*?CAP_LOG : P=(.+?) MAX-CHAR-SIZE=(.+?)",
-  std::regex_constants::ECMAScript);
+struct MaxCharsLineFields {
+  std::string_view processId;
+  std::string_view maxChars;
+};
+
+std::optional<MaxCharsLineFields> scanMaxCharsLine(std::string_view line) {
+  LineScanner scanner(line);
+  MaxCharsLineFields fields;
+  if (scanner.skipPast("CAP_LOG : P=")
+      && scanner.captureUntil(" MAX-CHAR-SIZE=", fields.processId)
+      && scanner.captureRest(fields.maxChars, false)) {
+    return fields;
+  }
+  return std::nullopt;
+}
 
 /**
- * This will match all the channel logs
- * the sub-expressions:
- * 0 - the full string
- * 1 - ProcessId
- * 2 - ThreadId
- * 3 - ChannelId
- * 4 - Enabled
- * 5 - VerbosityLevel
- * 6 - ChannelName
+ * The channel lines
+ * regex_match: ".*?CAP_LOG : P=(.+?) T=(.+?) CHANNEL-ID=(.+?) : (.+?) : VERBOSITY=(.+?) : (.+?)"
  **/
-std::regex channelLineRegex(
-  ".*?CAP_LOG : P=(.+?) T=(.+?) CHANNEL-ID=(.+?) : (.+?) : VERBOSITY=(.+?) : (.+?)",
-  std::regex_constants::ECMAScript);
+struct ChannelLineFields {
+  std::string_view processId;
+  std::string_view threadId;
+  std::string_view channelId;
+  std::string_view enabled;
+  std::string_view verbosityLevel;
+  std::string_view channelName;
+};
+
+std::optional<ChannelLineFields> scanChannelLine(std::string_view line) {
+  LineScanner scanner(line);
+  ChannelLineFields fields;
+  if (scanner.skipPast("CAP_LOG : P=")
+      && scanner.captureUntil(" T=", fields.processId)
+      && scanner.captureUntil(" CHANNEL-ID=", fields.threadId)
+      && scanner.captureUntil(" : ", fields.channelId)
+      && scanner.captureUntil(" : VERBOSITY=", fields.enabled)
+      && scanner.captureUntil(" : ", fields.verbosityLevel)
+      && scanner.captureRest(fields.channelName, false)) {
+    return fields;
+  }
+  return std::nullopt;
+}
 
 /**
- * This will match all the logs:
+ * All the logs:
  * CAP_LOG_BLOCK, CAP_LOG_BLOCK_NO_THIS, CAP_LOG, CAP_LOG_ERROR, CAP_SET
- * the sub-expressions:
- * 0 - the full string
- * 1 - ProcessId
- * 2 - ThreadId
- * 3 - ChannelId
- * 4 - Indentation
- * 5 - Info String (everything after the prefix and Indentation marker)
+ * regex_match: ".*?CAP_LOG : P=(.+?) T=(.+?) C=(.+?) (.+?) (.*)"
+ * infoString is everything after the prefix and Indentation marker.
  **/
-std::regex logLineRegex(
-  ".*?CAP_LOG : P=(.+?) T=(.+?) C=(.+?) (.+?) (.*)",
-  std::regex_constants::ECMAScript);
+struct LogLineFields {
+  std::string_view processId;
+  std::string_view threadId;
+  std::string_view channelId;
+  std::string_view indentation;
+  std::string_view infoString;
+};
+
+std::optional<LogLineFields> scanLogLine(std::string_view line) {
+  LineScanner scanner(line);
+  LogLineFields fields;
+  if (scanner.skipPast("CAP_LOG : P=")
+      && scanner.captureUntil(" T=", fields.processId)
+      && scanner.captureUntil(" C=", fields.threadId)
+      && scanner.captureUntil(" ", fields.channelId)
+      && scanner.captureUntil(" ", fields.indentation)
+      && scanner.captureRest(fields.infoString, true)) {
+    return fields;
+  }
+  return std::nullopt;
+}
 
 /**
- * This will match the Info String (#5) from the logLineRegex
- * 1 - FunctionId
- * 2 - Line number in source code
- * 3 - Info string body; the remainder of the string.  Changes depending on log type.
+ * The Info String from the log line
+ * regex_match: "(.+?) (\\[.+?\\])(.*)"
+ * body is the remainder of the string.  Changes depending on log type.
  **/
-std::regex infoStringCommon(
-  "(.+?) (\\[.+?\\])(.*)",
-  std::regex_constants::ECMAScript);
+struct InfoStringCommonFields {
+  std::string_view functionId;
+  std::string_view sourceFileLine;
+  std::string_view body;
+};
+
+std::optional<InfoStringCommonFields> scanInfoStringCommon(std::string_view infoString) {
+  size_t bracketOpenPos = infoString.find(" [", 1);
+  if (bracketOpenPos == std::string_view::npos) {
+    return std::nullopt;
+  }
+  size_t sourceFileLinePos = bracketOpenPos + 1;
+  size_t bracketClosePos = infoString.find(']', sourceFileLinePos + 2);
+  if (bracketClosePos == std::string_view::npos) {
+    return std::nullopt;
+  }
+
+  InfoStringCommonFields fields;
+  fields.functionId = infoString.substr(0, bracketOpenPos);
+  fields.sourceFileLine = infoString.substr(sourceFileLinePos, bracketClosePos + 1 - sourceFileLinePos);
+  fields.body = infoString.substr(bracketClosePos + 1);
+  return fields;
+}
 
 /**
- * This will match the info string body if it's opening and closing block tags
+ * The info string body if it's opening and closing block tags
  * eg. ::[test.cpp]::[something::TestNetwork::TestNetwork()] 0x7ffecc005730
- * 0 - the full string
- * 1 - filename
- * 2 - Function name (may be truncated if too long)
- * 3 - The object id.  In c++ this is the "this" pointer (or 0 if none)
+ * regex_match: "::\\[(.*)\\]::\\[(.*)\\] ([0-9a-z]+)"
+ * functionName may be truncated if too long.  objectId is the "this" pointer in c++ (or 0 if none)
  **/
-std::regex infoStringBlockMatch(
-  "::\\[(.*)\\]::\\[(.*)\\] ([0-9a-z]+)",
-  std::regex_constants::ECMAScript);
+struct InfoStringBlockFields {
+  std::string_view filename;
+  std::string_view functionName;
+  std::string_view objectId;
+};
+
+std::optional<InfoStringBlockFields> scanInfoStringBlock(std::string_view body) {
+  constexpr std::string_view blockOpen = "::[";
+  constexpr std::string_view blockSeparator = "]::[";
+  if (body.substr(0, blockOpen.size()) != blockOpen) {
+    return std::nullopt;
+  }
+
+  // the object id can't hold a space, so it's whatever follows the last one.
+  size_t objectIdSpacePos = body.rfind(' ');
+  if (objectIdSpacePos == std::string_view::npos
+      || objectIdSpacePos < blockOpen.size() + 1
+      || objectIdSpacePos + 1 == body.size()
+      || body[objectIdSpacePos - 1] != ']') {
+    return std::nullopt;
+  }
+  std::string_view objectId = body.substr(objectIdSpacePos + 1);
+  for (char c : objectId) {
+    if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z'))) {
+      return std::nullopt;
+    }
+  }
+
+  // both names are greedy, so the filename ends at the last separator.
+  std::string_view names = body.substr(blockOpen.size(), objectIdSpacePos - 1 - blockOpen.size());
+  size_t separatorPos = names.rfind(blockSeparator);
+  if (separatorPos == std::string_view::npos) {
+    return std::nullopt;
+  }
+
+  InfoStringBlockFields fields;
+  fields.filename = names.substr(0, separatorPos);
+  fields.functionName = names.substr(separatorPos + blockSeparator.size());
+  fields.objectId = objectId;
+  return fields;
+}
 
 /**
- * This will match the opening and closing block tags
- * eg. ::[test.cpp]::[something::TestNetwork::TestNetwork()] 0x7ffecc005730
- * 0 - the full string
- * 1 - inner type: LOG/ERROR/SET
- * 2 - inner message
+ * The info string body if it's a line within a block
+ * eg.  LOG: Testing format = hello
+ * regex_match: " (.*?):(.*)"
+ * innerType is LOG/ERROR/SET
  **/
-std::regex infoStringInnerMatch(
-  " (.*?):(.*)",
-  std::regex_constants::ECMAScript);
+struct InfoStringInnerFields {
+  std::string_view innerType;
+  std::string_view innerMessage;
+};
+
+std::optional<InfoStringInnerFields> scanInfoStringInner(std::string_view body) {
+  if (body.empty() || body[0] != ' ') {
+    return std::nullopt;
+  }
+  size_t colonPos = body.find(':', 1);
+  if (colonPos == std::string_view::npos) {
+    return std::nullopt;
+  }
+
+  InfoStringInnerFields fields;
+  fields.innerType = body.substr(1, colonPos - 1);
+  fields.innerMessage = body.substr(colonPos + 1);
+  return fields;
+}
 
 enum class CapLineType {
   CAPLOG,
@@ -167,41 +352,79 @@ enum class CapLogInnerType {
   UNKNOWN,
 };
 
+// Views into WorldStateWorkingData::inputLine; only valid while that line is being processed.
 struct InputLogLine {
   CapLogType inputLineType = CapLogType::UNKNOWN;
   int inputLineDepth;
 
-  std::string inputFullString;
-  std::string inputProcessId;
-  std::string inputThreadId;
-  std::string inputChannelId;
-  std::string inputIndentation;
-  std::string inputFunctionId;
-  std::string inputSourceFileLine;
-  std::string inputInfoString;
+  std::string_view inputFullString;
+  std::string_view inputProcessId;
+  std::string_view inputThreadId;
+  std::string_view inputChannelId;
+  std::string_view inputIndentation;
+  std::string_view inputFunctionId;
+  std::string_view inputSourceFileLine;
+  std::string_view inputInfoString;
+
+  // complete lines only; the info string common part, then the rest of it by line type.
+  bool matchedInfoCommon = false;
+  std::optional<InfoStringBlockFields> inputBlock;
+  std::optional<InfoStringInnerFields> inputInner;
+};
+
+/**
+ * What a log line needs from the lines before it in the whole input, not just its own thread.
+ * Filled in by the in order pass (see resolveParsedLine) so that each thread's lines can then be
+ * replayed on their own.
+ **/
+struct ResolvedLogLine {
+  size_t inputFileLineNumber = 0;
+  // ids are handed out in the order processes and threads first show up.
+  size_t uniqueProcessId = 0;
+  size_t uniqueThreadId = 0;
+  // stack nodes are numbered in input order across all threads; this is the slot for the node the
+  // line adds, if it adds one.
+  size_t stackNodeIdx = 0;
+  // MAX-CHAR-SIZE of the process as of this line.
+  int characterLimit = 0;
+};
+
+/**
+ * A caplog line, parsed as far as it can be without looking at the lines before it.  Chunks of
+ * the input are parsed into these on worker threads, then resolved in order and replayed per
+ * thread to rebuild the stacks (see processChunk).
+ **/
+struct ParsedLine {
+  // which record of its chunk this line came from; for error messages.
+  size_t chunkRecordIndex = 0;
+  std::string_view line;
+  std::variant<std::monostate, InputLogLine, ChannelLineFields, MaxCharsLineFields> fields;
+  ResolvedLogLine resolved;
 };
 
+// The output text is views into the input, or into the thread's StackNodeArena for text that
+// isn't in the input as is.
 struct OutputLogTextCommon {
-  std::string channelId;
-  std::string indentation;
-  std::string functionId;
-  std::string sourceFileLine;
+  std::string_view channelId;
+  std::string_view indentation;
+  std::string_view functionId;
+  std::string_view sourceFileLine;
 };
 
 struct OutputLogTextBlock {
-  std::string filename;
-  std::string functionName;
-  std::string objectId;
+  std::string_view filename;
+  std::string_view functionName;
+  std::string_view objectId;
 };
 
 struct OutputLogTextMessage {
   // CapLogInnerType innerType; //may need later...
-  std::string innerTypeString; //x-macros this instead.
-  std::string innerPayload;
+  std::string_view innerTypeString; //x-macros this instead.
+  std::string_view innerPayload;
 };
 
 struct OutputLogData {
-  int lineDepth;
+  int lineDepth = 0;
   size_t uniqueProcessId;
   size_t uniqueThreadId;
 
@@ -214,11 +437,6 @@ struct OutputLogData {
 
   // logLineType = logs/error/set, if applicable
   OutputLogTextMessage messageText;
-
-  // incomplete string
-  bool isComplete = true;
-  std::string incompleteText;
-  std::string incompleteSpacePadding;
 };
 
 struct LoggedObject {
@@ -236,57 +454,90 @@ struct ChannelLine {
   std::string channelName;
 };
 
-// should rename this, this only represents CapLog types, not channels.
-struct StackNode {
-  StackNode(
-    int line, 
-    OutputLogData&& logData,
-    StackNode* caller)
-    : line(line)
-    , depth(std::move(logData.lineDepth))
-    , uniqueProcessId(std::move(logData.uniqueProcessId))
-    , uniqueThreadId(std::move(logData.uniqueThreadId))
-    , commonLogText(std::move(logData.commonLogText))
-    , logLineType(std::move(logData.logLineType))
-    , blockText(std::move(logData.blockText))
-    , messageText(std::move(logData.messageText))
-    , caller(caller)
-    , isComplete(logData.isComplete)
-    , incompleteString(std::move(logData.incompleteText))
-    , incompleteSpacePadding(std::move(logData.incompleteSpacePadding))
-    , loggedObject(nullptr) {}
-
-  const int line;
-  const int depth;
-  const size_t uniqueProcessId;
-  const size_t uniqueThreadId;
+// callerIdx of a stack node with no caller.
+constexpr const size_t noStackNode = std::numeric_limits<size_t>::max();
 
-  OutputLogTextCommon commonLogText;
-  CapLogType logLineType = CapLogType::UNKNOWN;
+/**
+ * One stack node, as references into the WorldState's columns (see WorldState).  For code that
+ * looks at whole nodes one at a time, like writing them out; a scan over many nodes should read
+ * the columns it needs instead.  Only valid while the WorldState's node count doesn't change.
+ **/
+struct StackNodeView {
+  const size_t line;
+  const int& depth;
+  const size_t& uniqueProcessId;
+  const size_t& uniqueThreadId;
+  const CapLogType& logLineType;
+  // index of the calling node, or noStackNode.
+  const size_t& callerIdx;
+
+  const OutputLogTextCommon& commonLogText;
   //logLineType = block open/close, if applicable
-  OutputLogTextBlock blockText;
+  const OutputLogTextBlock& blockText;
   // logLineType = logs/error/set, if applicable
-  OutputLogTextMessage messageText;
+  const OutputLogTextMessage& messageText;
+};
 
-  StackNode* caller;
-  
-  bool isComplete;
+/**
+ * Bump allocator for the text of one thread's stack nodes that isn't in the input as is (eg. the
+ * indentation, or a line joined from CONCAT pieces).  Nothing is freed until the arena is, and
+ * nothing moves as it grows, so the nodes can keep views of it.  Blocks start small and double,
+ * since most threads only log a little.
+ **/
+class StackNodeArena {
+public:
+  // uninitialized space for charCount chars; it's valid for as long as the arena is.
+  char* allocateChars(size_t charCount) {
+    if (mCharBlocks.empty() || mCharBlocks.back().used + charCount > mCharBlocks.back().capacity) {
+      size_t capacity = mCharBlocks.empty() ? firstCharBlockSize : std::min(mCharBlocks.back().capacity * 2, maxCharBlockSize);
+      capacity = std::max(capacity, charCount);
+      mCharBlocks.push_back(CharBlock{std::make_unique<char[]>(capacity), capacity, 0});
+    }
+    CharBlock& charBlock = mCharBlocks.back();
+    char* chars = charBlock.chars.get() + charBlock.used;
+    charBlock.used += charCount;
+    return chars;
+  }
+
+  std::string_view storeString(std::string_view string) {
+    char* chars = allocateChars(string.size());
+    std::memcpy(chars, string.data(), string.size());
+    return std::string_view(chars, string.size());
+  }
+
+private:
+  static constexpr const size_t firstCharBlockSize = 1024;
+  static constexpr const size_t maxCharBlockSize = 1024 * 1024;
+
+  struct CharBlock {
+    std::unique_ptr<char[]> chars;
+    size_t capacity;
+    size_t used;
+  };
 
-  std::string incompleteString;
-  std::string incompleteSpacePadding;
+  std::vector<CharBlock> mCharBlocks;
+};
 
-  LoggedObject* loggedObject;
+// The CONCAT pieces of a line, joined as they come in.  A thread only has one line in pieces at a
+// time.
+struct IncompleteLine {
+  std::string text;
+  std::string spacePadding;
 };
 
+/**
+ * Stack nodes are stored by column: one array per field, all indexed by the node's line.  Walking
+ * a thread's stack only touches the depth, type and caller columns, and nodes refer to their
+ * caller by index, so none of it is pointer chasing.  Use getStackNode for a view of one whole
+ * node.
+ **/
 class WorldState {
 public:
-  using StackNodeArray = std::vector<std::unique_ptr<StackNode>>;
   using ChannelArray = std::vector<std::unique_ptr<ChannelLine>>;
   using UniqueProcessIdToChannelArray = std::map<size_t, ChannelArray>;
 
   struct InPlace {
     size_t index;
-    StackNode* stackNode;
   };
 
   // should use expected, but that's only in c++23
@@ -310,47 +561,89 @@ public:
     return retLoggedObject;
   }
 
-  StackNode& addNewStackNode(
+  // Slots for stack nodes are made ahead of time, in input order, so that different threads'
+  // nodes can be added concurrently.  Only the thread a slot was reserved for may fill it in.
+  void reserveStackNodes(size_t stackNodeCount) {
+    if (stackNodeCount > mDepths.size()) {
+      mDepths.resize(stackNodeCount);
+      mUniqueProcessIds.resize(stackNodeCount);
+      mUniqueThreadIds.resize(stackNodeCount);
+      mLogLineTypes.resize(stackNodeCount, CapLogType::UNKNOWN);
+      mCallerIdxs.resize(stackNodeCount, noStackNode);
+      mCommonLogTexts.resize(stackNodeCount);
+      mBlockTexts.resize(stackNodeCount);
+      mMessageTexts.resize(stackNodeCount);
+    }
+  }
+
+  size_t addNewStackNode(
       OutputLogData&& logData,
-      StackNode* caller,
-      std::optional<InPlace> inPlace) {
+      size_t callerIdx,
+      std::optional<InPlace> inPlace,
+      size_t reservedStackNodeIdx) {
     CAP_LOG_BLOCK(CAP::CHANNEL::stackNode);
+    size_t stackNodeIdx;
     if (!inPlace) {
       CAP_LOG("NEW");
-      size_t stackNodeIdx = mStackNodeArray.size();
-      mStackNodeArray.emplace_back(std::make_unique<StackNode>(
-        stackNodeIdx, std::move(logData), caller));
-      mProcessToThreadToStackNodeIds[logData.uniqueProcessId][logData.uniqueThreadId].emplace_back(stackNodeIdx);
-      return *mStackNodeArray.back().get();
+      stackNodeIdx = reservedStackNodeIdx;
+      assert(stackNodeIdx < mLogLineTypes.size() && mLogLineTypes[stackNodeIdx] == CapLogType::UNKNOWN);
+      mProcessToThreadToStackNodes[logData.uniqueProcessId][logData.uniqueThreadId].stackNodeIds.emplace_back(stackNodeIdx);
     } else {
       CAP_LOG("inPlace");
-      size_t stackNodeIdx = inPlace.value().index;
-      mStackNodeArray[stackNodeIdx] = std::make_unique<StackNode>(
-        stackNodeIdx, std::move(logData), caller);
-      return *mStackNodeArray[stackNodeIdx].get();
+      stackNodeIdx = inPlace.value().index;
     }
+
+    mDepths[stackNodeIdx] = logData.lineDepth;
+    mUniqueProcessIds[stackNodeIdx] = logData.uniqueProcessId;
+    mUniqueThreadIds[stackNodeIdx] = logData.uniqueThreadId;
+    mLogLineTypes[stackNodeIdx] = logData.logLineType;
+    mCallerIdxs[stackNodeIdx] = callerIdx;
+    mCommonLogTexts[stackNodeIdx] = logData.commonLogText;
+    mBlockTexts[stackNodeIdx] = logData.blockText;
+    mMessageTexts[stackNodeIdx] = logData.messageText;
+    return stackNodeIdx;
+  }
+
+  size_t getStackNodeCount() const {
+    return mDepths.size();
   }
 
-  StackNode* getStackNodeOnLine(size_t lineNumber) {
-    if (lineNumber < mStackNodeArray.size()) {
-      return mStackNodeArray[lineNumber].get();
+  StackNodeView getStackNode(size_t stackNodeIdx) const {
+    return StackNodeView{
+      stackNodeIdx,
+      mDepths[stackNodeIdx],
+      mUniqueProcessIds[stackNodeIdx],
+      mUniqueThreadIds[stackNodeIdx],
+      mLogLineTypes[stackNodeIdx],
+      mCallerIdxs[stackNodeIdx],
+      mCommonLogTexts[stackNodeIdx],
+      mBlockTexts[stackNodeIdx],
+      mMessageTexts[stackNodeIdx]};
+  }
+
+  std::optional<StackNodeView> getStackNodeOnLine(size_t lineNumber) const {
+    if (lineNumber < getStackNodeCount()) {
+      return getStackNode(lineNumber);
     } else {
-      return nullptr;
+      return std::nullopt;
     }
   }
 
-  std::tuple<size_t, StackNode*> getLastStackNodeForProcessThread(size_t uniqueProcessId, size_t uniqueThreadId) {
-    assert(mProcessToThreadToStackNodeIds.size() > uniqueProcessId);
-    assert(mProcessToThreadToStackNodeIds[uniqueProcessId].size() > uniqueThreadId);
-    if (!mProcessToThreadToStackNodeIds[uniqueProcessId][uniqueThreadId].empty()) {
-      size_t stackNodeIdx = mProcessToThreadToStackNodeIds[uniqueProcessId][uniqueThreadId].back();
-      return std::tuple<size_t, StackNode*>(stackNodeIdx, mStackNodeArray[stackNodeIdx].get());
-    }
-    return std::tuple<size_t, StackNode*>(0, nullptr);
+  // the last node added for a thread, or noStackNode.
+  size_t getLastStackNodeForProcessThread(size_t uniqueProcessId, size_t uniqueThreadId) const {
+    assert(mProcessToThreadToStackNodes.size() > uniqueProcessId);
+    assert(mProcessToThreadToStackNodes[uniqueProcessId].size() > uniqueThreadId);
+    const IdxArray& stackNodeIds = mProcessToThreadToStackNodes[uniqueProcessId][uniqueThreadId].stackNodeIds;
+    return stackNodeIds.empty() ? noStackNode : stackNodeIds.back();
+  }
+
+  // Only the thread replaying uniqueThreadId may use its arena and incomplete line.
+  StackNodeArena& getStackNodeArena(size_t uniqueProcessId, size_t uniqueThreadId) {
+    return mProcessToThreadToStackNodes[uniqueProcessId][uniqueThreadId].arena;
   }
 
-  const StackNodeArray& getNodeArray() const {
-    return mStackNodeArray;
+  IncompleteLine& getIncompleteLine(size_t uniqueProcessId, size_t uniqueThreadId) {
+    return mProcessToThreadToStackNodes[uniqueProcessId][uniqueThreadId].incompleteLine;
   }
 
   ChannelLine& pushChannelLine(ChannelLine&& channelLine) {
@@ -363,14 +656,14 @@ public:
   }
 
   size_t newUniqueProcessId() {
-    auto retVal = mProcessToThreadToStackNodeIds.size();
-    mProcessToThreadToStackNodeIds.emplace_back();
+    auto retVal = mProcessToThreadToStackNodes.size();
+    mProcessToThreadToStackNodes.emplace_back();
     return retVal;
   }
 
   size_t newUniqueThreadId(size_t uniqueProcessId) {
-    auto retVal = mProcessToThreadToStackNodeIds[uniqueProcessId].size();
-    mProcessToThreadToStackNodeIds[uniqueProcessId].emplace_back();
+    auto retVal = mProcessToThreadToStackNodes[uniqueProcessId].size();
+    mProcessToThreadToStackNodes[uniqueProcessId].emplace_back();
     return retVal;
   }
 
@@ -379,11 +672,24 @@ private:
 
   UniqueProcessIdToChannelArray mUniqueProcessIdToChannelArray;
 
-  StackNodeArray mStackNodeArray;
+  // the stack node columns; all the same size.
+  std::vector<int> mDepths;
+  std::vector<size_t> mUniqueProcessIds;
+  std::vector<size_t> mUniqueThreadIds;
+  std::vector<CapLogType> mLogLineTypes;
+  std::vector<size_t> mCallerIdxs;
+  std::vector<OutputLogTextCommon> mCommonLogTexts;
+  std::vector<OutputLogTextBlock> mBlockTexts;
+  std::vector<OutputLogTextMessage> mMessageTexts;
 
   using IdxArray = std::vector<size_t>;
-  using ProcessToThreadToStackNodeIds = std::vector<std::vector<IdxArray>>;
-  ProcessToThreadToStackNodeIds mProcessToThreadToStackNodeIds;
+  struct ThreadStackNodes {
+    IdxArray stackNodeIds;
+    StackNodeArena arena;
+    IncompleteLine incompleteLine;
+  };
+  using ProcessToThreadToStackNodes = std::vector<std::vector<ThreadStackNodes>>;
+  ProcessToThreadToStackNodes mProcessToThreadToStackNodes;
 };
 
 
@@ -391,7 +697,7 @@ class WorldStateWorkingData {
 public: 
   // tracks what we've read so far in the file.
   size_t intputFileLineNumber = 0;
-  std::string inputLine;
+  std::string_view inputLine;
   
   // out lines don't line up with the input fiels for two reasons:
   // 1 - we filter out any non-cap-log messages
@@ -402,18 +708,24 @@ public:
   CapLineType lineType;
 
   // maybe use variants on this to better select the right type
-  std::unique_ptr<InputLogLine> inputLogLine;
+  InputLogLine inputLogLine;
   std::unique_ptr<OutputLogData> outputLogData;
-  StackNode* prevStackNode = nullptr;
+  size_t prevStackNodeIdx = noStackNode;
 
   // todo channel types.
   std::unique_ptr<ChannelLine> channelLine;
 
   std::optional<WorldState::InPlace> inPlace;
 
+  // the log line being replayed.
+  ResolvedLogLine resolvedLogLine;
+
+  // everything below is only used by the in order pass.
   std::unordered_map<size_t, int> uniqueProcessIdToMaxCharLine;
 
-  size_t getUniqueProcessIdForInputProcessId(const std::string& inputProcessId, WorldState& world) {
+  size_t getUniqueProcessIdForInputProcessId(std::string_view inputProcessIdView, WorldState& world) {
+    // process and thread ids are short enough to stay in the small string buffer.
+    const std::string inputProcessId(inputProcessIdView);
     size_t retId;
     if (auto findUniqueProcessIdIter = mProcessToUniqueProcessId.find(inputProcessId); 
         findUniqueProcessIdIter != mProcessToUniqueProcessId.end()) {
@@ -428,7 +740,8 @@ public:
     return retId;
   }
 
-  size_t getUniqueThreadIdForInputThreadId(size_t uniqueProcessId, const std::string& inputThreadId, WorldState& world) {
+  size_t getUniqueThreadIdForInputThreadId(size_t uniqueProcessId, std::string_view inputThreadIdView, WorldState& world) {
+    const std::string inputThreadId(inputThreadIdView);
     size_t retId;
     if (auto findThreadMapIter = mUniqueProcessIdToInputThreadToUniqueThreadId.find(uniqueProcessId);
         findThreadMapIter != mUniqueProcessIdToInputThreadToUniqueThreadId.end()) {
@@ -453,10 +766,6 @@ private:
   std::unordered_map<size_t, std::unordered_map<std::string, size_t>> mUniqueProcessIdToInputThreadToUniqueThreadId;
 };
 
-struct OutputState {
-  std::ofstream outputFileStream;
-};
-
 void failWithAbort(const WorldStateWorkingData& workingData, std::string additionalInfo = "") {
   std::cerr << "FAILED TO PROCESS LINE" << std::endl;
   std::cerr << "line(" << workingData.intputFileLineNumber << "): "
@@ -467,20 +776,20 @@ void failWithAbort(const WorldStateWorkingData& workingData, std::string additio
 
 // TODO make ostream<< for stack node
 
-CapLogType getLineType(const std::string& inputIndentation) {
+CapLogType getLineType(std::string_view inputIndentation) {
   CapLogType retType = CapLogType::UNKNOWN;
-  std::smatch match;
-  if (std::regex_match(inputIndentation, match, std::regex(".*F"))) {
+  char lastChar = inputIndentation.empty() ? '\0' : inputIndentation.back();
+  if (lastChar == 'F') {
     retType = CapLogType::BLOCK_SCOPE_OPEN;
-  } else if (std::regex_match (inputIndentation, match, std::regex(".*L"))) {
+  } else if (lastChar == 'L') {
     retType = CapLogType::BLOCK_SCOPE_CLOSE;
-  } else if (std::regex_match (inputIndentation, match, std::regex(".*>"))) {
+  } else if (lastChar == '>') {
     retType = CapLogType::BLOCK_INNER_LINE;
-  } else if (std::regex_match (inputIndentation, match, std::regex("\\|\\+"))) {
+  } else if (inputIndentation == "|+") {
     retType = CapLogType::BLOCK_CONCAT_BEGIN;
-  } else if (std::regex_match (inputIndentation, match, std::regex("\\+\\+"))) {
+  } else if (inputIndentation == "++") {
     retType = CapLogType::BLOCK_CONCAT_CONTINUE;
-  } else if (std::regex_match (inputIndentation, match, std::regex("\\+\\|"))) {
+  } else if (inputIndentation == "+|") {
     retType = CapLogType::BLOCK_CONCAT_END;
   }
 
@@ -489,82 +798,96 @@ CapLogType getLineType(const std::string& inputIndentation) {
   return retType;
 }
 
-int getLineDepth(const std::string& inputIndentation) {
+int getLineDepth(std::string_view inputIndentation) {
   int retVal = inputIndentation.size();
   // std::cout << retVal << std::endl;
   return retVal;
 }
 
-std::string replaceIndentationChars (std::string inputIndentation) {
-  inputIndentation = std::regex_replace(inputIndentation, std::regex(":"), "║");
-  inputIndentation = std::regex_replace(inputIndentation, std::regex("F"), "╔");
-  inputIndentation = std::regex_replace(inputIndentation, std::regex("L"), "╚");
-  inputIndentation = std::regex_replace(inputIndentation, std::regex("-"), "╠");
-  inputIndentation = std::regex_replace(inputIndentation, std::regex(">"), "╾");
-  // std::cout << inputIndentation << std::endl;
+// written straight into the arena, so there's no temporary string per line.
+std::string_view replaceIndentationChars (std::string_view inputIndentation, StackNodeArena& arena) {
+  // each box drawing char is 3 bytes of utf-8
+  char* outputIndentation = arena.allocateChars(inputIndentation.size() * 3);
+  size_t outputSize = 0;
+  auto append = [&](std::string_view chars) {
+    std::memcpy(outputIndentation + outputSize, chars.data(), chars.size());
+    outputSize += chars.size();
+  };
+  for (char c : inputIndentation) {
+    switch (c) {
+      case ':': append("║"); break;
+      case 'F': append("╔"); break;
+      case 'L': append("╚"); break;
+      case '-': append("╠"); break;
+      case '>': append("╾"); break;
+      default: append(std::string_view(&c, 1));
+    }
+  }
+  // std::cout << std::string_view(outputIndentation, outputSize) << std::endl;
 
-  return inputIndentation;
+  return std::string_view(outputIndentation, outputSize);
 }
 
 void processIncompleteLineBegin (
     WorldStateWorkingData& workingData, 
     WorldState& worldState) {
-  CAP_LOG_BLOCK_NO_THIS(CAP::CHANNEL::processIncompleteLineBegin, "%s", workingData.inputLine.c_str());
-  InputLogLine& inputLogLine = *workingData.inputLogLine.get();
+  CAP_LOG_BLOCK_NO_THIS(CAP::CHANNEL::processIncompleteLineBegin, "%.*s", (int)workingData.inputLine.size(), workingData.inputLine.data());
+  InputLogLine& inputLogLine = workingData.inputLogLine;
   OutputLogData& outputLogData = *workingData.outputLogData.get();
+  IncompleteLine& incompleteLine = worldState.getIncompleteLine(outputLogData.uniqueProcessId, outputLogData.uniqueThreadId);
 
-  outputLogData.isComplete = false;
-  outputLogData.incompleteText = inputLogLine.inputInfoString;
+  incompleteLine.text = inputLogLine.inputInfoString;
 
-  int characterLimit = workingData.uniqueProcessIdToMaxCharLine[outputLogData.uniqueProcessId];
+  int characterLimit = workingData.resolvedLogLine.characterLimit;
 
   std::string padding;
-  CAP_LOG("inputLogLine.inputFullString = %s", inputLogLine.inputFullString.c_str());
+  CAP_LOG("inputLogLine.inputFullString = %.*s", (int)inputLogLine.inputFullString.size(), inputLogLine.inputFullString.data());
   CAP_LOG("inputLogLine.inputFullString.size() = %zu", inputLogLine.inputFullString.size());
   CAP_LOG("characterLimit = %d", characterLimit);
   for(int i = inputLogLine.inputFullString.size(); i < characterLimit; i++) {
     padding += " ";
   }
-  outputLogData.incompleteSpacePadding += padding;
-  CAP_LOG("outputLogData.incompleteSpacePadding = |%s|", outputLogData.incompleteSpacePadding.c_str());
+  incompleteLine.spacePadding = padding;
+  CAP_LOG("incompleteLine.spacePadding = |%s|", incompleteLine.spacePadding.c_str());
 
-  CAP_LOG("processIncompleteLineBeing infoString: %s", outputLogData.incompleteText.c_str());
-  worldState.addNewStackNode(std::move(outputLogData), workingData.prevStackNode, workingData.inPlace);
+  CAP_LOG("processIncompleteLineBeing infoString: %s", incompleteLine.text.c_str());
+  worldState.addNewStackNode(std::move(outputLogData), workingData.prevStackNodeIdx, workingData.inPlace, workingData.resolvedLogLine.stackNodeIdx);
 }
 
 void processIncompleteLineContinue (
     WorldStateWorkingData& workingData, 
-    [[maybe_unused]] WorldState& worldState) {
-  CAP_LOG_BLOCK_NO_THIS(CAP::CHANNEL::processIncompleteLineContinue, "%s", workingData.inputLine.c_str());
-  InputLogLine& inputLogLine = *workingData.inputLogLine.get();
+    WorldState& worldState) {
+  CAP_LOG_BLOCK_NO_THIS(CAP::CHANNEL::processIncompleteLineContinue, "%.*s", (int)workingData.inputLine.size(), workingData.inputLine.data());
+  InputLogLine& inputLogLine = workingData.inputLogLine;
   OutputLogData& outputLogData = *workingData.outputLogData.get();
+  IncompleteLine& incompleteLine = worldState.getIncompleteLine(outputLogData.uniqueProcessId, outputLogData.uniqueThreadId);
 
-  CAP_LOG("padding = |%s|", workingData.prevStackNode->incompleteSpacePadding.c_str());
-  CAP_LOG("incomplete string before: %s", workingData.prevStackNode->incompleteString.c_str());
+  CAP_LOG("padding = |%s|", incompleteLine.spacePadding.c_str());
+  CAP_LOG("incomplete string before: %s", incompleteLine.text.c_str());
 
-  workingData.prevStackNode->incompleteString += workingData.prevStackNode->incompleteSpacePadding;
-  workingData.prevStackNode->incompleteString += inputLogLine.inputInfoString;
+  incompleteLine.text += incompleteLine.spacePadding;
+  incompleteLine.text += inputLogLine.inputInfoString;
 
-  CAP_LOG("incomplete string after: %s", workingData.prevStackNode->incompleteString.c_str());
+  CAP_LOG("incomplete string after: %s", incompleteLine.text.c_str());
 
-  int characterLimit = workingData.uniqueProcessIdToMaxCharLine[outputLogData.uniqueProcessId];
+  int characterLimit = workingData.resolvedLogLine.characterLimit;
   CAP_LOG("characterLimit = %d", characterLimit);
 
   std::string padding;
-  CAP_LOG("inputLogLine.inputFullString = %s", inputLogLine.inputFullString.c_str());
+  CAP_LOG("inputLogLine.inputFullString = %.*s", (int)inputLogLine.inputFullString.size(), inputLogLine.inputFullString.data());
   CAP_LOG("inputLogLine.inputFullString.size() = %zu", inputLogLine.inputFullString.size());
   for(int i = inputLogLine.inputFullString.size(); i < characterLimit; i++) {
     padding += " ";
   }
-  workingData.prevStackNode->incompleteSpacePadding = padding;
-  CAP_LOG("outputLogData.incompleteSpacePadding = |%s|", outputLogData.incompleteSpacePadding.c_str());
+  incompleteLine.spacePadding = padding;
+  CAP_LOG("incompleteLine.spacePadding = |%s|", incompleteLine.spacePadding.c_str());
 }
 
 void processBlockScopeOpen (
     WorldStateWorkingData& workingData, 
     WorldState& worldState) {
-  CAP_LOG_BLOCK_NO_THIS(CAP::CHANNEL::processBlockScopeOpen, "%s", workingData.inputLine.c_str());
-  InputLogLine& inputLogLine = *workingData.inputLogLine.get();
+  CAP_LOG_BLOCK_NO_THIS(CAP::CHANNEL::processBlockScopeOpen, "%.*s", (int)workingData.inputLine.size(), workingData.inputLine.data());
+  InputLogLine& inputLogLine = workingData.inputLogLine;
   OutputLogData& outputLogData = *workingData.outputLogData.get();
 
   int selfDepth = inputLogLine.inputLineDepth;
@@ -572,16 +895,17 @@ void processBlockScopeOpen (
 
   // determine expected depth first, then do fix up if necessary
   // then get the caller node (which might be newly created)
-  if (workingData.prevStackNode) {
-    switch (workingData.prevStackNode->logLineType) {
+  if (workingData.prevStackNodeIdx != noStackNode) {
+    const StackNodeView prevStackNode = worldState.getStackNode(workingData.prevStackNodeIdx);
+    switch (prevStackNode.logLineType) {
       case CapLogType::BLOCK_SCOPE_OPEN:
-        expectedSelfDepth = workingData.prevStackNode->depth + 1;
+        expectedSelfDepth = prevStackNode.depth + 1;
         break;
       case CapLogType::BLOCK_INNER_LINE:
-        expectedSelfDepth = workingData.prevStackNode->depth;
+        expectedSelfDepth = prevStackNode.depth;
         break;
       case CapLogType::BLOCK_SCOPE_CLOSE:
-        expectedSelfDepth = workingData.prevStackNode->depth;
+        expectedSelfDepth = prevStackNode.depth;
         break;
       case CapLogType::BLOCK_CONCAT_BEGIN:
       case CapLogType::BLOCK_CONCAT_CONTINUE:
@@ -604,45 +928,44 @@ void processBlockScopeOpen (
     failWithAbort(workingData, "selfDepth != expectedSelfDepth || expectedSelfDepth < 1");
   }
 
-  StackNode* callerStackNode = nullptr;
-  if (workingData.prevStackNode) {
-    switch (workingData.prevStackNode->logLineType) {
+  size_t callerStackNodeIdx = noStackNode;
+  if (workingData.prevStackNodeIdx != noStackNode) {
+    const StackNodeView prevStackNode = worldState.getStackNode(workingData.prevStackNodeIdx);
+    switch (prevStackNode.logLineType) {
       case CapLogType::BLOCK_SCOPE_OPEN:
         // intentional fall-through
       case CapLogType::BLOCK_INNER_LINE:
-        callerStackNode = workingData.prevStackNode;
+        callerStackNodeIdx = workingData.prevStackNodeIdx;
         break;
       case CapLogType::BLOCK_SCOPE_CLOSE:
-        callerStackNode = workingData.prevStackNode->caller;
+        callerStackNodeIdx = prevStackNode.callerIdx;
         break;
       default:
         failWithAbort(workingData, "processBlockScopeOpen can't determine prev logline type");
     }
   } else {
-    callerStackNode = nullptr;
+    callerStackNodeIdx = noStackNode;
   }
 
-  CAP_LOG("info string: %s", workingData.inputLogLine->inputInfoString.c_str());
+  CAP_LOG("info string: %.*s", (int)inputLogLine.inputInfoString.size(), inputLogLine.inputInfoString.data());
 
-  std::smatch piecesMatch;
-  bool matched = std::regex_match(workingData.inputLogLine->inputInfoString, piecesMatch, infoStringBlockMatch);
-  if(matched) {
+  if (const auto& blockFields = inputLogLine.inputBlock) {
     // TODO: Should move this into a similar "input" struct like the initial log line.
-    outputLogData.blockText.filename = piecesMatch[1];
-    outputLogData.blockText.functionName = piecesMatch[2];
-    outputLogData.blockText.objectId = piecesMatch[3];
+    outputLogData.blockText.filename = blockFields->filename;
+    outputLogData.blockText.functionName = blockFields->functionName;
+    outputLogData.blockText.objectId = blockFields->objectId;
   } else {
     failWithAbort(workingData, "Unable to match infoStringBlockMatch with expected block opening line");
   }
 
-  worldState.addNewStackNode(std::move(outputLogData), callerStackNode, workingData.inPlace);
+  worldState.addNewStackNode(std::move(outputLogData), callerStackNodeIdx, workingData.inPlace, workingData.resolvedLogLine.stackNodeIdx);
 }
 
 void processBlockScopeClose (
     WorldStateWorkingData& workingData, 
     WorldState& worldState) {
-  CAP_LOG_BLOCK_NO_THIS(CAP::CHANNEL::processBlockScopeClose, "%s", workingData.inputLine.c_str());
-  InputLogLine& inputLogLine = *workingData.inputLogLine.get();
+  CAP_LOG_BLOCK_NO_THIS(CAP::CHANNEL::processBlockScopeClose, "%.*s", (int)workingData.inputLine.size(), workingData.inputLine.data());
+  InputLogLine& inputLogLine = workingData.inputLogLine;
   OutputLogData& outputLogData = *workingData.outputLogData.get();
 
   int selfDepth = inputLogLine.inputLineDepth;
@@ -650,16 +973,17 @@ void processBlockScopeClose (
 
   // determine expected depth first, then do fix up if necessary
   // then get the caller node (which might be newly created)
-  if (workingData.prevStackNode) {
-    switch (workingData.prevStackNode->logLineType) {
+  if (workingData.prevStackNodeIdx != noStackNode) {
+    const StackNodeView prevStackNode = worldState.getStackNode(workingData.prevStackNodeIdx);
+    switch (prevStackNode.logLineType) {
       case CapLogType::BLOCK_SCOPE_OPEN:
-        expectedSelfDepth = workingData.prevStackNode->depth;
+        expectedSelfDepth = prevStackNode.depth;
         break;
       case CapLogType::BLOCK_INNER_LINE:
-        expectedSelfDepth = workingData.prevStackNode->depth - 1;
+        expectedSelfDepth = prevStackNode.depth - 1;
         break;
       case CapLogType::BLOCK_SCOPE_CLOSE:
-        expectedSelfDepth = workingData.prevStackNode->depth - 1;
+        expectedSelfDepth = prevStackNode.depth - 1;
         break;
       case CapLogType::BLOCK_CONCAT_BEGIN:
       case CapLogType::BLOCK_CONCAT_CONTINUE:
@@ -682,46 +1006,45 @@ void processBlockScopeClose (
     failWithAbort(workingData, "selfDepth != expectedSelfDepth || expectedSelfDepth < 1");
   }
 
-  StackNode* callerStackNode = nullptr;
-  if (workingData.prevStackNode) {
-    switch (workingData.prevStackNode->logLineType) {
+  size_t callerStackNodeIdx = noStackNode;
+  if (workingData.prevStackNodeIdx != noStackNode) {
+    const StackNodeView prevStackNode = worldState.getStackNode(workingData.prevStackNodeIdx);
+    switch (prevStackNode.logLineType) {
       case CapLogType::BLOCK_SCOPE_OPEN:
         // intentional fall-through
       case CapLogType::BLOCK_INNER_LINE:
-        callerStackNode = workingData.prevStackNode->caller;
+        callerStackNodeIdx = prevStackNode.callerIdx;
         break;
       case CapLogType::BLOCK_SCOPE_CLOSE:
-        if (workingData.prevStackNode->caller == nullptr) {
+        if (prevStackNode.callerIdx == noStackNode) {
           failWithAbort(workingData, "workingData.prevStackNode->caller == nullptr");
         }
-        callerStackNode = workingData.prevStackNode->caller->caller;
+        callerStackNodeIdx = worldState.getStackNode(prevStackNode.callerIdx).callerIdx;
         break;
       default:
         failWithAbort(workingData, "processBlockScopeClose can't determine prev logline type");
     }
   } else {
-    callerStackNode = nullptr;
+    callerStackNodeIdx = noStackNode;
   }
 
-  std::smatch piecesMatch;
-  bool matched = std::regex_match(workingData.inputLogLine->inputInfoString, piecesMatch, infoStringBlockMatch);
-  if(matched) {
+  if (const auto& blockFields = inputLogLine.inputBlock) {
     // TODO: Should move this into a similar "input" struct like the initial log line.
-    outputLogData.blockText.filename = piecesMatch[1];
-    outputLogData.blockText.functionName = piecesMatch[2];
-    outputLogData.blockText.objectId = piecesMatch[3];
+    outputLogData.blockText.filename = blockFields->filename;
+    outputLogData.blockText.functionName = blockFields->functionName;
+    outputLogData.blockText.objectId = blockFields->objectId;
   } else {
     failWithAbort(workingData, "processBlockScopeClose Unable to match infoStringBlockMatch with expected block opening line");
   }
 
-  worldState.addNewStackNode(std::move(outputLogData), callerStackNode, workingData.inPlace);
+  worldState.addNewStackNode(std::move(outputLogData), callerStackNodeIdx, workingData.inPlace, workingData.resolvedLogLine.stackNodeIdx);
 }
 
 void processBlockInnerLine (
     WorldStateWorkingData& workingData, 
     WorldState& worldState) {
-  CAP_LOG_BLOCK_NO_THIS(CAP::CHANNEL::processBlockInnerLine, "%s", workingData.inputLine.c_str());
-  InputLogLine& inputLogLine = *workingData.inputLogLine.get();
+  CAP_LOG_BLOCK_NO_THIS(CAP::CHANNEL::processBlockInnerLine, "%.*s", (int)workingData.inputLine.size(), workingData.inputLine.data());
+  InputLogLine& inputLogLine = workingData.inputLogLine;
   OutputLogData& outputLogData = *workingData.outputLogData.get();
 
   int selfDepth = inputLogLine.inputLineDepth;
@@ -729,16 +1052,17 @@ void processBlockInnerLine (
 
   // determine expected depth first, then do fix up if necessary
   // then get the caller node (which might be newly created)
-  if (workingData.prevStackNode) {
-    switch (workingData.prevStackNode->logLineType) {
+  if (workingData.prevStackNodeIdx != noStackNode) {
+    const StackNodeView prevStackNode = worldState.getStackNode(workingData.prevStackNodeIdx);
+    switch (prevStackNode.logLineType) {
       case CapLogType::BLOCK_SCOPE_OPEN:
-        expectedSelfDepth = workingData.prevStackNode->depth + 1;
+        expectedSelfDepth = prevStackNode.depth + 1;
         break;
       case CapLogType::BLOCK_INNER_LINE:
-        expectedSelfDepth = workingData.prevStackNode->depth;
+        expectedSelfDepth = prevStackNode.depth;
         break;
       case CapLogType::BLOCK_SCOPE_CLOSE:
-        expectedSelfDepth = workingData.prevStackNode->depth;
+        expectedSelfDepth = prevStackNode.depth;
         break;
       case CapLogType::BLOCK_CONCAT_BEGIN:
       case CapLogType::BLOCK_CONCAT_CONTINUE:
@@ -761,237 +1085,473 @@ void processBlockInnerLine (
     failWithAbort(workingData, "selfDepth != expectedSelfDepth || expectedSelfDepth < 1");
   }
 
-  StackNode* callerStackNode = nullptr;
-  if (workingData.prevStackNode) {
-    switch (workingData.prevStackNode->logLineType) {
+  size_t callerStackNodeIdx = noStackNode;
+  if (workingData.prevStackNodeIdx != noStackNode) {
+    const StackNodeView prevStackNode = worldState.getStackNode(workingData.prevStackNodeIdx);
+    switch (prevStackNode.logLineType) {
       case CapLogType::BLOCK_SCOPE_OPEN:
         // intentional fall-through
       case CapLogType::BLOCK_INNER_LINE:
-        callerStackNode = workingData.prevStackNode->caller;
+        callerStackNodeIdx = prevStackNode.callerIdx;
         break;
       case CapLogType::BLOCK_SCOPE_CLOSE:
-        if (workingData.prevStackNode->caller == nullptr) {
+        if (prevStackNode.callerIdx == noStackNode) {
           failWithAbort(workingData, "workingData.prevStackNode->caller == nullptr");
         }
-        callerStackNode = workingData.prevStackNode->caller->caller;
+        callerStackNodeIdx = worldState.getStackNode(prevStackNode.callerIdx).callerIdx;
         break;
       default:
         failWithAbort(workingData, "processBlockInnerLine can't determine prev logline type");
     }
   } else {
-    callerStackNode = nullptr;
+    callerStackNodeIdx = noStackNode;
   }
 
-  std::smatch piecesMatch;
-  bool matched = std::regex_match(workingData.inputLogLine->inputInfoString, piecesMatch, infoStringInnerMatch);
-  if(matched) {
+  if (const auto& innerFields = inputLogLine.inputInner) {
     // TODO: Should move this into a similar "input" struct like the initial log line.
-    // outputLogData.messageText.innerType = piecesMatch[1];
-    outputLogData.messageText.innerTypeString = piecesMatch[1];
-    outputLogData.messageText.innerPayload = piecesMatch[2];
+    // outputLogData.messageText.innerType = innerFields->innerType;
+    outputLogData.messageText.innerTypeString = innerFields->innerType;
+    outputLogData.messageText.innerPayload = innerFields->innerMessage;
   } else {
     failWithAbort(workingData, "processBlockInnerLine Unable to match infoStringBlockMatch with expected block opening line");
   }
 
-  worldState.addNewStackNode(std::move(outputLogData), callerStackNode, workingData.inPlace);
+  worldState.addNewStackNode(std::move(outputLogData), callerStackNodeIdx, workingData.inPlace, workingData.resolvedLogLine.stackNodeIdx);
 }
 
-bool processLogLine(
-    WorldStateWorkingData& workingData, 
-    WorldState& worldState) {
-  std::smatch piecesMatch;
-  CAP_LOG_BLOCK_NO_THIS(CAP::CHANNEL::processLogLine, "%s", workingData.inputLine.c_str());
-  bool matched = std::regex_match (workingData.inputLine, piecesMatch, logLineRegex);
-  if (matched) {
-    CAP_LOG("Matched 1:%s 2:%s 3:%s 4:%s 5:%s", 
-      piecesMatch[1].str().c_str(),
-      piecesMatch[2].str().c_str(),
-      piecesMatch[3].str().c_str(),
-      piecesMatch[4].str().c_str(),
-      piecesMatch[5].str().c_str());
-
-    workingData.lineType = CapLineType::CAPLOG;
-    workingData.inputLogLine = std::make_unique<InputLogLine>();
-    workingData.outputLogData = std::make_unique<OutputLogData>();
-    InputLogLine& inputLogLine = *workingData.inputLogLine.get();
-    OutputLogData& outputLogData = *workingData.outputLogData.get();
-
-    // structured bindings don't work for regex match :(
-    // cannot decompose inaccessible member ‘std::__cxx11::match_results<__gnu_cxx::__normal_iterator<...
-    inputLogLine.inputFullString = piecesMatch[0];
-    inputLogLine.inputProcessId = piecesMatch[1];
-    inputLogLine.inputThreadId = piecesMatch[2];
-    inputLogLine.inputChannelId = piecesMatch[3];
-    inputLogLine.inputIndentation = piecesMatch[4];
-    inputLogLine.inputInfoString = piecesMatch[5];
-
+// Everything here only depends on the line itself, so it's safe to run on any thread.
+ParsedLine parseCaplogLine(std::string_view line) {
+  ParsedLine parsedLine;
+  parsedLine.line = line;
+
+  if (std::optional<LogLineFields> logLineFields = scanLogLine(line)) {
+    InputLogLine inputLogLine;
+    inputLogLine.inputFullString = line;
+    inputLogLine.inputProcessId = logLineFields->processId;
+    inputLogLine.inputThreadId = logLineFields->threadId;
+    inputLogLine.inputChannelId = logLineFields->channelId;
+    inputLogLine.inputIndentation = logLineFields->indentation;
+    inputLogLine.inputInfoString = logLineFields->infoString;
     inputLogLine.inputLineType = getLineType(inputLogLine.inputIndentation);
-    outputLogData.uniqueProcessId = workingData.getUniqueProcessIdForInputProcessId(inputLogLine.inputProcessId, worldState);
-    outputLogData.uniqueThreadId = workingData.getUniqueThreadIdForInputThreadId(outputLogData.uniqueProcessId, inputLogLine.inputThreadId, worldState);
-    outputLogData.logLineType = inputLogLine.inputLineType;
-
-    // inputLogLine.inputLineDepth can resolve to a block open/close or inner log/error/set
-    auto&& [prevStackNodeIdx, prevStackNode] = worldState.getLastStackNodeForProcessThread(outputLogData.uniqueProcessId,
-                                                                                          outputLogData.uniqueThreadId);
-    workingData.prevStackNode = prevStackNode;
-
-    if (workingData.inPlace) {
-      if (workingData.inPlace.value().stackNode != prevStackNode) {
-        failWithAbort(workingData, "AFTER INCOMPLETE LINE: workingData.inPlace.stackNode != prevStackNode");
-      } else if (workingData.inPlace.value().index != prevStackNodeIdx) {
-        failWithAbort(workingData, "AFTER INCOMPLETE LINE: workingData.inPlace.index != prevStackNodeIdx");
-      } else if (workingData.inPlace.value().stackNode->uniqueProcessId != outputLogData.uniqueProcessId) {
-        failWithAbort(workingData, "AFTER INCOMPLETE LINE: workingData.inPlace.value().stackNode->uniqueProcessId != outputLogData.uniqueProcessId");
-      } else if (workingData.inPlace.value().stackNode->uniqueThreadId != outputLogData.uniqueThreadId) {
-        failWithAbort(workingData, "AFTER INCOMPLETE LINE: workingData.inPlace.value().stackNode->uniqueThreadId != outputLogData.uniqueThreadId");
-      }
 
-      // since the "last stack node" in this case is the inplace one we're modifying, we need to set the previous stack node to it's previous.
-      workingData.prevStackNode = workingData.inPlace.value().stackNode->caller;
-    }
-
-    bool isCompleteLine = false;
-    switch (inputLogLine.inputLineType) {
-      case CapLogType::BLOCK_CONCAT_BEGIN:
-        processIncompleteLineBegin(workingData, worldState);
-        break;
-      case CapLogType::BLOCK_CONCAT_CONTINUE:
-        if (!prevStackNode) {
-          failWithAbort(workingData, "Cannot concat; no previous node to concat to");
-        }
-        processIncompleteLineContinue(workingData, worldState);
-        break;
-      case CapLogType::BLOCK_CONCAT_END:
-        workingData.inPlace = {prevStackNodeIdx, prevStackNode};
-        workingData.inputLine = std::move(workingData.prevStackNode->incompleteString);
-        processLogLine(workingData, worldState);
-        break;
-      default:
-        isCompleteLine = true;  
-    }
+    bool isCompleteLine = inputLogLine.inputLineType != CapLogType::BLOCK_CONCAT_BEGIN
+      && inputLogLine.inputLineType != CapLogType::BLOCK_CONCAT_CONTINUE
+      && inputLogLine.inputLineType != CapLogType::BLOCK_CONCAT_END;
 
+    // do common part of Info line.
     if (isCompleteLine) {
-      CAP_LOG_BLOCK_NO_THIS(CAP::CHANNEL::processLogLine, "Is Complete Line.  input line: %s", inputLogLine.inputInfoString.c_str());
-      std::smatch infoMatch;
-      bool matchedInfo = std::regex_match (inputLogLine.inputInfoString, infoMatch, infoStringCommon);
-      
-      // do common part of Info line.
-      if (matchedInfo) {
-        CAP_LOG("Matched 1:%s 2:%s 3:%s", 
-          piecesMatch[1].str().c_str(),
-          piecesMatch[2].str().c_str(),
-          piecesMatch[3].str().c_str());
-
-        inputLogLine.inputFunctionId = infoMatch[1];
-        inputLogLine.inputSourceFileLine = infoMatch[2];
-        inputLogLine.inputInfoString = infoMatch[3]; //overwrite infoString with common part removed
+      if (auto infoFields = scanInfoStringCommon(inputLogLine.inputInfoString)) {
+        inputLogLine.matchedInfoCommon = true;
+        inputLogLine.inputFunctionId = infoFields->functionId;
+        inputLogLine.inputSourceFileLine = infoFields->sourceFileLine;
+        inputLogLine.inputInfoString = infoFields->body; //overwrite infoString with common part removed
         inputLogLine.inputLineDepth = getLineDepth(inputLogLine.inputIndentation);
 
-        outputLogData.lineDepth = inputLogLine.inputLineDepth;
-        outputLogData.commonLogText.channelId = inputLogLine.inputChannelId;
-        outputLogData.commonLogText.indentation = replaceIndentationChars(inputLogLine.inputIndentation);
-        outputLogData.commonLogText.functionId = inputLogLine.inputFunctionId;
-        outputLogData.commonLogText.sourceFileLine = inputLogLine.inputSourceFileLine;          
-
         switch (inputLogLine.inputLineType) {
           case CapLogType::BLOCK_SCOPE_OPEN:
-            processBlockScopeOpen(workingData, worldState);
-            break;
+            // intentional fall through
           case CapLogType::BLOCK_SCOPE_CLOSE:
-            processBlockScopeClose(workingData, worldState);
+            inputLogLine.inputBlock = scanInfoStringBlock(inputLogLine.inputInfoString);
             break;
           case CapLogType::BLOCK_INNER_LINE:
-            processBlockInnerLine(workingData, worldState);
+            inputLogLine.inputInner = scanInfoStringInner(inputLogLine.inputInfoString);
             break;
           default:
-            failWithAbort(workingData, "Unknown input log line type");
+            break;
         }
-      } else {
-        failWithAbort(workingData, "Unable to match info line common");
       }
     }
+
+    parsedLine.fields = inputLogLine;
+  } else if (std::optional<ChannelLineFields> channelLineFields = scanChannelLine(line)) {
+    parsedLine.fields = *channelLineFields;
+  } else if (std::optional<MaxCharsLineFields> maxCharsLineFields = scanMaxCharsLine(line)) {
+    parsedLine.fields = *maxCharsLineFields;
   }
 
-  return matched;
+  return parsedLine;
 }
 
-bool processChannelLine(
+// workingData.inputLogLine has been filled in by parseCaplogLine.
+void processLogLine(
     WorldStateWorkingData& workingData, 
     WorldState& worldState) {
-  CAP_LOG_BLOCK_NO_THIS(CAP::CHANNEL::processChannelLine, "%s", workingData.inputLine.c_str());
-  std::smatch piecesMatch;
-  bool matched = std::regex_match(workingData.inputLine, piecesMatch, channelLineRegex);
-  if (matched) {
-    CAP_LOG("Matched 1:%s 2:%s 3:%s 4:%s 5:%s 6:%s", 
-      piecesMatch[1].str().c_str(),
-      piecesMatch[2].str().c_str(),
-      piecesMatch[3].str().c_str(),
-      piecesMatch[4].str().c_str(),
-      piecesMatch[5].str().c_str(),
-      piecesMatch[6].str().c_str());
-
-    workingData.lineType = CapLineType::CHANNEL;
-    workingData.channelLine = std::make_unique<ChannelLine>();
-    ChannelLine& channelLine = *workingData.channelLine.get();
-
-    channelLine.fullString = piecesMatch[0];
-    channelLine.uniqueProcessId = workingData.getUniqueProcessIdForInputProcessId(piecesMatch[1], worldState);
-    channelLine.uniqueThreadId = workingData.getUniqueThreadIdForInputThreadId(channelLine.uniqueProcessId, piecesMatch[2], worldState);
-    channelLine.channelId = piecesMatch[3];
-    channelLine.enabledMode = piecesMatch[4];
-    channelLine.verbosityLevel = piecesMatch[5];
-    channelLine.channelName = piecesMatch[6];
-
-    worldState.pushChannelLine(std::move(channelLine));
-  }
-
-  return matched;
+  CAP_LOG_BLOCK_NO_THIS(CAP::CHANNEL::processLogLine, "%.*s", (int)workingData.inputLine.size(), workingData.inputLine.data());
+  CAP_LOG("Matched 1:%.*s 2:%.*s 3:%.*s 4:%.*s 5:%.*s", 
+    (int)workingData.inputLogLine.inputProcessId.size(), workingData.inputLogLine.inputProcessId.data(),
+    (int)workingData.inputLogLine.inputThreadId.size(), workingData.inputLogLine.inputThreadId.data(),
+    (int)workingData.inputLogLine.inputChannelId.size(), workingData.inputLogLine.inputChannelId.data(),
+    (int)workingData.inputLogLine.inputIndentation.size(), workingData.inputLogLine.inputIndentation.data(),
+    (int)workingData.inputLogLine.inputInfoString.size(), workingData.inputLogLine.inputInfoString.data());
+
+  workingData.lineType = CapLineType::CAPLOG;
+  workingData.outputLogData = std::make_unique<OutputLogData>();
+  InputLogLine& inputLogLine = workingData.inputLogLine;
+  OutputLogData& outputLogData = *workingData.outputLogData.get();
+
+  outputLogData.uniqueProcessId = workingData.resolvedLogLine.uniqueProcessId;
+  outputLogData.uniqueThreadId = workingData.resolvedLogLine.uniqueThreadId;
+  outputLogData.logLineType = inputLogLine.inputLineType;
+
+  // inputLogLine.inputLineDepth can resolve to a block open/close or inner log/error/set
+  size_t prevStackNodeIdx = worldState.getLastStackNodeForProcessThread(outputLogData.uniqueProcessId,
+                                                                        outputLogData.uniqueThreadId);
+  workingData.prevStackNodeIdx = prevStackNodeIdx;
+
+  if (workingData.inPlace) {
+    const StackNodeView inPlaceStackNode = worldState.getStackNode(workingData.inPlace.value().index);
+    if (workingData.inPlace.value().index != prevStackNodeIdx) {
+      failWithAbort(workingData, "AFTER INCOMPLETE LINE: workingData.inPlace.index != prevStackNodeIdx");
+    } else if (inPlaceStackNode.uniqueProcessId != outputLogData.uniqueProcessId) {
+      failWithAbort(workingData, "AFTER INCOMPLETE LINE: workingData.inPlace.value().stackNode->uniqueProcessId != outputLogData.uniqueProcessId");
+    } else if (inPlaceStackNode.uniqueThreadId != outputLogData.uniqueThreadId) {
+      failWithAbort(workingData, "AFTER INCOMPLETE LINE: workingData.inPlace.value().stackNode->uniqueThreadId != outputLogData.uniqueThreadId");
+    }
+
+    // since the "last stack node" in this case is the inplace one we're modifying, we need to set the previous stack node to it's previous.
+    workingData.prevStackNodeIdx = inPlaceStackNode.callerIdx;
+  }
+
+  bool isCompleteLine = false;
+  switch (inputLogLine.inputLineType) {
+    case CapLogType::BLOCK_CONCAT_BEGIN:
+      processIncompleteLineBegin(workingData, worldState);
+      break;
+    case CapLogType::BLOCK_CONCAT_CONTINUE:
+      if (prevStackNodeIdx == noStackNode) {
+        failWithAbort(workingData, "Cannot concat; no previous node to concat to");
+      }
+      processIncompleteLineContinue(workingData, worldState);
+      break;
+    case CapLogType::BLOCK_CONCAT_END: {
+      workingData.inPlace = {prevStackNodeIdx};
+      // the joined up pieces are parsed like any other line, but it has to happen here since it
+      // depends on the lines before it.
+      // The pieces were all on this thread, so the joined line has to be too.
+      // The joined line is kept in the thread's arena, since the node made from it points into it.
+      const InputLogLine piecesLogLine = inputLogLine;
+      StackNodeArena& arena = worldState.getStackNodeArena(outputLogData.uniqueProcessId, outputLogData.uniqueThreadId);
+      IncompleteLine& incompleteLine = worldState.getIncompleteLine(outputLogData.uniqueProcessId, outputLogData.uniqueThreadId);
+      workingData.inputLine = arena.storeString(incompleteLine.text);
+      incompleteLine = IncompleteLine();
+      ParsedLine concatenatedLine = parseCaplogLine(workingData.inputLine);
+      if (auto* concatenatedLogLine = std::get_if<InputLogLine>(&concatenatedLine.fields)) {
+        if (concatenatedLogLine->inputProcessId != piecesLogLine.inputProcessId) {
+          failWithAbort(workingData, "AFTER INCOMPLETE LINE: workingData.inPlace.value().stackNode->uniqueProcessId != outputLogData.uniqueProcessId");
+        } else if (concatenatedLogLine->inputThreadId != piecesLogLine.inputThreadId) {
+          failWithAbort(workingData, "AFTER INCOMPLETE LINE: workingData.inPlace.value().stackNode->uniqueThreadId != outputLogData.uniqueThreadId");
+        }
+        workingData.inputLogLine = *concatenatedLogLine;
+        processLogLine(workingData, worldState);
+      }
+      break;
+    }
+    default:
+      isCompleteLine = true;  
+  }
+
+  if (isCompleteLine) {
+    CAP_LOG_BLOCK_NO_THIS(CAP::CHANNEL::processLogLine, "Is Complete Line.  input line: %.*s", (int)inputLogLine.inputInfoString.size(), inputLogLine.inputInfoString.data());
+    
+    // do common part of Info line.
+    if (inputLogLine.matchedInfoCommon) {
+      CAP_LOG("Matched 1:%.*s 2:%.*s 3:%.*s", 
+        (int)inputLogLine.inputFunctionId.size(), inputLogLine.inputFunctionId.data(),
+        (int)inputLogLine.inputSourceFileLine.size(), inputLogLine.inputSourceFileLine.data(),
+        (int)inputLogLine.inputInfoString.size(), inputLogLine.inputInfoString.data());
+
+      outputLogData.lineDepth = inputLogLine.inputLineDepth;
+      outputLogData.commonLogText.channelId = inputLogLine.inputChannelId;
+      outputLogData.commonLogText.indentation = replaceIndentationChars(inputLogLine.inputIndentation,
+        worldState.getStackNodeArena(outputLogData.uniqueProcessId, outputLogData.uniqueThreadId));
+      outputLogData.commonLogText.functionId = inputLogLine.inputFunctionId;
+      outputLogData.commonLogText.sourceFileLine = inputLogLine.inputSourceFileLine;          
+
+      switch (inputLogLine.inputLineType) {
+        case CapLogType::BLOCK_SCOPE_OPEN:
+          processBlockScopeOpen(workingData, worldState);
+          break;
+        case CapLogType::BLOCK_SCOPE_CLOSE:
+          processBlockScopeClose(workingData, worldState);
+          break;
+        case CapLogType::BLOCK_INNER_LINE:
+          processBlockInnerLine(workingData, worldState);
+          break;
+        default:
+          failWithAbort(workingData, "Unknown input log line type");
+      }
+    } else {
+      failWithAbort(workingData, "Unable to match info line common");
+    }
+  }
+}
+
+void processChannelLine(
+    WorldStateWorkingData& workingData, 
+    WorldState& worldState,
+    const ChannelLineFields& channelLineFields) {
+  CAP_LOG_BLOCK_NO_THIS(CAP::CHANNEL::processChannelLine, "%.*s", (int)workingData.inputLine.size(), workingData.inputLine.data());
+  CAP_LOG("Matched 1:%.*s 2:%.*s 3:%.*s 4:%.*s 5:%.*s 6:%.*s", 
+    (int)channelLineFields.processId.size(), channelLineFields.processId.data(),
+    (int)channelLineFields.threadId.size(), channelLineFields.threadId.data(),
+    (int)channelLineFields.channelId.size(), channelLineFields.channelId.data(),
+    (int)channelLineFields.enabled.size(), channelLineFields.enabled.data(),
+    (int)channelLineFields.verbosityLevel.size(), channelLineFields.verbosityLevel.data(),
+    (int)channelLineFields.channelName.size(), channelLineFields.channelName.data());
+
+  workingData.lineType = CapLineType::CHANNEL;
+  workingData.channelLine = std::make_unique<ChannelLine>();
+  ChannelLine& channelLine = *workingData.channelLine.get();
+
+  channelLine.fullString = workingData.inputLine;
+  channelLine.uniqueProcessId = workingData.getUniqueProcessIdForInputProcessId(channelLineFields.processId, worldState);
+  channelLine.uniqueThreadId = workingData.getUniqueThreadIdForInputThreadId(channelLine.uniqueProcessId, channelLineFields.threadId, worldState);
+  channelLine.channelId = channelLineFields.channelId;
+  channelLine.enabledMode = channelLineFields.enabled;
+  channelLine.verbosityLevel = channelLineFields.verbosityLevel;
+  channelLine.channelName = channelLineFields.channelName;
+
+  worldState.pushChannelLine(std::move(channelLine));
+}
+
+void processLogLineCharLimit(
+    WorldStateWorkingData& workingData, 
+    WorldState& worldState,
+    const MaxCharsLineFields& maxCharsLineFields) {
+  CAP_LOG_BLOCK_NO_THIS(CAP::CHANNEL::processLogLineCharLimit, "%.*s", (int)workingData.inputLine.size(), workingData.inputLine.data());
+  CAP_LOG("Matched 1:%.*s 2:%.*s", 
+    (int)maxCharsLineFields.processId.size(), maxCharsLineFields.processId.data(),
+    (int)maxCharsLineFields.maxChars.size(), maxCharsLineFields.maxChars.data());
+
+  int maxChars = 0;
+  std::string_view maxCharsString = maxCharsLineFields.maxChars;
+  if (std::from_chars(maxCharsString.data(), maxCharsString.data() + maxCharsString.size(), maxChars).ec != std::errc()) {
+    failWithAbort(workingData, "Unable to read MAX-CHAR-SIZE");
+  }
+  size_t uniqueProcessId = workingData.getUniqueProcessIdForInputProcessId(maxCharsLineFields.processId, worldState);
+  workingData.uniqueProcessIdToMaxCharLine[uniqueProcessId] = maxChars;
 }
 
-bool processLogLineCharLimit(
+// The in order pass over a parsed line: hands out ids and stack node slots for log lines, and
+// takes care of the channel and MAX-CHAR-SIZE lines.  Lines have to come through here in input
+// order.
+void resolveParsedLine(
+    ParsedLine& parsedLine,
     WorldStateWorkingData& workingData, 
+    WorldState& worldState,
+    size_t& stackNodeCount) {
+  workingData.inputLine = parsedLine.line;
+  if (auto* inputLogLine = std::get_if<InputLogLine>(&parsedLine.fields)) {
+    ResolvedLogLine& resolved = parsedLine.resolved;
+    resolved.inputFileLineNumber = workingData.intputFileLineNumber;
+    resolved.uniqueProcessId = workingData.getUniqueProcessIdForInputProcessId(inputLogLine->inputProcessId, worldState);
+    resolved.uniqueThreadId = workingData.getUniqueThreadIdForInputThreadId(resolved.uniqueProcessId, inputLogLine->inputThreadId, worldState);
+    if (auto maxCharsIter = workingData.uniqueProcessIdToMaxCharLine.find(resolved.uniqueProcessId);
+        maxCharsIter != workingData.uniqueProcessIdToMaxCharLine.end()) {
+      resolved.characterLimit = maxCharsIter->second;
+    }
+
+    // CONCAT pieces after the first fill in the first one's node instead of adding their own.
+    if (inputLogLine->inputLineType != CapLogType::BLOCK_CONCAT_CONTINUE
+        && inputLogLine->inputLineType != CapLogType::BLOCK_CONCAT_END) {
+      resolved.stackNodeIdx = stackNodeCount++;
+    }
+  } else if (auto* channelLineFields = std::get_if<ChannelLineFields>(&parsedLine.fields)) {
+    processChannelLine(workingData, worldState, *channelLineFields);
+  } else if (auto* maxCharsLineFields = std::get_if<MaxCharsLineFields>(&parsedLine.fields)) {
+    processLogLineCharLimit(workingData, worldState, *maxCharsLineFields);
+  }
+}
+
+// Replays one thread's resolved log lines, in order, against that thread's stack.  Different
+// threads don't share any stack nodes, so they can be replayed concurrently.
+void processThreadLogLines(
+    const std::vector<const ParsedLine*>& threadLines,
     WorldState& worldState) {
-  CAP_LOG_BLOCK_NO_THIS(CAP::CHANNEL::processLogLineCharLimit, "%s", workingData.inputLine.c_str());
-  std::smatch piecesMatch;
-  bool matched = std::regex_match(workingData.inputLine, piecesMatch, maxCharsLineRegex);
-  if (matched) {
-    CAP_LOG("Matched 1:%s 2:%s", 
-      piecesMatch[1].str().c_str(),
-      piecesMatch[2].str().c_str());
+  WorldStateWorkingData workingData;
+  for (const ParsedLine* parsedLine : threadLines) {
+    workingData.inputLine = parsedLine->line;
+    workingData.intputFileLineNumber = parsedLine->resolved.inputFileLineNumber;
+    workingData.resolvedLogLine = parsedLine->resolved;
+    workingData.inputLogLine = std::get<InputLogLine>(parsedLine->fields);
+    processLogLine(workingData, worldState);
+    workingData.inPlace = std::nullopt;
+  }
+}
+
+/**
+ * The parsed caplog lines of one chunk of the input.  Chunks are cut at newlines, so a length
+ * prefixed record with newlines in it can straddle two chunks.  The records of a chunk are the
+ * ones that start before its end, so its endOffset can run past the next chunk's beginOffset;
+ * when that happens the next chunk started mid record and has to be parsed again from endOffset.
+ **/
+struct ParsedChunk {
+  size_t beginOffset = 0;
+  size_t endOffset = 0;
+  size_t recordCount = 0;
+  std::vector<ParsedLine> lines;
+};
 
-    size_t uniqueProcessId = workingData.getUniqueProcessIdForInputProcessId(piecesMatch[1], worldState);
-    workingData.uniqueProcessIdToMaxCharLine[uniqueProcessId] = std::stoi(piecesMatch[2]);
+ParsedChunk parseChunk(std::string_view inputContents, size_t beginOffset, size_t chunkEnd) {
+  ParsedChunk chunk;
+  chunk.beginOffset = beginOffset;
+
+  size_t inputOffset = beginOffset;
+  std::string_view inputLine;
+  // File output captures are length prefixed records; anything else is read line by line.
+  while (inputOffset < chunkEnd && CAP::RecordFraming::readRecord(inputContents, inputOffset, inputLine)) {
+    if (std::optional<std::string_view> caplogLine = scanCaplogLine(inputLine)) {
+      chunk.lines.push_back(parseCaplogLine(*caplogLine));
+      chunk.lines.back().chunkRecordIndex = chunk.recordCount;
+    }
+    ++chunk.recordCount;
   }
 
-  return matched;
+  chunk.endOffset = std::max(beginOffset, std::min(inputOffset, inputContents.size()));
+  return chunk;
 }
 
-// TODO handle broken lines
-// void adjustToExpectedDepth(expected depth)
+// Resolves a chunk's lines in order, then replays each thread's log lines; on separate cores when
+// there's more than one.  The next chunk can't be resolved until this one is done.
+void processChunk(
+    ParsedChunk& chunk,
+    size_t chunkFirstLineNumber,
+    WorldStateWorkingData& workingData,
+    WorldState& worldState,
+    size_t& stackNodeCount,
+    size_t maxReplayThreads) {
+  std::map<std::pair<size_t, size_t>, size_t> processThreadToLinesIdx;
+  std::vector<std::vector<const ParsedLine*>> linesPerThread;
+  for (ParsedLine& parsedLine : chunk.lines) {
+    CAP_LOG("%.*s", (int)parsedLine.line.size(), parsedLine.line.data());
+    workingData.intputFileLineNumber = chunkFirstLineNumber + parsedLine.chunkRecordIndex;
+    resolveParsedLine(parsedLine, workingData, worldState, stackNodeCount);
+    workingData.inPlace = std::nullopt;
+
+    if (std::holds_alternative<InputLogLine>(parsedLine.fields)) {
+      auto [linesIdxIter, inserted] = processThreadToLinesIdx.try_emplace(
+        {parsedLine.resolved.uniqueProcessId, parsedLine.resolved.uniqueThreadId}, linesPerThread.size());
+      if (inserted) {
+        linesPerThread.emplace_back();
+      }
+      linesPerThread[linesIdxIter->second].push_back(&parsedLine);
+    }
+  }
+  worldState.reserveStackNodes(stackNodeCount);
 
-[[maybe_unused]] size_t getFileSize(char* filename) {
-  std::ifstream file(filename, std::ios::binary | std::ios::ate);
-  return file.tellg();
+  std::atomic<size_t> nextLinesIdx = 0;
+  auto replayThreads = [&]() {
+    for (size_t linesIdx = nextLinesIdx++; linesIdx < linesPerThread.size(); linesIdx = nextLinesIdx++) {
+      processThreadLogLines(linesPerThread[linesIdx], worldState);
+    }
+  };
+
+  std::vector<std::thread> replayWorkers;
+  for (size_t i = 1; i < std::min(maxReplayThreads, linesPerThread.size()); ++i) {
+    replayWorkers.emplace_back(replayThreads);
+  }
+  replayThreads();
+  for (std::thread& replayWorker : replayWorkers) {
+    replayWorker.join();
+  }
 }
 
-size_t countLines(char* filename) {
-  std::ifstream file(filename); 
-  return std::count(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>(), '\n');
+// Chunk boundaries, each just after a newline.  The last one is the end of the input.
+std::vector<size_t> splitIntoChunks(std::string_view inputContents, size_t chunkSize) {
+  std::vector<size_t> chunkBoundaries{0};
+  while (chunkBoundaries.back() < inputContents.size()) {
+    size_t chunkEnd = inputContents.find('\n', chunkBoundaries.back() + chunkSize);
+    chunkBoundaries.push_back(chunkEnd == std::string_view::npos ? inputContents.size() : chunkEnd + 1);
+  }
+  return chunkBoundaries;
 }
 
+// TODO handle broken lines
+// void adjustToExpectedDepth(expected depth)
+
+/**
+ * The whole input file, mapped read only.  Lines are parsed in place, so the file is read once
+ * and no line is copied out of it.  If the file can't be mapped (eg. it's a pipe) it's read into
+ * memory in large blocks instead.
+ **/
+class MappedInputFile {
+public:
+  explicit MappedInputFile(const char* filename) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+      return;
+    }
+    mIsOpen = true;
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) == 0 && S_ISREG(fileStat.st_mode) && fileStat.st_size > 0) {
+      void* mapped = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (mapped != MAP_FAILED) {
+        mMapped = mapped;
+        mMappedSize = fileStat.st_size;
+        // we only ever walk forward through the file.
+        madvise(mMapped, mMappedSize, MADV_SEQUENTIAL);
+        mContents = std::string_view(static_cast<const char*>(mMapped), mMappedSize);
+      }
+    }
+
+    if (!mMapped) {
+      constexpr size_t readBlockSize = 1 << 20;
+      ssize_t bytesRead = 0;
+      do {
+        size_t oldSize = mReadBuffer.size();
+        mReadBuffer.resize(oldSize + readBlockSize);
+        bytesRead = read(fd, mReadBuffer.data() + oldSize, readBlockSize);
+        mReadBuffer.resize(oldSize + std::max<ssize_t>(bytesRead, 0));
+      } while (bytesRead > 0 || (bytesRead < 0 && errno == EINTR));
+      mContents = mReadBuffer;
+    }
+
+    close(fd);
+  }
+
+  ~MappedInputFile() {
+    if (mMapped) {
+      munmap(mMapped, mMappedSize);
+    }
+  }
+
+  MappedInputFile(const MappedInputFile&) = delete;
+  MappedInputFile& operator=(const MappedInputFile&) = delete;
+
+  bool isOpen() const {
+    return mIsOpen;
+  }
+
+  std::string_view contents() const {
+    return mContents;
+  }
+
+private:
+  bool mIsOpen = false;
+  void* mMapped = nullptr;
+  size_t mMappedSize = 0;
+  std::string mReadBuffer;
+  std::string_view mContents;
+};
+
+// The input is parsed in chunks of about this size (see ParsedChunk).
+constexpr const size_t parseChunkSize = 4 * 1024 * 1024;
+
+// progress is by bytes read, so nothing has to count the lines up front.
 struct FileReadProgress {
-  size_t currentLine = 0;
-  size_t totalLines;
+  size_t currentByte = 0;
+  size_t totalBytes;
   
   float lastPrintedProgressPercent = 0.f;
 
-  FileReadProgress(size_t totalLines): totalLines(totalLines){
+  FileReadProgress(size_t totalBytes): totalBytes(totalBytes){
     std::cout << "PROGRESS: " << std::endl;
   }
 
-  void incrementProgress() {
-    ++currentLine;
-    float currentPercent = ((float)currentLine / totalLines) * 100.f;
+  void updateProgress(size_t bytesRead) {
+    currentByte = std::min(bytesRead, totalBytes);
+    float currentPercent = ((float)currentByte / totalBytes) * 100.f;
     
     // print out in 1% increments
     if(currentPercent - lastPrintedProgressPercent >= 1.f) {
@@ -1001,111 +1561,644 @@ struct FileReadProgress {
   }
 };
 
+// The output is formatted into memory and written to the file in large blocks, instead of a line
+// at a time through a stream.
+class OutputFile {
+public:
+  explicit OutputFile(const char* filename) {
+    mFd = open(filename, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  }
+
+  ~OutputFile() {
+    if (mFd >= 0) {
+      close(mFd);
+    }
+  }
+
+  OutputFile(const OutputFile&) = delete;
+  OutputFile& operator=(const OutputFile&) = delete;
+
+  bool isOpen() const {
+    return mFd >= 0;
+  }
+
+  // Returns false if the file couldn't be written to (eg. the disk is full).
+  bool write(std::string_view text) {
+    while (!text.empty()) {
+      ssize_t bytesWritten = ::write(mFd, text.data(), text.size());
+      if (bytesWritten < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        std::cerr << "Unable to write output: " << std::strerror(errno) << std::endl;
+        return false;
+      }
+      text.remove_prefix(bytesWritten);
+    }
+    return true;
+  }
+
+private:
+  int mFd = -1;
+};
+
+void appendNumber(std::string& out, size_t number) {
+  char digits[24];
+  auto [end, ec] = std::to_chars(digits, digits + sizeof(digits), number);
+  out.append(digits, end - digits);
+}
+
+void appendOutputTitle(std::string& out) {
+  out += "************************************************************************\n\n";
+  out += "CAPTAINS LOG PROCESSED - VERSION 1\n\n";
+  out += "************************************************************************\n\n";
+}
+
+void appendChannelLine(std::string& out, const ChannelLine& channelLine) {
+  out += "P=";
+  appendNumber(out, channelLine.uniqueProcessId);
+  out += " T=";
+  appendNumber(out, channelLine.uniqueThreadId);
+  out += " CHANNEL-ID=";
+  out += channelLine.channelId;
+  out += " : ";
+  out += channelLine.enabledMode;
+  out += " : VERBOSITY=";
+  out += channelLine.verbosityLevel;
+  out += " : ";
+  out += channelLine.channelName;
+  out += '\n';
+}
+
+void appendStackNode(std::string& out, const StackNodeView& node) {
+  out += "P=";
+  appendNumber(out, node.uniqueProcessId);
+  out += " T=";
+  appendNumber(out, node.uniqueThreadId);
+  out += " C=";
+  out += node.commonLogText.channelId;
+  out += ' ';
+  out += node.commonLogText.indentation;
+  out += ' ';
+  out += node.commonLogText.functionId;
+  out += ' ';
+  out += node.commonLogText.sourceFileLine;
+
+  switch (node.logLineType) {
+    case CapLogType::BLOCK_SCOPE_OPEN:
+      // intentional fall through
+    case CapLogType::BLOCK_SCOPE_CLOSE:
+      out += "::[";
+      out += node.blockText.filename;
+      out += "]::[";
+      out += node.blockText.functionName;
+      out += "] ";
+      out += node.blockText.objectId;
+      break;
+    case CapLogType::BLOCK_INNER_LINE:
+      out += ' ';
+      out += node.messageText.innerTypeString;
+      out += ": ";
+      out += node.messageText.innerPayload;
+      break;
+    default:
+      std::cerr << "CapLogType::UNKNOWN line" << std::endl;
+      std::abort();
+  }
+
+  out += '\n';
+}
+
+// Where each stack node ended up in the output, for the .clogidx.  outputOffset and outputLine are
+// where the next node will go.
+struct StackNodeOutputPositions {
+  std::vector<uint64_t> offsets;
+  std::vector<uint64_t> lines;
+  uint64_t outputOffset = 0;
+  uint64_t outputLine = 0;
+};
+
+// Stack nodes are formatted in ranges of this many, one range per thread at a time.
+constexpr const size_t outputStackNodesPerBuffer = 64 * 1024;
+
+/**
+ * Writes the stack nodes in [beginIdx, endIdx) to outputFile.  Each thread formats its own range
+ * into its own buffer; once they're all done the buffers are written in order, so the output is
+ * the same as formatting them one by one.  Only threadCount buffers are alive at once, so memory
+ * use doesn't grow with the number of nodes.
+ *
+ * If positions is set, it has to have room for endIdx nodes.
+ **/
+bool writeStackNodes(
+    OutputFile& outputFile,
+    const WorldState& worldState,
+    size_t beginIdx,
+    size_t endIdx,
+    size_t threadCount,
+    StackNodeOutputPositions* positions = nullptr) {
+  std::vector<std::string> buffers(threadCount);
+  // with positions, each range's nodes are first recorded relative to the start of its buffer.
+  std::vector<uint64_t> bufferLineCounts(threadCount);
+  auto formatRange = [&worldState, &bufferLineCounts, endIdx, positions](size_t bufferIdx, std::string& buffer, size_t rangeBeginIdx) {
+    buffer.clear();
+    uint64_t lineCount = 0;
+    const size_t rangeEndIdx = std::min(endIdx, rangeBeginIdx + outputStackNodesPerBuffer);
+    for (size_t stackNodeIdx = rangeBeginIdx; stackNodeIdx < rangeEndIdx; ++stackNodeIdx) {
+      const size_t nodeOffset = buffer.size();
+      appendStackNode(buffer, worldState.getStackNode(stackNodeIdx));
+      if (positions) {
+        positions->offsets[stackNodeIdx] = nodeOffset;
+        positions->lines[stackNodeIdx] = lineCount;
+        // payloads can have newlines in them.
+        lineCount += std::count(buffer.begin() + nodeOffset, buffer.end(), '\n');
+      }
+    }
+    bufferLineCounts[bufferIdx] = lineCount;
+  };
+
+  for (size_t roundBeginIdx = beginIdx; roundBeginIdx < endIdx; roundBeginIdx += threadCount * outputStackNodesPerBuffer) {
+    std::vector<std::thread> formatThreads;
+    for (size_t bufferIdx = 1; bufferIdx < threadCount; ++bufferIdx) {
+      const size_t rangeBeginIdx = roundBeginIdx + bufferIdx * outputStackNodesPerBuffer;
+      if (rangeBeginIdx >= endIdx) {
+        buffers[bufferIdx].clear();
+        continue;
+      }
+      formatThreads.emplace_back(formatRange, bufferIdx, std::ref(buffers[bufferIdx]), rangeBeginIdx);
+    }
+    // this thread takes the first range.
+    formatRange(0, buffers[0], roundBeginIdx);
+    for (auto& formatThread : formatThreads) {
+      formatThread.join();
+    }
+
+    for (size_t bufferIdx = 0; bufferIdx < threadCount; ++bufferIdx) {
+      if (!outputFile.write(buffers[bufferIdx])) {
+        return false;
+      }
+      if (positions) {
+        const size_t rangeBeginIdx = roundBeginIdx + bufferIdx * outputStackNodesPerBuffer;
+        const size_t rangeEndIdx = std::min(endIdx, rangeBeginIdx + outputStackNodesPerBuffer);
+        for (size_t stackNodeIdx = rangeBeginIdx; stackNodeIdx < rangeEndIdx; ++stackNodeIdx) {
+          positions->offsets[stackNodeIdx] += positions->outputOffset;
+          positions->lines[stackNodeIdx] += positions->outputLine;
+        }
+        positions->outputOffset += buffers[bufferIdx].size();
+        positions->outputLine += bufferLineCounts[bufferIdx];
+      }
+    }
+  }
+  return true;
+}
+
+// Lays out a section of count entries of T after indexSize bytes (see ClogIndex::Header).
+template <typename T>
+ClogIndex::Section placeIndexSection(uint64_t& indexSize, const std::vector<T>& entries) {
+  indexSize = (indexSize + 7) / 8 * 8;
+  ClogIndex::Section section{indexSize, entries.size()};
+  indexSize += entries.size() * sizeof(T);
+  return section;
+}
+
+template <typename T>
+bool writeIndexSection(OutputFile& indexFile, uint64_t& indexSize, const ClogIndex::Section& section, const std::vector<T>& entries) {
+  const char padding[8] = {};
+  if (!indexFile.write(std::string_view(padding, section.offset - indexSize))) {
+    return false;
+  }
+  indexSize = section.offset + entries.size() * sizeof(T);
+  return indexFile.write(std::string_view(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(T)));
+}
+
+/**
+ * Writes the .clogidx for the processed output (see clogIndex.hpp).  The open/close pairing and
+ * the parent of each node are found by walking each thread's nodes with a stack of open scopes,
+ * the same way the nodes were nested in the input.
+ **/
+bool writeClogIndex(const std::string& indexFilename, const WorldState& worldState, const StackNodeOutputPositions& positions) {
+  const size_t stackNodeCount = worldState.getStackNodeCount();
+  std::vector<ClogIndex::Node> nodes(stackNodeCount);
+  std::map<std::pair<size_t, size_t>, std::vector<uint64_t>> threadNodes;
+  std::map<std::string_view, std::vector<uint64_t>> channelNodes;
+  std::map<std::string_view, std::vector<uint64_t>> functionCalls;
+
+  for (size_t stackNodeIdx = 0; stackNodeIdx < stackNodeCount; ++stackNodeIdx) {
+    const StackNodeView node = worldState.getStackNode(stackNodeIdx);
+    nodes[stackNodeIdx] = ClogIndex::Node{
+      positions.offsets[stackNodeIdx],
+      positions.lines[stackNodeIdx],
+      node.callerIdx == noStackNode ? ClogIndex::noNode : node.callerIdx,
+      ClogIndex::noNode,
+      ClogIndex::noNode,
+      0,
+      static_cast<uint32_t>(node.depth),
+      static_cast<uint32_t>(node.logLineType),
+      0};
+    threadNodes[{node.uniqueProcessId, node.uniqueThreadId}].push_back(stackNodeIdx);
+    channelNodes[node.commonLogText.channelId].push_back(stackNodeIdx);
+    if (node.logLineType == CapLogType::BLOCK_SCOPE_OPEN) {
+      functionCalls[node.blockText.functionName].push_back(stackNodeIdx);
+    }
+  }
+
+  std::vector<uint64_t> postings;
+  std::vector<ClogIndex::Thread> threads;
+  std::vector<uint64_t> openScopes;
+  for (auto&& [threadId, threadNodeIdxs] : threadNodes) {
+    const uint32_t threadIdx = static_cast<uint32_t>(threads.size());
+    threads.push_back({threadId.first, threadId.second, postings.size(), threadNodeIdxs.size()});
+    postings.insert(postings.end(), threadNodeIdxs.begin(), threadNodeIdxs.end());
+
+    openScopes.clear();
+    for (uint64_t stackNodeIdx : threadNodeIdxs) {
+      ClogIndex::Node& node = nodes[stackNodeIdx];
+      node.threadIdx = threadIdx;
+      if (node.logLineType == static_cast<uint32_t>(CapLogType::BLOCK_SCOPE_CLOSE) && !openScopes.empty()) {
+        node.pairedIdx = openScopes.back();
+        nodes[openScopes.back()].pairedIdx = stackNodeIdx;
+        openScopes.pop_back();
+      }
+      node.parentIdx = openScopes.empty() ? ClogIndex::noNode : openScopes.back();
+      if (node.logLineType == static_cast<uint32_t>(CapLogType::BLOCK_SCOPE_OPEN)) {
+        openScopes.push_back(stackNodeIdx);
+      }
+    }
+  }
+
+  std::vector<char> strings;
+  auto makeKeys = [&postings, &strings](const std::map<std::string_view, std::vector<uint64_t>>& keyNodes) {
+    std::vector<ClogIndex::Key> keys;
+    keys.reserve(keyNodes.size());
+    for (auto&& [name, keyNodeIdxs] : keyNodes) {
+      keys.push_back({strings.size(), name.size(), postings.size(), keyNodeIdxs.size()});
+      strings.insert(strings.end(), name.begin(), name.end());
+      postings.insert(postings.end(), keyNodeIdxs.begin(), keyNodeIdxs.end());
+    }
+    return keys;
+  };
+  const std::vector<ClogIndex::Key> channels = makeKeys(channelNodes);
+  const std::vector<ClogIndex::Key> functions = makeKeys(functionCalls);
+
+  ClogIndex::Header header{};
+  std::memcpy(header.magic, ClogIndex::magic, sizeof(header.magic));
+  header.version = ClogIndex::version;
+  header.nodeSize = sizeof(ClogIndex::Node);
+  header.outputFileSize = positions.outputOffset;
+
+  uint64_t indexSize = sizeof(header);
+  header.nodes = placeIndexSection(indexSize, nodes);
+  header.threads = placeIndexSection(indexSize, threads);
+  header.channels = placeIndexSection(indexSize, channels);
+  header.functions = placeIndexSection(indexSize, functions);
+  header.postings = placeIndexSection(indexSize, postings);
+  header.strings = placeIndexSection(indexSize, strings);
+
+  OutputFile indexFile(indexFilename.c_str());
+  if (!indexFile.isOpen()) {
+    std::cerr << "Unable to open index file " << indexFilename << std::endl;
+    return false;
+  }
+
+  indexSize = sizeof(header);
+  return indexFile.write(std::string_view(reinterpret_cast<const char*>(&header), sizeof(header)))
+    && writeIndexSection(indexFile, indexSize, header.nodes, nodes)
+    && writeIndexSection(indexFile, indexSize, header.threads, threads)
+    && writeIndexSection(indexFile, indexSize, header.channels, channels)
+    && writeIndexSection(indexFile, indexSize, header.functions, functions)
+    && writeIndexSection(indexFile, indexSize, header.postings, postings)
+    && writeIndexSection(indexFile, indexSize, header.strings, strings);
+}
+
+// how long liveMode waits for the input to grow before looking again.
+constexpr const int liveModePollIntervalMs = 100;
+// the most liveMode reads (and so processes) at once, so output keeps up when catching up on a
+// large capture.
+constexpr const size_t liveModeReadSize = 1024 * 1024;
+
+/**
+ * The input in liveMode: a capture that's still being written.  A regular file is followed as it
+ * grows, waking up on inotify when it's available and polling every liveModePollIntervalMs
+ * otherwise.  If it's truncated (eg. the capture was restarted) it's read again from the start.
+ * Anything else (eg. "-" for stdin, or a named pipe) is read until the writer closes it.
+ **/
+class LiveInput {
+public:
+  explicit LiveInput(const char* filename) {
+    if (std::string_view(filename) == "-") {
+      mFd = STDIN_FILENO;
+    } else {
+      mFd = open(filename, O_RDONLY);
+    }
+    if (mFd < 0) {
+      return;
+    }
+
+    struct stat fileStat;
+    mIsFollowingFile = fstat(mFd, &fileStat) == 0 && S_ISREG(fileStat.st_mode);
+    if (mIsFollowingFile) {
+      mInotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+      if (mInotifyFd >= 0 && inotify_add_watch(mInotifyFd, filename, IN_MODIFY) < 0) {
+        close(mInotifyFd);
+        mInotifyFd = -1;
+      }
+    }
+  }
+
+  ~LiveInput() {
+    if (mInotifyFd >= 0) {
+      close(mInotifyFd);
+    }
+    if (mFd > STDIN_FILENO) {
+      close(mFd);
+    }
+  }
+
+  LiveInput(const LiveInput&) = delete;
+  LiveInput& operator=(const LiveInput&) = delete;
+
+  bool isOpen() const {
+    return mFd >= 0;
+  }
+
+  enum class ReadResult {
+    Read,
+    // a followed file was truncated (eg. the capture was restarted), and is read again from the
+    // start; what was read before it belongs to the old capture.
+    Truncated,
+    // which a followed file never does.
+    Ended,
+  };
+
+  // Appends what's been written since the last call to buffer, waiting up to
+  // liveModePollIntervalMs for a followed file to grow.
+  ReadResult readMore(std::string& buffer) {
+    size_t oldSize = buffer.size();
+    buffer.resize(oldSize + liveModeReadSize);
+    ssize_t bytesRead = 0;
+    do {
+      bytesRead = read(mFd, buffer.data() + oldSize, liveModeReadSize);
+    } while (bytesRead < 0 && errno == EINTR);
+    buffer.resize(oldSize + std::max<ssize_t>(bytesRead, 0));
+
+    if (bytesRead > 0) {
+      return ReadResult::Read;
+    } else if (!mIsFollowingFile) {
+      return ReadResult::Ended;
+    }
+
+    // caught up with the writer.
+    waitForWrite();
+    struct stat fileStat;
+    if (fstat(mFd, &fileStat) == 0 && fileStat.st_size < lseek(mFd, 0, SEEK_CUR)) {
+      std::cerr << "Input was truncated; reading it again from the start" << std::endl;
+      lseek(mFd, 0, SEEK_SET);
+      return ReadResult::Truncated;
+    }
+    return ReadResult::Read;
+  }
+
+private:
+  void waitForWrite() {
+    if (mInotifyFd < 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(liveModePollIntervalMs));
+      return;
+    }
+
+    // the timeout is a fallback in case a write doesn't show up as an event.
+    pollfd inotifyPoll{mInotifyFd, POLLIN, 0};
+    if (poll(&inotifyPoll, 1, liveModePollIntervalMs) > 0) {
+      char events[4096];
+      while (read(mInotifyFd, events, sizeof(events)) > 0) {}
+    }
+  }
+
+  int mFd = -1;
+  int mInotifyFd = -1;
+  bool mIsFollowingFile = false;
+};
+
+/**
+ * liveMode: process a capture as it's written, appending each stack node to the output once it
+ * can't change anymore.  Nodes are written in input order, so a line that's still coming in CONCAT
+ * pieces holds back the nodes after it until its last piece arrives.  Channel lines are written
+ * as they come in, in the same format as the channel info of completedMode; there's no per
+ * process grouping since more can show up at any time.
+ *
+ * Each read is processed as soon as it has complete records, and the output is flushed after it,
+ * so the output lags the input by at most liveModePollIntervalMs plus the time to process one
+ * read.
+ *
+ * If the input's truncated, it's a new capture: it's processed from scratch, after another title
+ * in the output.
+ **/
+int runLiveMode(const char* inputFilename, const char* outputFilename) {
+  LiveInput input(inputFilename);
+  if (!input.isOpen()) {
+    std::cerr << "Unable to open input file " << inputFilename << std::endl;
+    return 1;
+  }
+
+  OutputFile outputFile(outputFilename);
+  if (!outputFile.isOpen()) {
+    std::cerr << "Unable to open output file " << outputFilename << std::endl;
+    return 1;
+  }
+
+  std::string outputText;
+  appendOutputTitle(outputText);
+  if (!outputFile.write(outputText)) {
+    return 1;
+  }
+
+  const size_t replayThreadCount = std::max(1u, std::thread::hardware_concurrency());
+
+  // Everything about the capture being followed, so it can all be started over.
+  struct Capture {
+    WorldState worldState;
+    WorldStateWorkingData workingData;
+
+    // The stack nodes point into the input, so once it's processed it's kept.  pendingInput is
+    // what's been read but doesn't make up a whole record yet.
+    std::deque<std::string> processedInput;
+    std::string pendingInput;
+
+    size_t stackNodeCount = 0;
+    size_t stackNodesWritten = 0;
+    std::map<size_t, size_t> uniqueProcessIdToChannelLinesWritten;
+  };
+  auto capture = std::make_unique<Capture>();
+
+  std::cout << "Following " << inputFilename << std::endl;
+  bool isInputOpen = true;
+  while (isInputOpen) {
+    const LiveInput::ReadResult readResult = input.readMore(capture->pendingInput);
+    isInputOpen = readResult != LiveInput::ReadResult::Ended;
+    if (readResult == LiveInput::ReadResult::Truncated) {
+      capture = std::make_unique<Capture>();
+      outputText.clear();
+      appendOutputTitle(outputText);
+      if (!outputFile.write(outputText)) {
+        return 1;
+      }
+      continue;
+    }
+
+    WorldState& worldState = capture->worldState;
+    WorldStateWorkingData& workingData = capture->workingData;
+    std::string& pendingInput = capture->pendingInput;
+    size_t& stackNodesWritten = capture->stackNodesWritten;
+
+    // once the input has ended, whatever's left is the last record.
+    size_t completeRecordsEnd = isInputOpen ? 0 : pendingInput.size();
+    std::string_view record;
+    while (CAP::RecordFraming::readCompleteRecord(pendingInput, completeRecordsEnd, record)) {}
+    if (completeRecordsEnd == 0) {
+      continue;
+    }
+
+    const std::string& inputContents = capture->processedInput.emplace_back(pendingInput, 0, completeRecordsEnd);
+    pendingInput.erase(0, completeRecordsEnd);
+
+    ParsedChunk chunk = parseChunk(inputContents, 0, inputContents.size());
+    const size_t chunkFirstLineNumber = workingData.intputFileLineNumber;
+    processChunk(chunk, chunkFirstLineNumber, workingData, worldState, capture->stackNodeCount, replayThreadCount);
+    workingData.intputFileLineNumber = chunkFirstLineNumber + chunk.recordCount;
+
+    outputText.clear();
+    for (auto&& channelMapLine : worldState.getChannelArrayMap()) {
+      size_t& channelLinesWritten = capture->uniqueProcessIdToChannelLinesWritten[channelMapLine.first];
+      for (; channelLinesWritten < channelMapLine.second.size(); ++channelLinesWritten) {
+        appendChannelLine(outputText, *channelMapLine.second[channelLinesWritten].get());
+      }
+    }
+    if (!outputFile.write(outputText)) {
+      return 1;
+    }
+
+    size_t finalStackNodeCount = stackNodesWritten;
+    while (finalStackNodeCount < worldState.getStackNodeCount()
+        && worldState.getStackNode(finalStackNodeCount).logLineType != CapLogType::BLOCK_CONCAT_BEGIN) {
+      ++finalStackNodeCount;
+    }
+    if (!writeStackNodes(outputFile, worldState, stackNodesWritten, finalStackNodeCount, replayThreadCount)) {
+      return 1;
+    }
+    stackNodesWritten = finalStackNodeCount;
+  }
+
+  std::cout << "Input closed" << std::endl;
+  return 0;
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
   CAP_LOG_BLOCK_NO_THIS(CAP::CHANNEL::main);
-  // if (argc != 4) {
-  if (argc != 3) {
-    std::cout << "Usage: processClog [input clogfile.clog] [output file] [liveMode | completedMode]";
+  // completedMode (the default) processes a finished capture and writes everything at the end.
+  // liveMode follows a capture that's still being written; see runLiveMode.
+  std::string_view mode = argc == 4 ? argv[3] : "completedMode";
+  if ((argc != 3 && argc != 4) || (mode != "liveMode" && mode != "completedMode")) {
+    std::cout << "Usage: processClog [input clogfile.clog] [output file] [liveMode | completedMode]" << std::endl;
+    std::cout << "  in liveMode the input can be - for stdin" << std::endl;
     return 0;
   }
   char* inputFilename = argv[1];
   char* outputFilename = argv[2];
-  // std::string mode = argv[3];
 
-  // if (mode != "liveMode" || mode != "completedMode") {
-  //   std::cout << "Usage: processClog [input clogfile.clog] [output file] [liveMode | completedMode]";
-  //   return 0;
-  // }
-
-  // size_t inputFileSize = getFileSize(inputFilename);
-  size_t inputFileLineCount = countLines(inputFilename);
+  if (mode == "liveMode") {
+    return runLiveMode(inputFilename, outputFilename);
+  }
 
-  std::ifstream fileStream(inputFilename);
+  MappedInputFile inputFile(inputFilename);
+  if (!inputFile.isOpen()) {
+    std::cerr << "Unable to open input file " << inputFilename << std::endl;
+    return 1;
+  }
+  std::string_view inputContents = inputFile.contents();
 
-  OutputState output;
-  // output.outputText.reserve(inputFileSize * 2);
-  output.outputFileStream.open(outputFilename);
+  OutputFile outputFile(outputFilename);
+  if (!outputFile.isOpen()) {
+    std::cerr << "Unable to open output file " << outputFilename << std::endl;
+    return 1;
+  }
 
   WorldState worldState;
   WorldStateWorkingData worldWorkingData;
 
-  FileReadProgress progress(inputFileLineCount);
-
-  std::string inputLine;
-  while (std::getline(fileStream, inputLine)) {
-    CAP_LOG("%s", inputLine.c_str());
-    if (std::smatch piecesMatch; std::regex_search(inputLine, piecesMatch, caplogRegex)) {
-      worldWorkingData.inputLine = std::move(piecesMatch.str());
-      if (processLogLine(worldWorkingData, worldState)) {
-        // output.outputText.append 
-      } else if (processChannelLine(worldWorkingData, worldState)) {
-        // 
-      } else if (processLogLineCharLimit(worldWorkingData, worldState)) {
-        //
-      }
-      worldWorkingData.inPlace = std::nullopt;
-      worldWorkingData.inputLine = "";
+  FileReadProgress progress(inputContents.size());
+
+  // Chunks are parsed on worker threads while this thread replays the ones that are done, in
+  // order.  Only a few chunks are in flight at once so memory use doesn't grow with the input.
+  const size_t parseThreadCount = std::max(1u, std::thread::hardware_concurrency());
+  const size_t maxChunksInFlight = parseThreadCount * 2;
+  const std::vector<size_t> chunkBoundaries = splitIntoChunks(inputContents, parseChunkSize);
+
+  // with one core, chunks are parsed on this thread as they're needed.
+  const std::launch parseLaunchPolicy = parseThreadCount > 1 ? std::launch::async : std::launch::deferred;
+
+  std::deque<std::future<ParsedChunk>> chunksInFlight;
+  size_t nextChunkIdx = 0;
+  auto launchChunks = [&]() {
+    while (nextChunkIdx + 1 < chunkBoundaries.size() && chunksInFlight.size() < maxChunksInFlight) {
+      chunksInFlight.push_back(std::async(parseLaunchPolicy, parseChunk, inputContents,
+        chunkBoundaries[nextChunkIdx], chunkBoundaries[nextChunkIdx + 1]));
+      ++nextChunkIdx;
+    }
+  };
+
+  launchChunks();
+  size_t chunkIdx = 0;
+  size_t stackNodeCount = 0;
+  size_t inputOffset = 0;
+  while (!chunksInFlight.empty()) {
+    ParsedChunk chunk = chunksInFlight.front().get();
+    chunksInFlight.pop_front();
+    launchChunks();
+
+    if (chunk.beginOffset != inputOffset) {
+      // the last record of the previous chunk ran into this one.
+      chunk = parseChunk(inputContents, inputOffset, chunkBoundaries[chunkIdx + 1]);
     }
 
-    ++worldWorkingData.intputFileLineNumber;
-    progress.incrementProgress();
+    const size_t chunkFirstLineNumber = worldWorkingData.intputFileLineNumber;
+    processChunk(chunk, chunkFirstLineNumber, worldWorkingData, worldState, stackNodeCount, parseThreadCount);
+
+    worldWorkingData.intputFileLineNumber = chunkFirstLineNumber + chunk.recordCount;
+    inputOffset = chunk.endOffset;
+    progress.updateProgress(inputOffset);
+    ++chunkIdx;
   }
 
   std::cout << "Finished processessing input file.  Writing to output now." << std::endl;
 
-  output.outputFileStream << "************************************************************************" << std::endl << std::endl;
-  output.outputFileStream << "CAPTAINS LOG PROCESSED - VERSION 1" << std::endl << std::endl;
-  output.outputFileStream << "************************************************************************" << std::endl << std::endl;
+  std::string outputText;
+  appendOutputTitle(outputText);
   for (auto&& channelMapLine : worldState.getChannelArrayMap() ) {
-    output.outputFileStream << "CHANNEL INFO FOR PROCESS ID " << channelMapLine.first << std::endl;
+    outputText += "CHANNEL INFO FOR PROCESS ID ";
+    appendNumber(outputText, channelMapLine.first);
+    outputText += '\n';
     for(auto&& channelLinePtr : channelMapLine.second) {
-      auto& channelLine = *channelLinePtr.get();
-      output.outputFileStream
-        << "P=" << channelLine.uniqueProcessId
-        << " T=" << channelLine.uniqueThreadId
-        << " CHANNEL-ID=" << channelLine.channelId
-        << " : " << channelLine.enabledMode
-        << " : VERBOSITY=" << channelLine.verbosityLevel
-        << " : " << channelLine.channelName
-        << std::endl;
+      appendChannelLine(outputText, *channelLinePtr.get());
     }
-    output.outputFileStream << std::endl;
+    outputText += '\n';
   }
 
-  output.outputFileStream << "************************************************************************" << std::endl << std::endl;
+  outputText += "************************************************************************\n\n";
 
-  for (auto&& nodePtr : worldState.getNodeArray() ) {
-    auto& node = *nodePtr.get();
-    output.outputFileStream
-      << "P=" << node.uniqueProcessId
-      << " T=" << node.uniqueThreadId
-      << " C=" << node.commonLogText.channelId
-      << " " << node.commonLogText.indentation
-      << " " << node.commonLogText.functionId
-      << " " << node.commonLogText.sourceFileLine;
-    
-    switch (node.logLineType) {
-      case CapLogType::BLOCK_SCOPE_OPEN:
-        // intentional fall through
-      case CapLogType::BLOCK_SCOPE_CLOSE:
-        output.outputFileStream << "::[" 
-          << node.blockText.filename << "]::["
-          << node.blockText.functionName << "] "
-          << node.blockText.objectId;
-        break;
-      case CapLogType::BLOCK_INNER_LINE:
-        output.outputFileStream << " "
-          << node.messageText.innerTypeString
-          << ": " << node.messageText.innerPayload;
-        break;
-      default:
-        std::cerr << "CapLogType::UNKNOWN line" << std::endl;
-        std::abort();
-    }
+  StackNodeOutputPositions positions;
+  positions.offsets.resize(worldState.getStackNodeCount());
+  positions.lines.resize(worldState.getStackNodeCount());
+  positions.outputOffset = outputText.size();
+  positions.outputLine = std::count(outputText.begin(), outputText.end(), '\n');
+
+  if (!outputFile.write(outputText)
+      || !writeStackNodes(outputFile, worldState, 0, worldState.getStackNodeCount(), parseThreadCount, &positions)) {
+    return 1;
+  }
 
-    output.outputFileStream << std::endl;
+  std::cout << "Writing index." << std::endl;
+  if (!writeClogIndex(std::string(outputFilename) + ".clogidx", worldState, positions)) {
+    return 1;
   }
 
   std::cout << "Complete" << std::endl;
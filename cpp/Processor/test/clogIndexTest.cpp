@@ -0,0 +1,228 @@
+#include "Processor/src/clogIndex.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Checks the .clogidx processClog wrote for each processed log against the processed log itself:
+// every lookup ClogIndex::Reader has is compared with what's on the node's line.
+//   clogIndexTest.out [processed file]...
+// (each processed file's index is [processed file].clogidx)
+
+namespace {
+
+// the CapLogType values processClog stores in Node::logLineType.
+constexpr uint32_t blockScopeOpen = 0;
+constexpr uint32_t blockScopeClose = 1;
+
+size_t gFailures = 0;
+
+void fail(std::string_view what, uint64_t nodeIdx, std::string_view line) {
+  if (++gFailures <= 10) {
+    std::cerr << "FAILED: " << what << " for node " << nodeIdx << " on line: " << line << std::endl;
+  }
+}
+
+bool contains(const ClogIndex::NodeList& nodes, uint64_t nodeIdx) {
+  return std::binary_search(nodes.begin(), nodes.end(), nodeIdx);
+}
+
+bool ascending(const ClogIndex::NodeList& nodes) {
+  return std::is_sorted(nodes.begin(), nodes.end())
+    && std::adjacent_find(nodes.begin(), nodes.end()) == nodes.end();
+}
+
+// A node's line is "P=[process] T=[thread] C=[channel] [indentation] [function id] ..." (see
+// appendStackNode in processClog.cpp); the indentation ends in ╔ on an open and ╚ on a close.
+struct NodeLine {
+  uint64_t uniqueProcessId = 0;
+  uint64_t uniqueThreadId = 0;
+  std::string_view channelId;
+  std::string_view indentation;
+  // the function name, for opens and closes.
+  std::string_view functionName;
+};
+
+bool parseNumberField(std::string_view& rest, std::string_view prefix, uint64_t& value) {
+  if (rest.substr(0, prefix.size()) != prefix) {
+    return false;
+  }
+  rest.remove_prefix(prefix.size());
+  const size_t end = rest.find(' ');
+  if (end == std::string_view::npos || end == 0) {
+    return false;
+  }
+  value = std::stoull(std::string(rest.substr(0, end)));
+  rest.remove_prefix(end + 1);
+  return true;
+}
+
+bool parseNodeLine(std::string_view line, NodeLine& nodeLine) {
+  std::string_view rest = line;
+  if (!parseNumberField(rest, "P=", nodeLine.uniqueProcessId) || !parseNumberField(rest, "T=", nodeLine.uniqueThreadId)) {
+    return false;
+  }
+  if (rest.substr(0, 2) != "C=") {
+    return false;
+  }
+  rest.remove_prefix(2);
+  const size_t channelEnd = rest.find(' ');
+  if (channelEnd == std::string_view::npos) {
+    return false;
+  }
+  nodeLine.channelId = rest.substr(0, channelEnd);
+  rest.remove_prefix(channelEnd + 1);
+
+  const size_t indentationEnd = rest.find(' ');
+  if (indentationEnd == std::string_view::npos) {
+    return false;
+  }
+  nodeLine.indentation = rest.substr(0, indentationEnd);
+  rest.remove_prefix(indentationEnd + 1);
+
+  // [source line]::[file]::[function name] [object id]
+  const size_t filenameBegin = rest.find("]::[");
+  const size_t functionNameBegin = filenameBegin == std::string_view::npos ? filenameBegin : rest.find("]::[", filenameBegin + 4);
+  const size_t functionNameEnd = rest.rfind("] ");
+  if (functionNameBegin != std::string_view::npos && functionNameEnd != std::string_view::npos && functionNameEnd > functionNameBegin) {
+    nodeLine.functionName = rest.substr(functionNameBegin + 4, functionNameEnd - functionNameBegin - 4);
+  }
+  return true;
+}
+
+bool endsWith(std::string_view text, std::string_view suffix) {
+  return text.size() >= suffix.size() && text.substr(text.size() - suffix.size()) == suffix;
+}
+
+bool checkProcessedFile(const std::string& processedFilename) {
+  std::ifstream processedStream(processedFilename, std::ios::binary);
+  if (!processedStream.is_open()) {
+    std::cerr << "Unable to open " << processedFilename << std::endl;
+    return false;
+  }
+  const std::string processed((std::istreambuf_iterator<char>(processedStream)), std::istreambuf_iterator<char>());
+
+  ClogIndex::Reader reader((processedFilename + ".clogidx").c_str());
+  if (!reader.isOpen()) {
+    std::cerr << "Unable to read " << processedFilename << ".clogidx" << std::endl;
+    return false;
+  }
+
+  if (!reader.isCurrentFor(processedFilename.c_str())) {
+    fail("outputFileSize " + std::to_string(reader.header().outputFileSize) + " isn't the file's size", ClogIndex::noNode, processedFilename);
+  }
+
+  // where each line of the processed file starts.
+  std::vector<uint64_t> lineOffsets;
+  for (size_t offset = 0; offset < processed.size(); offset = processed.find('\n', offset) + 1) {
+    lineOffsets.push_back(offset);
+    if (processed.find('\n', offset) == std::string::npos) {
+      break;
+    }
+  }
+  auto lineText = [&](uint64_t outputLine) {
+    const size_t begin = lineOffsets[outputLine];
+    const size_t end = processed.find('\n', begin);
+    return std::string_view(processed).substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+  };
+
+  const size_t nodeCount = reader.nodeCount();
+  for (uint64_t nodeIdx = 0; nodeIdx < nodeCount; ++nodeIdx) {
+    const ClogIndex::Node& node = reader.node(nodeIdx);
+    if (node.outputLine >= lineOffsets.size() || lineOffsets[node.outputLine] != node.outputOffset) {
+      fail("outputOffset isn't the start of outputLine", nodeIdx, "");
+      continue;
+    }
+    const std::string_view line = lineText(node.outputLine);
+    if (nodeIdx > 0 && reader.node(nodeIdx - 1).outputLine >= node.outputLine) {
+      fail("nodes aren't in output order", nodeIdx, line);
+    }
+
+    NodeLine nodeLine;
+    if (!parseNodeLine(line, nodeLine)) {
+      fail("outputOffset isn't a node's line", nodeIdx, line);
+      continue;
+    }
+
+    // every line from this node's up to the next node's is this node's.
+    const uint64_t nextLine = nodeIdx + 1 < nodeCount ? reader.node(nodeIdx + 1).outputLine : lineOffsets.size();
+    for (uint64_t outputLine = node.outputLine; outputLine < nextLine; ++outputLine) {
+      if (reader.nodeOnOutputLine(outputLine) != nodeIdx) {
+        fail("nodeOnOutputLine(" + std::to_string(outputLine) + ")", nodeIdx, line);
+      }
+    }
+
+    const ClogIndex::NodeList threadNodes = reader.threadNodes(nodeLine.uniqueProcessId, nodeLine.uniqueThreadId);
+    if (!ascending(threadNodes) || !contains(threadNodes, nodeIdx)) {
+      fail("threadNodes", nodeIdx, line);
+    }
+    const ClogIndex::NodeList channelNodes = reader.channelNodes(nodeLine.channelId);
+    if (!ascending(channelNodes) || !contains(channelNodes, nodeIdx)) {
+      fail("channelNodes", nodeIdx, line);
+    }
+
+    const bool isOpen = endsWith(nodeLine.indentation, "╔");
+    const bool isClose = endsWith(nodeLine.indentation, "╚");
+    if (isOpen != (node.logLineType == blockScopeOpen) || isClose != (node.logLineType == blockScopeClose)) {
+      fail("logLineType", nodeIdx, line);
+    }
+    if (isOpen) {
+      const ClogIndex::NodeList functionCalls = reader.functionCalls(nodeLine.functionName);
+      if (!ascending(functionCalls) || !contains(functionCalls, nodeIdx)) {
+        fail("functionCalls(" + std::string(nodeLine.functionName) + ")", nodeIdx, line);
+      }
+    }
+
+    if (node.pairedIdx != ClogIndex::noNode) {
+      const ClogIndex::Node& paired = reader.node(node.pairedIdx);
+      NodeLine pairedLine;
+      if (paired.pairedIdx != nodeIdx
+          || !(isOpen ? paired.logLineType == blockScopeClose && node.pairedIdx > nodeIdx : isClose && paired.logLineType == blockScopeOpen && node.pairedIdx < nodeIdx)
+          || !parseNodeLine(lineText(paired.outputLine), pairedLine)
+          || pairedLine.functionName != nodeLine.functionName
+          || paired.threadIdx != node.threadIdx) {
+        fail("pairedIdx", nodeIdx, line);
+      }
+    }
+
+    // each scope in the call stack is an open on the same thread, before this node, that isn't
+    // closed yet at this node; and the stack is as deep as the indentation.
+    const std::vector<uint64_t> callStack = reader.callStack(nodeIdx);
+    uint64_t innerScopeIdx = nodeIdx;
+    for (uint64_t scopeIdx : callStack) {
+      const ClogIndex::Node& scope = reader.node(scopeIdx);
+      if (scope.logLineType != blockScopeOpen
+          || scope.threadIdx != node.threadIdx
+          || scopeIdx >= innerScopeIdx
+          || (scope.pairedIdx != ClogIndex::noNode && scope.pairedIdx < nodeIdx)) {
+        fail("callStack", nodeIdx, line);
+        break;
+      }
+      innerScopeIdx = scopeIdx;
+    }
+    // the indentation has one character per enclosing scope, then the node's own (3 bytes each).
+    if ((callStack.size() + 1) * 3 != nodeLine.indentation.size()) {
+      fail("callStack depth " + std::to_string(callStack.size()), nodeIdx, line);
+    }
+  }
+
+  std::cout << processedFilename << ": " << nodeCount << " nodes checked" << std::endl;
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  for (int argIdx = 1; argIdx < argc; ++argIdx) {
+    if (!checkProcessedFile(argv[argIdx])) {
+      return 1;
+    }
+  }
+
+  std::cout << gFailures << " failures" << std::endl;
+  return gFailures == 0 ? 0 : 1;
+}
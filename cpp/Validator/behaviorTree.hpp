@@ -80,7 +80,7 @@ public:
       const FuncString& funcString = currLine.funcString;
 
       if (funcString.isCtor) {
-        state.processIdToState[currLine.node.uniqueProcessId].idToObjects[currLine.node.blockText.objectId].push_back(ObjectData{funcString.name, currLine.node.uniqueProcessId, currLine.node.uniqueThreadId});
+        state.processIdToState[currLine.node.uniqueProcessId].idToObjects[std::string(currLine.node.blockText.objectId)].push_back(ObjectData{funcString.name, currLine.node.uniqueProcessId, currLine.node.uniqueThreadId});
         
         if (state.validationOStream) {
           (*state.validationOStream) << "[Memo] | Line [" << state.lineIndex << "] | CTOR | ProcessId: [" << currLine.node.uniqueProcessId << "] | ObjectId: [" << currLine.node.blockText.objectId 
@@ -88,7 +88,7 @@ public:
           state.validationOStream->flush();
         }
       } else if (funcString.isDtor) {
-        auto& objects = state.processIdToState[currLine.node.uniqueProcessId].idToObjects[currLine.node.blockText.objectId];
+        auto& objects = state.processIdToState[currLine.node.uniqueProcessId].idToObjects[std::string(currLine.node.blockText.objectId)];
         for (auto it = objects.begin(); it != objects.end();) {
           if (it->className == funcString.className) {
             it = objects.erase(it);
@@ -150,7 +150,7 @@ private:
 };
 
 struct BehaviorTree {
-  NodeStatus execute(const StackNode& stackNode) {
+  NodeStatus execute(const StackNodeView& stackNode) {
     CurrentLine currLine {
       .node = stackNode,
       .funcString = getFuncName(stackNode),
@@ -21,7 +21,7 @@ struct ProcessState {
 
 struct BehaviorTreeState {
   std::unordered_map<size_t, ProcessState> processIdToState;
-  std::ofstream* validationOStream = nullptr;
+  std::ostream* validationOStream = nullptr;
   int lineIndex = 0;
 };
 
@@ -47,7 +47,7 @@ struct ScanLine {
 };
 
 struct CurrentLine {
-  const StackNode& node;
+  const StackNodeView& node;
 
   // only valid when (node.logLineType == CapLogType::BLOCK_SCOPE_OPEN or BLOCK_SCOPE_CLOSE)  
   FuncString funcString;
@@ -23,14 +23,14 @@ template <class V, class ... Args> auto make_vector_unique(Args ... args) {
 }
 ////
 
-FuncString getFuncName(const StackNode& stackNode) {
+FuncString getFuncName(const StackNodeView& stackNode) {
   FuncString ret;
   if (stackNode.blockText.objectId == "0x0") {
     return ret;
   }
 
   ret.valid = true;
-  const std::string& str = stackNode.blockText.functionName;
+  std::string_view str = stackNode.blockText.functionName;
 
   /*
   references:
@@ -93,14 +93,14 @@ FuncString getFuncName(const StackNode& stackNode) {
 
 // Scanned lines are in this format:
 // Label | key: [value] | key2: [value2] | etc.
-ScanLine parseScanLine(const StackNode& stackNode) {
+ScanLine parseScanLine(const StackNodeView& stackNode) {
   ScanLine ret;
   if (stackNode.logLineType != CapLogType::BLOCK_INNER_LINE) {
     return ret;
   }
 
   ret.valid = true;
-  const std::string& str = stackNode.messageText.innerPayload;
+  std::string_view str = stackNode.messageText.innerPayload;
 
   // first character is always a space, and everything before first pipe char is assumed to be the label (or entire line if no pipe)
   size_t nextTokenSet = str.find(" | ");
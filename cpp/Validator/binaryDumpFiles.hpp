@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * The files that clients' binary dumps go to.  A client usually streams many dumps into the same
+ * file, so the files are kept open between dumps: at most maxOpenFiles at a time, closing the least
+ * recently written one to make room.  Dumps are added to the end of the file with pwrite, straight
+ * from wherever they were received, and nothing is fsync'd until syncAll at the end of the session.
+ *
+ * Safe to use from any thread; writes to the same file are made one at a time.
+ **/
+class BinaryDumpFiles {
+public:
+  static constexpr const size_t maxOpenFiles = 32;
+
+  // the files are created in directory.
+  explicit BinaryDumpFiles(std::string directory) : mDirectory(std::move(directory)) {}
+
+  ~BinaryDumpFiles() {
+    for (auto& [filename, openFile] : mOpenFiles) {
+      close(openFile.fd);
+    }
+  }
+
+  BinaryDumpFiles(const BinaryDumpFiles&) = delete;
+  BinaryDumpFiles& operator=(const BinaryDumpFiles&) = delete;
+
+  // adds bytes to the end of filename (created if it doesn't exist yet).
+  void write(std::string_view filename, std::string_view bytes) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    OpenFile* openFile = getOpenFile(filename);
+    if (!openFile) {
+      return;
+    }
+
+    while (!bytes.empty()) {
+      ssize_t written = pwrite(openFile->fd, bytes.data(), bytes.size(), openFile->offset);
+      if (written < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        perror("Unable to write binary dump");
+        return;
+      }
+      bytes.remove_prefix(written);
+      openFile->offset += written;
+    }
+  }
+
+  // fsyncs every file written this session, including the ones that have since been closed.
+  void syncAll() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (auto& [filename, openFile] : mOpenFiles) {
+      fsync(openFile.fd);
+    }
+    for (const std::string& filename : mClosedFiles) {
+      int fd = open(getPath(filename).c_str(), O_WRONLY | O_CLOEXEC);
+      if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+      }
+    }
+    mClosedFiles.clear();
+  }
+
+private:
+  struct OpenFile {
+    int fd;
+    // where the next write goes; the end of the file.
+    off_t offset;
+    // when it was last written, in writes since the session started.
+    uint64_t lastUsed;
+  };
+
+  // so the maps can be looked up with a view of the dump.
+  struct StringHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view string) const {
+      return std::hash<std::string_view>{}(string);
+    }
+  };
+
+  std::string getPath(std::string_view filename) const {
+    return mDirectory + "/" + std::string(filename);
+  }
+
+  OpenFile* getOpenFile(std::string_view filename) {
+    ++mUseCount;
+    if (auto openFileIter = mOpenFiles.find(filename); openFileIter != mOpenFiles.end()) {
+      openFileIter->second.lastUsed = mUseCount;
+      return &openFileIter->second;
+    }
+
+    if (mOpenFiles.size() >= maxOpenFiles) {
+      closeLeastRecentlyUsed();
+    }
+
+    std::string path = getPath(filename);
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+      perror(("Unable to open " + path).c_str());
+      return nullptr;
+    }
+
+    // dumps are appended to what's already there, like the files were opened to append.
+    struct stat fileStat;
+    off_t offset = fstat(fd, &fileStat) == 0 ? fileStat.st_size : 0;
+
+    return &mOpenFiles.emplace(std::string(filename), OpenFile{fd, offset, mUseCount}).first->second;
+  }
+
+  // maxOpenFiles is small, so this is a scan rather than keeping a list in order.
+  void closeLeastRecentlyUsed() {
+    auto leastRecentIter = mOpenFiles.begin();
+    for (auto openFileIter = mOpenFiles.begin(); openFileIter != mOpenFiles.end(); ++openFileIter) {
+      if (openFileIter->second.lastUsed < leastRecentIter->second.lastUsed) {
+        leastRecentIter = openFileIter;
+      }
+    }
+    close(leastRecentIter->second.fd);
+    mClosedFiles.insert(leastRecentIter->first);
+    mOpenFiles.erase(leastRecentIter);
+  }
+
+  std::string mDirectory;
+
+  std::mutex mMutex;
+  std::unordered_map<std::string, OpenFile, StringHash, std::equal_to<>> mOpenFiles;
+  // files written this session that have been closed since, so syncAll knows to sync them.
+  std::unordered_set<std::string, StringHash, std::equal_to<>> mClosedFiles;
+  uint64_t mUseCount = 0;
+};
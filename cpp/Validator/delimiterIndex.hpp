@@ -0,0 +1,167 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DELIMITER_INDEX_X86 1
+#endif
+
+/**
+ * Finds every delimiter in a line in one pass, so the StringExtractors that pick the line apart
+ * look up where the next delimiter is instead of each searching the same bytes again.
+ *
+ * For each delimiter there's a bitmap with a bit per byte of the line, set where the byte is that
+ * delimiter.  It's built with AVX2 or SSE2 when the CPU has them (checked once at runtime) and a
+ * byte at a time otherwise; the result is the same either way (Validator/test/delimiterIndexTest.cpp
+ * checks this).
+ **/
+class DelimiterIndex {
+public:
+  // The first chars of the patterns StringExtractor searches for (see CapLogMatcher).  Patterns
+  // that start with anything else are searched for without the index.
+  static constexpr std::array<char, 3> delimiters = {' ', ':', ']'};
+
+  // Which bitmap c is in, or -1 if it isn't a delimiter.
+  static constexpr int delimiterSlot(char c) {
+    for (size_t slot = 0; slot < delimiters.size(); ++slot) {
+      if (delimiters[slot] == c) {
+        return static_cast<int>(slot);
+      }
+    }
+    return -1;
+  }
+
+  enum class Implementation {
+    Scalar,
+    Sse2,
+    Avx2,
+  };
+
+  static bool isSupported(Implementation implementation) {
+    switch (implementation) {
+      case Implementation::Scalar:
+        return true;
+#if DELIMITER_INDEX_X86
+      case Implementation::Sse2:
+        return __builtin_cpu_supports("sse2");
+      case Implementation::Avx2:
+        return __builtin_cpu_supports("avx2");
+#endif
+      default:
+        return false;
+    }
+  }
+
+  // Uses the fastest implementation the CPU supports.
+  void build(std::string_view line) {
+    static const Implementation bestImplementation =
+      isSupported(Implementation::Avx2) ? Implementation::Avx2 :
+      isSupported(Implementation::Sse2) ? Implementation::Sse2 :
+      Implementation::Scalar;
+    build(line, bestImplementation);
+  }
+
+  // implementation has to be supported (see isSupported).
+  void build(std::string_view line, Implementation implementation) {
+    mLine = line;
+    mWordCount = (line.size() + 63) / 64;
+    mBits.assign(delimiters.size() * mWordCount, 0);
+    switch (implementation) {
+#if DELIMITER_INDEX_X86
+      case Implementation::Avx2:
+        buildAvx2(line.data(), line.size(), mBits.data(), mWordCount);
+        break;
+      case Implementation::Sse2:
+        buildSse2(line.data(), line.size(), mBits.data(), mWordCount);
+        break;
+#endif
+      default:
+        setBits(line.data(), 0, line.size(), mBits.data(), mWordCount);
+    }
+  }
+
+  std::string_view line() const {
+    return mLine;
+  }
+
+  // Whether text is part of the indexed line (eg. a capture of it).
+  bool contains(std::string_view text) const {
+    const uintptr_t lineBegin = reinterpret_cast<uintptr_t>(mLine.data());
+    const uintptr_t textBegin = reinterpret_cast<uintptr_t>(text.data());
+    return textBegin >= lineBegin && textBegin + text.size() <= lineBegin + mLine.size();
+  }
+
+  // The first position in [from, end) of the line that has the delimiter in slot, or npos.
+  template <int Slot>
+  size_t findNext(size_t from, size_t end) const {
+    static_assert(Slot >= 0 && Slot < static_cast<int>(delimiters.size()));
+    end = std::min(end, mLine.size());
+    if (from >= end) {
+      return std::string_view::npos;
+    }
+
+    const uint64_t* bits = mBits.data() + Slot * mWordCount;
+    size_t wordIdx = from / 64;
+    uint64_t word = bits[wordIdx] & (~uint64_t(0) << (from % 64));
+    while (true) {
+      if (word != 0) {
+        const size_t position = wordIdx * 64 + __builtin_ctzll(word);
+        return position < end ? position : std::string_view::npos;
+      }
+      if (++wordIdx * 64 >= end) {
+        return std::string_view::npos;
+      }
+      word = bits[wordIdx];
+    }
+  }
+
+private:
+  static void setBits(const char* line, size_t begin, size_t size, uint64_t* bits, size_t wordCount) {
+    for (size_t position = begin; position < size; ++position) {
+      for (size_t slot = 0; slot < delimiters.size(); ++slot) {
+        if (line[position] == delimiters[slot]) {
+          bits[slot * wordCount + position / 64] |= uint64_t(1) << (position % 64);
+        }
+      }
+    }
+  }
+
+#if DELIMITER_INDEX_X86
+  // 16 bytes at a time; 16 divides 64, so a block's mask never straddles two words.
+  __attribute__((target("sse2")))
+  static void buildSse2(const char* line, size_t size, uint64_t* bits, size_t wordCount) {
+    size_t position = 0;
+    for (; position + 16 <= size; position += 16) {
+      const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(line + position));
+      for (size_t slot = 0; slot < delimiters.size(); ++slot) {
+        const uint64_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8(delimiters[slot]))));
+        bits[slot * wordCount + position / 64] |= mask << (position % 64);
+      }
+    }
+    setBits(line, position, size, bits, wordCount);
+  }
+
+  __attribute__((target("avx2")))
+  static void buildAvx2(const char* line, size_t size, uint64_t* bits, size_t wordCount) {
+    size_t position = 0;
+    for (; position + 32 <= size; position += 32) {
+      const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(line + position));
+      for (size_t slot = 0; slot < delimiters.size(); ++slot) {
+        const uint64_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, _mm256_set1_epi8(delimiters[slot]))));
+        bits[slot * wordCount + position / 64] |= mask << (position % 64);
+      }
+    }
+    setBits(line, position, size, bits, wordCount);
+  }
+#endif
+
+  std::string_view mLine;
+  size_t mWordCount = 0;
+  // delimiters.size() bitmaps of mWordCount words each, one after the other.
+  std::vector<uint64_t> mBits;
+};
@@ -0,0 +1,266 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+
+class GroupCommitFile;
+
+/**
+ * The thread that writes every GroupCommitFile.  A file's data is written once there's
+ * commitBytes of it, or once the oldest of it has waited commitInterval, so writing a line or
+ * flushing a stream never waits on the disk, and each write() carries many lines.  One thread does
+ * it for all the files rather than one each, so files that come and go with clients don't bring
+ * a thread each with them.
+ **/
+class GroupCommitWriter {
+public:
+  static constexpr const size_t commitBytes = 64 * 1024;
+  static constexpr const std::chrono::milliseconds commitInterval{50};
+
+  static GroupCommitWriter& get() {
+    static GroupCommitWriter writer;
+    return writer;
+  }
+
+  // Writes everything that's been written to every file so far, before returning; for shutting
+  // down and for before aborting.
+  void flushAll();
+
+private:
+  friend class GroupCommitFile;
+
+  GroupCommitWriter() : mThread([this]() { run(); }) {}
+
+  ~GroupCommitWriter() {
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mIsStopping = true;
+    }
+    mWake.notify_one();
+    mThread.join();
+  }
+
+  void addFile(GroupCommitFile* file) {
+    std::lock_guard<std::mutex> lock(mFilesMutex);
+    mFiles.push_back(file);
+  }
+
+  void removeFile(GroupCommitFile* file) {
+    std::lock_guard<std::mutex> lock(mFilesMutex);
+    mFiles.erase(std::find(mFiles.begin(), mFiles.end(), file));
+  }
+
+  // a file had nothing waiting and now does.
+  void notifyPending() {
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mHasPending = true;
+    }
+    mWake.notify_one();
+  }
+
+  // a file has commitBytes waiting.
+  void notifyFull() {
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mHasPending = true;
+      mIsFull = true;
+    }
+    mWake.notify_one();
+  }
+
+  void run() {
+    // signals are left to the threads that handle them (eg. the socket server's shutdown).
+    sigset_t allSignals;
+    sigfillset(&allSignals);
+    pthread_sigmask(SIG_BLOCK, &allSignals, nullptr);
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true) {
+      // sleeps until there's something to write, then gives it commitInterval to grow.
+      mWake.wait(lock, [this]() { return mIsStopping || mHasPending; });
+      mWake.wait_for(lock, commitInterval, [this]() { return mIsStopping || mIsFull; });
+      if (mIsStopping) {
+        return;
+      }
+      mHasPending = false;
+      mIsFull = false;
+
+      lock.unlock();
+      flushAll();
+      lock.lock();
+    }
+  }
+
+  // guards mHasPending, mIsFull and mIsStopping.
+  std::mutex mMutex;
+  std::condition_variable mWake;
+  bool mHasPending = false;
+  bool mIsFull = false;
+  bool mIsStopping = false;
+
+  std::mutex mFilesMutex;
+  std::vector<GroupCommitFile*> mFiles;
+
+  std::thread mThread;
+};
+
+/**
+ * A file that's written by the GroupCommitWriter.  append only copies the data into the file's
+ * pending buffer; it's written in order, in big blocks, by the writer thread (or by flushToDisk).
+ * Everything's written by the time it's destroyed.
+ **/
+class GroupCommitFile {
+public:
+  enum OpenMode { Truncate, Append };
+
+  explicit GroupCommitFile(const std::string& filename, OpenMode openMode = Truncate) {
+    mFd = open(filename.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC | (openMode == Append ? O_APPEND : O_TRUNC), 0644);
+    if (mFd < 0) {
+      perror(("Unable to open " + filename).c_str());
+    }
+    GroupCommitWriter::get().addFile(this);
+  }
+
+  ~GroupCommitFile() {
+    GroupCommitWriter::get().removeFile(this);
+    flushToDisk();
+    if (mFd >= 0) {
+      close(mFd);
+    }
+  }
+
+  GroupCommitFile(const GroupCommitFile&) = delete;
+  GroupCommitFile& operator=(const GroupCommitFile&) = delete;
+
+  bool isOpen() const {
+    return mFd >= 0;
+  }
+
+  void append(std::string_view data) {
+    if (mFd < 0 || data.empty()) {
+      return;
+    }
+
+    bool wasEmpty;
+    bool isFull;
+    {
+      std::lock_guard<std::mutex> lock(mPendingMutex);
+      wasEmpty = mPending.empty();
+      mPending.append(data);
+      isFull = mPending.size() >= GroupCommitWriter::commitBytes && mPending.size() - data.size() < GroupCommitWriter::commitBytes;
+    }
+
+    if (isFull) {
+      GroupCommitWriter::get().notifyFull();
+    } else if (wasEmpty) {
+      GroupCommitWriter::get().notifyPending();
+    }
+  }
+
+  // writes everything appended so far, before returning.
+  void flushToDisk() {
+    // held while writing, so blocks are written in the order they were appended.
+    std::lock_guard<std::mutex> writeLock(mWriteMutex);
+    {
+      std::lock_guard<std::mutex> lock(mPendingMutex);
+      mWriting.swap(mPending);
+    }
+
+    std::string_view remaining(mWriting);
+    while (!remaining.empty()) {
+      ssize_t written = write(mFd, remaining.data(), remaining.size());
+      if (written < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        perror("GroupCommitFile write");
+        break;
+      }
+      remaining.remove_prefix(written);
+    }
+    mWriting.clear();
+  }
+
+private:
+  int mFd = -1;
+
+  std::mutex mPendingMutex;
+  std::string mPending;
+
+  std::mutex mWriteMutex;
+  // the block being written; swapped with mPending so both keep their capacity.
+  std::string mWriting;
+};
+
+inline void GroupCommitWriter::flushAll() {
+  std::lock_guard<std::mutex> lock(mFilesMutex);
+  for (GroupCommitFile* file : mFiles) {
+    file->flushToDisk();
+  }
+}
+
+/**
+ * An ostream onto a GroupCommitFile.  Flushing it (eg. std::endl) hands what's been streamed so
+ * far to the file, which is a copy rather than a write().
+ **/
+class GroupCommitOStream : public std::ostream {
+public:
+  explicit GroupCommitOStream(const std::string& filename, GroupCommitFile::OpenMode openMode = GroupCommitFile::Truncate)
+    : std::ostream(nullptr), mFile(filename, openMode), mStreamBuf(mFile) {
+    rdbuf(&mStreamBuf);
+    if (!mFile.isOpen()) {
+      setstate(std::ios::badbit);
+    }
+  }
+
+  ~GroupCommitOStream() {
+    flush();
+  }
+
+private:
+  class StreamBuf : public std::streambuf {
+  public:
+    explicit StreamBuf(GroupCommitFile& file) : mFile(file) {
+      setp(mBuffer, mBuffer + sizeof(mBuffer));
+    }
+
+  protected:
+    int_type overflow(int_type c) override {
+      sync();
+      if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+      }
+      return traits_type::not_eof(c);
+    }
+
+    int sync() override {
+      mFile.append(std::string_view(pbase(), pptr() - pbase()));
+      setp(mBuffer, mBuffer + sizeof(mBuffer));
+      return 0;
+    }
+
+  private:
+    GroupCommitFile& mFile;
+    char mBuffer[4096];
+  };
+
+  GroupCommitFile mFile;
+  StreamBuf mStreamBuf;
+};
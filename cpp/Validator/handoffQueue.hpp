@@ -0,0 +1,148 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+/**
+ * Hands items from the socket server's I/O threads to a processing thread.  Any number of threads
+ * can push; one thread pops, and waits on a condition variable while there's nothing to pop (no
+ * polling).  Items are moved out in batches, so there's one lock per batch rather than per item.
+ *
+ * It's bounded: each item is pushed with its size (eg. its bytes), and once what's waiting adds up
+ * to capacity, push waits for the processing thread to take it.  A processing thread that falls
+ * behind holds up the threads feeding it, rather than the items piling up in memory.
+ *
+ * Or, with the *Overflow versions of push and popAll, what doesn't fit goes to an overflow (eg. a
+ * LineBatchSpill) that has:
+ *   AppendResult appendIfNotEmpty(const T&)  adds the item if the overflow has items; Empty if it
+ *                                            hasn't, Appended, or Failed if it couldn't add it
+ *   bool append(const T&)                    returns false if it couldn't add the item
+ *   size_t getSize() const                   0 once the processing thread has taken everything
+ *                                            in it
+ * The processing thread takes the items in the queue first, then the ones in the overflow.
+ **/
+template <typename T>
+class HandoffQueue {
+public:
+  struct Metrics {
+    // the size of what's waiting now, and the most that's waited at once.
+    size_t depth = 0;
+    size_t highWaterMark = 0;
+    // how many pushes found the queue full, and how long they waited for room in all.
+    uint64_t fullCount = 0;
+    std::chrono::nanoseconds fullWaitTime{0};
+  };
+
+  // a capacity of 0 is unbounded.
+  explicit HandoffQueue(size_t capacity = 0) : mCapacity(capacity) {}
+
+  // waits while the queue is full.  An item bigger than capacity still gets in, once the queue's
+  // empty.
+  void push(T&& item, size_t size = 1) {
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      if (isFull(size)) {
+        ++mMetrics.fullCount;
+        const auto waitBegin = std::chrono::steady_clock::now();
+        mNotFull.wait(lock, [&]() { return !isFull(size); });
+        mMetrics.fullWaitTime += std::chrono::steady_clock::now() - waitBegin;
+      }
+      add(std::move(item), size);
+    }
+    mNotEmpty.notify_one();
+  }
+
+  // Pushes item, or adds it to overflow if there's no room for it, or if overflow has items (so the
+  // ones after them stay in order).  Which one it goes to is decided with the queue locked, and
+  // popAllOrOverflow waits with it locked, so an item added to overflow can't be missed.  If
+  // overflow has items but can't take this one, it waits for the processing thread to empty
+  // overflow rather than let item get ahead of them.  Returns false, leaving item as it was, if
+  // overflow is empty and couldn't take it; nothing's ahead of item then, so it can be push'd.
+  template <typename Overflow>
+  bool pushOrOverflow(T& item, size_t size, Overflow& overflow) {
+    using AppendResult = typename Overflow::AppendResult;
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      AppendResult appendResult;
+      while ((appendResult = overflow.appendIfNotEmpty(item)) == AppendResult::Failed) {
+        mNotFull.wait(lock, [&]() { return overflow.getSize() == 0; });
+      }
+      if (appendResult == AppendResult::Empty) {
+        if (!isFull(size)) {
+          add(std::move(item), size);
+        } else {
+          ++mMetrics.fullCount;
+          if (!overflow.append(item)) {
+            return false;
+          }
+        }
+      }
+    }
+    mNotEmpty.notify_one();
+    return true;
+  }
+
+  // waits until there's at least one item, then replaces the contents of items with everything in
+  // the queue, oldest first.
+  void popAll(std::vector<T>& items) {
+    items.clear();
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mNotEmpty.wait(lock, [this]() { return !mItems.empty(); });
+      takeAll(items);
+    }
+    mNotFull.notify_all();
+  }
+
+  // Like popAll, but for a queue that's pushed with pushOrOverflow: waits until there's something
+  // in the queue or in overflow.  items can be left empty, if it's all in overflow; what's in the
+  // queue was pushed before anything in overflow, so it's to be taken first.
+  template <typename Overflow>
+  void popAllOrOverflow(std::vector<T>& items, const Overflow& overflow) {
+    items.clear();
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      if (mItems.empty() && overflow.getSize() == 0) {
+        // overflow's been emptied, which pushOrOverflow may be waiting for.
+        mNotFull.notify_all();
+        mNotEmpty.wait(lock, [&]() { return !mItems.empty() || overflow.getSize() != 0; });
+      }
+      takeAll(items);
+    }
+    mNotFull.notify_all();
+  }
+
+  Metrics getMetrics() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mMetrics;
+  }
+
+private:
+  bool isFull(size_t size) const {
+    return mCapacity != 0 && mMetrics.depth != 0 && mMetrics.depth + size > mCapacity;
+  }
+
+  void add(T&& item, size_t size) {
+    mItems.push_back(std::move(item));
+    mMetrics.depth += size;
+    mMetrics.highWaterMark = std::max(mMetrics.highWaterMark, mMetrics.depth);
+  }
+
+  void takeAll(std::vector<T>& items) {
+    // swapped, so the two vectors' storage gets reused back and forth.
+    items.swap(mItems);
+    mMetrics.depth = 0;
+  }
+
+  const size_t mCapacity;
+
+  mutable std::mutex mMutex;
+  std::condition_variable mNotEmpty;
+  std::condition_variable mNotFull;
+  std::vector<T> mItems;
+  Metrics mMetrics;
+};
@@ -5,30 +5,37 @@
 #include <string>
 #include <fstream>
 #include <unordered_map>
+#include <unordered_set>
 #include <map>
 #include <memory>
 #include <optional>
 #include <vector>
 #include <cassert>
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cstdlib>
 #include <assert.h>
 #include <cmath> // for progress bar
+#include <cstring>
+#include <limits>
 #include <string>
 
+#include "delimiterIndex.hpp"
+
 // #include <CaptainsLog/caplogger.hpp>
 
 /*
 ------------------------------------------------------------------------------
 CHANNEL MESSAGE (always the first caplog message to get displayed per process)
 ------------------------------------------------------------------------------
-1         2            3   4                5             6               7     8
-CAP_LOG : P=4165984483 T=0 CHANNEL-ID=002 : ENABLED=YES : VERBOSITY : 0 : >  >  RENDER_SUB_CHANNEL_A
+1         2            3   4                     5             6               7     8
+CAP_LOG : P=4165984483 T=0 CHANNEL-ID=bcdf644c : ENABLED=YES : VERBOSITY : 0 : >  >  RENDER_SUB_CHANNEL_A
 
 1 - main delimiter
 2 - process timestamp (used to uniquely identify this log to the process).  Remaps to a smaller number in vsix.
 3 - relative thread id
-4 - channel ID (3 digits)
+4 - channel ID (8 hex digits; a hash of the channel name, see channelIdFromName)
 5 - If the channel is enabled or not
 6 - verbosity level
 7 - tabs to show channel hierarchical relationship
@@ -38,15 +45,15 @@ CAP_LOG : P=4165984483 T=0 CHANNEL-ID=002 : ENABLED=YES : VERBOSITY : 0 : >  >
 LOG LINES:
 ------------------------------------------------------------------------------
 
-1         2            3   4     5  6 7     8           9                                               10
-CAP_LOG : P=4293102038 T=0 C=005 :F 3 [25]::[test.cpp]::[something::TestNetwork::TestNetwork()] 0x7ffecc005730
-CAP_LOG : P=4293102038 T=0 C=005 :-> 3 [25] LOG: Testing format = hello
-CAP_LOG : P=4293102038 T=0 C=005 :L 3 [25]::[test.cpp]::[something::TestNetwork::TestNetwork()] 0x7ffecc005730
+1         2            3   4          5  6 7     8           9                                               10
+CAP_LOG : P=4293102038 T=0 C=60b0d865 :F 3 [25]::[test.cpp]::[something::TestNetwork::TestNetwork()] 0x7ffecc005730
+CAP_LOG : P=4293102038 T=0 C=60b0d865 :-> 3 [25] LOG: Testing format = hello
+CAP_LOG : P=4293102038 T=0 C=60b0d865 :L 3 [25]::[test.cpp]::[something::TestNetwork::TestNetwork()] 0x7ffecc005730
 
 1 - main delimiter
 2 - process timestamp (used to uniquely identify this log to the process).  Remaps to a smaller number in vsix.
 3 - relative thread id
-4 - channel ID (3 digits)
+4 - channel ID (8 hex digits; a hash of the channel name, see channelIdFromName)
 5 - CAP_PRIMARY_LOG_BEGIN_DELIMITER (start of block)
     F = start of block
     -> = log within block
@@ -59,97 +66,173 @@ CAP_LOG : P=4293102038 T=0 C=005 :L 3 [25]::[test.cpp]::[something::TestNetwork:
 10 - *this* pointer
 */
 
+// A string literal that can be a template parameter, eg. Pattern<"P=">.
+template <size_t Size>
+struct PatternString {
+  char chars[Size];
+
+  constexpr PatternString(const char (&string)[Size]) {
+    std::copy_n(string, Size, chars);
+  }
+
+  constexpr std::string_view view() const {
+    // without the terminating null
+    return std::string_view(chars, Size - 1);
+  }
+};
+
+template <PatternString String, bool IsNothingBeforeFirst = false, bool IsOptional = false>
 struct Pattern {
-  std::string_view string;
-  bool isNothingBeforeFirst = false;
-  bool isOptional = false;
+  static constexpr std::string_view string = String.view();
+  static constexpr bool isNothingBeforeFirst = IsNothingBeforeFirst;
+  static constexpr bool isOptional = IsOptional;
+
+  static_assert(!string.empty(), "patterns can't be empty");
+
+  // Where string is in inputString at or after from, or npos.  The fields between patterns are
+  // short, so this looks for the first char with memchr and compares the (fixed length) rest,
+  // rather than paying for memmem's setup on every call.
+  static size_t find(std::string_view inputString, size_t from) {
+    const char* searchEnd = inputString.data() + inputString.size();
+    const char* candidate = inputString.data() + std::min(from, inputString.size());
+    while (static_cast<size_t>(searchEnd - candidate) >= string.size()) {
+      candidate = static_cast<const char*>(std::memchr(candidate, string[0], searchEnd - candidate - string.size() + 1));
+      if (!candidate) {
+        break;
+      }
+      if constexpr (string.size() == 1) {
+        return candidate - inputString.data();
+      } else if (std::memcmp(candidate + 1, string.data() + 1, string.size() - 1) == 0) {
+        return candidate - inputString.data();
+      }
+      ++candidate;
+    }
+    return std::string_view::npos;
+  }
 
-  Pattern(std::string_view string, bool isNothingBeforeFirst = false, bool isOptional = false) : string(string), isNothingBeforeFirst(isNothingBeforeFirst), isOptional(isOptional) {}
+  // Same as find, but looks the first char up in index, which inputString is part of.
+  static size_t find(std::string_view inputString, size_t from, const DelimiterIndex& index) {
+    constexpr int slot = DelimiterIndex::delimiterSlot(string[0]);
+    if constexpr (slot < 0) {
+      return find(inputString, from);
+    } else {
+      const size_t inputOffset = inputString.data() - index.line().data();
+      if (inputString.size() < string.size()) {
+        return std::string_view::npos;
+      }
+      const size_t searchEnd = inputOffset + inputString.size() - string.size() + 1;
+      for (size_t candidate = index.findNext<slot>(inputOffset + from, searchEnd);
+           candidate != std::string_view::npos;
+           candidate = index.findNext<slot>(candidate + 1, searchEnd)) {
+        if (std::memcmp(index.line().data() + candidate + 1, string.data() + 1, string.size() - 1) == 0) {
+          return candidate - inputOffset;
+        }
+      }
+      return std::string_view::npos;
+    }
+  }
+
+  static bool isAt(std::string_view inputString, size_t at) {
+    return inputString.size() >= at + string.size()
+      && std::memcmp(inputString.data() + at, string.data(), string.size()) == 0;
+  }
 };
 
+/**
+ * The patterns are template parameters, so match unrolls into one fixed length compare or search
+ * per pattern.  A search is a lookup in the line's DelimiterIndex when there is one, and a memchr
+ * otherwise.
+ **/
+template <typename... Patterns>
 struct StringExtractor {
   // number of captures will be number of (patterns * 2) + 1
-  // eg: for a pattern like {PatternToken{"aa"}, PatternToken{"bb"}, PatternToken{"cc"}}
+  // eg: for a pattern like StringExtractor<Pattern<"aa">, Pattern<"bb">, Pattern<"cc">>
   // the captures will be like 
   // <capture before><capture "aa"><capture between><capture "bb"><capture between><capture "cc"><capture end>
-  StringExtractor(std::vector<Pattern> matchPatterns) : matchPatterns(matchPatterns) {
-    captures.reserve((matchPatterns.size() * 2) + 1);
+  using Captures = std::array<std::string_view, (sizeof...(Patterns) * 2) + 1>;
+
+  // The captures are views into inputString; nothing is allocated.  If inputString is part of the
+  // line index was built for, the delimiters are looked up in it instead of searched for.
+  std::optional<Captures> match(std::string_view inputString, const DelimiterIndex* index = nullptr) const {
+    MatchState state{inputString};
+    state.index = (index && index->contains(inputString)) ? index : nullptr;
+    if (!(matchPattern<Patterns>(state) && ...)) {
+      if (state.isFailed) {
+        return std::nullopt;
+      }
+      return state.captures;
+    }
+
+    state.captures[state.captureCount++] = inputString.substr(state.lastEnd, inputString.size() - state.lastEnd);
+
+    // if the tail of the patterns are all optionals, this covers failed optionals at the end of the string.
+    // eg. one for "\n" and one for the ignore at the end.
+    state.captureCount += state.failedOptionalMatchCount * 2;
+
+    assert(state.captureCount == state.captures.size());
+
+    return state.captures;
   }
 
-  bool match(std::string_view inputString) {
-    captures.clear();
-    
+private:
+  struct MatchState {
+    std::string_view inputString;
+    const DelimiterIndex* index = nullptr;
+    Captures captures = {};
+    size_t captureCount = 0;
     size_t lastStart = 0;
     size_t lastEnd = 0;
-    int failedOptionalMatchCount = 0;
-    for(const auto& pattern : matchPatterns) {
-      if (pattern.isNothingBeforeFirst) {
-        std::string_view exactMatchCheck = inputString.substr(lastStart, pattern.string.size());
-        if (exactMatchCheck != pattern.string) {
-          if (pattern.isOptional) {
-            // although optional, it's first, so there's no string before this.
-            captures.push_back("");
-            captures.push_back("");
-            return true;
-          } else {
-            return false;
-          }
-        }
-        captures.push_back("");
-        std::string temp1 = std::string(exactMatchCheck);
-        captures.push_back(exactMatchCheck);
-        lastEnd = lastStart + pattern.string.size();
-      } else {
-        size_t patternStart = inputString.find(pattern.string, lastEnd);
-        if (patternStart == std::string::npos) {
-          if (pattern.isOptional) {
-            ++failedOptionalMatchCount;
-            continue;
-          } else {
-            return false;
-          }
-        }
-        
-        // each match matches the fixed pattern followed by a variable string.  The variable
-        // string ends when the next match starts.  Optional matches 
-        lastEnd = patternStart;
-        std::string temp1 = std::string(inputString.substr(lastStart, lastEnd - lastStart));
-        captures.push_back(inputString.substr(lastStart, lastEnd - lastStart));
-
-        // padding for failed optional parts.  For failed matches, the fixed string & the variable string
-        // are both empty.
-        for(int extraCount = 0; extraCount < failedOptionalMatchCount; ++extraCount) {
-          captures.push_back("");
-          captures.push_back("");
-        }
-        failedOptionalMatchCount = 0;
+    size_t failedOptionalMatchCount = 0;
+    // set when matching stopped because the line doesn't match (as opposed to an optional first
+    // pattern that's missing, which ends the match early).
+    bool isFailed = false;
+  };
 
-        lastStart = patternStart;
-        lastEnd = lastStart + pattern.string.size();
-        std::string temp2 = std::string(inputString.substr(lastStart, lastEnd - lastStart));
-        captures.push_back(inputString.substr(lastStart, lastEnd - lastStart));
+  // Returns false to stop matching.
+  template <typename MatchPattern>
+  static bool matchPattern(MatchState& state) {
+    if constexpr (MatchPattern::isNothingBeforeFirst) {
+      if (!MatchPattern::isAt(state.inputString, state.lastStart)) {
+        // although optional, it's first, so there's no string before this.
+        state.isFailed = !MatchPattern::isOptional;
+        return false;
+      }
+      state.captures[state.captureCount++] = "";
+      state.captures[state.captureCount++] = state.inputString.substr(state.lastStart, MatchPattern::string.size());
+      state.lastEnd = state.lastStart + MatchPattern::string.size();
+    } else {
+      size_t patternStart = state.index
+        ? MatchPattern::find(state.inputString, state.lastEnd, *state.index)
+        : MatchPattern::find(state.inputString, state.lastEnd);
+      if (patternStart == std::string_view::npos) {
+        if constexpr (MatchPattern::isOptional) {
+          ++state.failedOptionalMatchCount;
+          return true;
+        } else {
+          state.isFailed = true;
+          return false;
+        }
       }
-      lastStart = lastEnd;
-    }
-
-    std::string temp3 = std::string(inputString.substr(lastEnd, inputString.size() - lastEnd));
-    captures.push_back(inputString.substr(lastEnd, inputString.size() - lastEnd));
 
-    // if the tail of the patterns are all optionals, this loop covers failed optionals at the end of the string.
-    for(int extraCount = 0; extraCount < failedOptionalMatchCount; ++extraCount) {
-      captures.push_back(""); // eg. this will be for "\n"
-      captures.push_back(""); // eg. this is for the ignore at the end.
-    }
+      // each match matches the fixed pattern followed by a variable string.  The variable
+      // string ends when the next match starts.
+      state.captures[state.captureCount++] = state.inputString.substr(state.lastStart, patternStart - state.lastStart);
 
-    assert(captures.size() == (matchPatterns.size() * 2) + 1);
+      // padding for failed optional parts.  For failed matches, the fixed string & the variable string
+      // are both empty (captures start out empty).
+      state.captureCount += state.failedOptionalMatchCount * 2;
+      state.failedOptionalMatchCount = 0;
 
+      state.lastStart = patternStart;
+      state.lastEnd = patternStart + MatchPattern::string.size();
+      state.captures[state.captureCount++] = state.inputString.substr(state.lastStart, MatchPattern::string.size());
+    }
+    state.lastStart = state.lastEnd;
     return true;
   }
-
-  std::vector<Pattern> matchPatterns;
-  std::vector<std::string_view> captures;
 };
 
+// Immutable, so one (capLogMatcher) is shared by everything.
 struct CapLogMatcher {
   /**
   * This will match all the caplog logs
@@ -160,7 +243,7 @@ struct CapLogMatcher {
   * 4 - (ignore)
   * EG. "(.*)(CAP_LOG : )(.*)"
   **/
-  StringExtractor caplog{{Pattern{"CAP_LOG : "}, Pattern{"\n", false, true}}};
+  StringExtractor<Pattern<"CAP_LOG : ">, Pattern<"\n", false, true>> caplog;
 
   /**
   * DEPENDS ON caplog.captures[2]
@@ -172,7 +255,7 @@ struct CapLogMatcher {
   * 4 - after
   * EG. "()(P=)(.*)( )(.+?)"
   **/
-  StringExtractor processId{{Pattern{"P=", true}, {Pattern{" "}}}};
+  StringExtractor<Pattern<"P=", true>, Pattern<" ">> processId;
 
   /**
   * DEPENDS ON processId.captures[4]
@@ -182,7 +265,7 @@ struct CapLogMatcher {
   * 2 - (the size)
   * EG. "()(MAX-CHAR-SIZE=)(.+?)",
   **/
-  StringExtractor maxCharsLine{{Pattern{"MAX-CHAR-SIZE=", true}}};
+  StringExtractor<Pattern<"MAX-CHAR-SIZE=", true>> maxCharsLine;
 
   /**
   * DEPENDS ON processId.captures[4]
@@ -194,7 +277,7 @@ struct CapLogMatcher {
   * 4 - (tail)
   * EG. "()(T=)(.*)( )(.+?)"
   **/
-  StringExtractor threadId{{Pattern{"T=", true}, {Pattern{" "}}}};
+  StringExtractor<Pattern<"T=", true>, Pattern<" ">> threadId;
 
   /**
   * DEPENDS ON threadId.captures[4]
@@ -211,12 +294,12 @@ struct CapLogMatcher {
   * EG(match): "()(CHANNEL-ID=)(.+?)( : )(.+?)( : VERBOSITY=)(.+?)( : )(.+?)"
   * EG(full):  CAP_LOG : P=2211240112 T=0 CHANNEL-ID=000 : FULLY ENABLED         : VERBOSITY=0 : >  DEFAULT
   **/
-  StringExtractor channelLine{{
-    Pattern{"CHANNEL-ID=", true},
-    Pattern{" : "},
-    Pattern{" : VERBOSITY="},
-    Pattern{" : "}
-  }};
+  StringExtractor<
+    Pattern<"CHANNEL-ID=", true>,
+    Pattern<" : ">,
+    Pattern<" : VERBOSITY=">,
+    Pattern<" : ">
+  > channelLine;
 
 
   /**
@@ -233,11 +316,11 @@ struct CapLogMatcher {
   * 6 - (Info String (everything after the prefix and Indentation marker)
   * EG(match): "()(C=)(.+?)( )(.+?)( )(.*)"
   **/
-  StringExtractor logLine{{
-    Pattern{"C=", true},
-    Pattern{" "},
-    Pattern{" "}
-  }};
+  StringExtractor<
+    Pattern<"C=", true>,
+    Pattern<" ">,
+    Pattern<" ">
+  > logLine;
 
   /**
   * DEPENDS ON logLine.captures[6]
@@ -248,10 +331,10 @@ struct CapLogMatcher {
   * 4 - (Info string body; the remainder of the string.  Changes depending on log type.)
   * EG(match): "(.+?)( \\[)(.+?)(])(.*)"
   **/  
-  StringExtractor infoStringCommon{{
-    Pattern{" ["},
-    Pattern{"]"},
-  }};
+  StringExtractor<
+    Pattern<" [">,
+    Pattern<"]">
+  > infoStringCommon;
 
   /**
   * DEPENDS ON infoStringCommon.captures[4]
@@ -266,11 +349,11 @@ struct CapLogMatcher {
   * 6 - (The object id.  In c++ this is the "this" pointer - or 0 if none)
   * EG: "(::\\[)(.*)(\\]::\\[)(.*)(\\] )([0-9a-z]+)",
   **/
-  StringExtractor infoStringBlock{{
-    Pattern{"::["},
-    Pattern{"]::["},
-    Pattern{"] "},
-  }};
+  StringExtractor<
+    Pattern<"::[">,
+    Pattern<"]::[">,
+    Pattern<"] ">
+  > infoStringBlock;
 
   /**
   * DEPENDS ON infoStringCommon.captures[4]
@@ -283,12 +366,32 @@ struct CapLogMatcher {
   * 4 - (inner message)
   * EG: " (.*?):(.*)"
   **/
-  StringExtractor infoStringInner{{
-    Pattern{" "},
-    Pattern{":"},
-  }};
+  StringExtractor<
+    Pattern<" ">,
+    Pattern<":">
+  > infoStringInner;
+};
+
+constexpr const CapLogMatcher capLogMatcher;
+
+/**
+ * The start of a line that every line type shares, matched once per line:
+ * processId is capLogMatcher.processId's captures for the line, and threadId is
+ * capLogMatcher.threadId's for the rest of it (if it has one; eg. MAX-CHAR-SIZE lines don't).
+ **/
+struct CapLogLineHead {
+  decltype(CapLogMatcher::processId)::Captures processId;
+  std::optional<decltype(CapLogMatcher::threadId)::Captures> threadId;
 };
 
+std::optional<CapLogLineHead> matchLineHead(std::string_view line, const DelimiterIndex* index) {
+  const auto processId = capLogMatcher.processId.match(line, index);
+  if (!processId) {
+    return std::nullopt;
+  }
+  return CapLogLineHead{*processId, capLogMatcher.threadId.match((*processId)[4], index)};
+}
+
 enum class CapLineType {
   CAPLOG,
   CHANNEL,
@@ -313,41 +416,43 @@ enum class CapLogInnerType {
   UNKNOWN,
 };
 
+// Views of WorldStateWorkingData::inputLine, so only valid while that line is being processed.
 struct InputLogLine {
   CapLogType inputLineType = CapLogType::UNKNOWN;
   int inputLineDepth;
 
-  std::string inputFullString;
-  std::string inputProcessId;
-  std::string inputThreadId;
-  std::string inputChannelId;
-  std::string inputIndentation;
-  std::string inputFunctionId;
-  std::string inputSourceFileLine;
-  std::string inputInfoString;
+  std::string_view inputFullString;
+  std::string_view inputProcessId;
+  std::string_view inputThreadId;
+  std::string_view inputChannelId;
+  std::string_view inputIndentation;
+  std::string_view inputFunctionId;
+  std::string_view inputSourceFileLine;
+  std::string_view inputInfoString;
 };
 
+// The output text lives in the WorldState's StackNodeArena (see WorldState::storeString).
 struct OutputLogTextCommon {
-  std::string channelId;
-  std::string indentation;
-  std::string functionId;
-  std::string sourceFileLine;
+  std::string_view channelId;
+  std::string_view indentation;
+  std::string_view functionId;
+  std::string_view sourceFileLine;
 };
 
 struct OutputLogTextBlock {
-  std::string filename;
-  std::string functionName;
-  std::string objectId;
+  std::string_view filename;
+  std::string_view functionName;
+  std::string_view objectId;
 };
 
 struct OutputLogTextMessage {
   // CapLogInnerType innerType; //may need later...
-  std::string innerTypeString; //x-macros this instead.
-  std::string innerPayload;
+  std::string_view innerTypeString; //x-macros this instead.
+  std::string_view innerPayload;
 };
 
 struct OutputLogData {
-  int lineDepth;
+  int lineDepth = 0;
   size_t uniqueProcessId;
   size_t uniqueThreadId;
 
@@ -360,11 +465,6 @@ struct OutputLogData {
 
   // logLineType = logs/error/set, if applicable
   OutputLogTextMessage messageText;
-
-  // incomplete string
-  bool isComplete = true;
-  std::string incompleteText;
-  std::string incompleteSpacePadding;
 };
 
 struct LoggedObject {
@@ -382,57 +482,89 @@ struct ChannelLine {
   std::string channelName;
 };
 
-// should rename this, this only represents CapLog types, not channels.
-struct StackNode {
-  StackNode(
-    int line,
-    OutputLogData&& logData,
-    StackNode* caller)
-    : line(line)
-    , depth(std::move(logData.lineDepth))
-    , uniqueProcessId(std::move(logData.uniqueProcessId))
-    , uniqueThreadId(std::move(logData.uniqueThreadId))
-    , commonLogText(std::move(logData.commonLogText))
-    , logLineType(std::move(logData.logLineType))
-    , blockText(std::move(logData.blockText))
-    , messageText(std::move(logData.messageText))
-    , caller(caller)
-    , isComplete(logData.isComplete)
-    , incompleteString(std::move(logData.incompleteText))
-    , incompleteSpacePadding(std::move(logData.incompleteSpacePadding))
-    , loggedObject(nullptr) {}
-
-  const int line;
-  const int depth;
-  const size_t uniqueProcessId;
-  const size_t uniqueThreadId;
-
-  OutputLogTextCommon commonLogText;
-  CapLogType logLineType = CapLogType::UNKNOWN;
+// callerIdx of a stack node with no caller.
+constexpr const size_t noStackNode = std::numeric_limits<size_t>::max();
+
+/**
+ * One stack node, as references into the WorldState's columns (see WorldState).  For code that
+ * looks at whole nodes one at a time, like writing them out or validating them; a scan over many
+ * nodes should read the columns it needs instead.  Only valid until the next node is added.
+ **/
+struct StackNodeView {
+  const size_t line;
+  const int& depth;
+  const size_t& uniqueProcessId;
+  const size_t& uniqueThreadId;
+  const CapLogType& logLineType;
+  // index of the calling node, or noStackNode.
+  const size_t& callerIdx;
+
+  const OutputLogTextCommon& commonLogText;
   //logLineType = block open/close, if applicable
-  OutputLogTextBlock blockText;
+  const OutputLogTextBlock& blockText;
   // logLineType = logs/error/set, if applicable
-  OutputLogTextMessage messageText;
+  const OutputLogTextMessage& messageText;
+};
+
+/**
+ * Bump allocator for the text of stack nodes.  Lines come in one at a time and don't outlive the
+ * read, so the text a node keeps is copied in here.  Nothing is freed until the arena is, and
+ * nothing moves as it grows, so the nodes can keep views of it.
+ **/
+class StackNodeArena {
+public:
+  // uninitialized space for charCount chars; it's valid for as long as the arena is.
+  char* allocateChars(size_t charCount) {
+    if (mCharBlocks.empty() || mCharBlocks.back().used + charCount > mCharBlocks.back().capacity) {
+      size_t capacity = mCharBlocks.empty() ? firstCharBlockSize : std::min(mCharBlocks.back().capacity * 2, maxCharBlockSize);
+      capacity = std::max(capacity, charCount);
+      mCharBlocks.push_back(CharBlock{std::make_unique<char[]>(capacity), capacity, 0});
+    }
+    CharBlock& charBlock = mCharBlocks.back();
+    char* chars = charBlock.chars.get() + charBlock.used;
+    charBlock.used += charCount;
+    return chars;
+  }
 
-  StackNode* caller;
+  std::string_view storeString(std::string_view string) {
+    char* chars = allocateChars(string.size());
+    std::memcpy(chars, string.data(), string.size());
+    return std::string_view(chars, string.size());
+  }
 
-  bool isComplete;
+private:
+  static constexpr const size_t firstCharBlockSize = 16 * 1024;
+  static constexpr const size_t maxCharBlockSize = 1024 * 1024;
 
-  std::string incompleteString;
-  std::string incompleteSpacePadding;
+  struct CharBlock {
+    std::unique_ptr<char[]> chars;
+    size_t capacity;
+    size_t used;
+  };
 
-  LoggedObject* loggedObject;
+  std::vector<CharBlock> mCharBlocks;
 };
 
+// The CONCAT pieces of a line, joined as they come in.  A thread only has one line in pieces at a
+// time.
+struct IncompleteLine {
+  std::string text;
+  std::string spacePadding;
+};
+
+/**
+ * Stack nodes are stored by column: one array per field, all indexed by the node's line.  Walking
+ * a thread's stack only touches the depth, type and caller columns, and nodes refer to their
+ * caller by index, so none of it is pointer chasing.  Use getStackNode for a view of one whole
+ * node.
+ **/
 class WorldState {
 public:
-  using StackNodeArray = std::vector<std::unique_ptr<StackNode>>;
   using ChannelArray = std::vector<std::unique_ptr<ChannelLine>>;
   using UniqueProcessIdToChannelArray = std::map<size_t, ChannelArray>;
 
   struct InPlace {
     size_t index;
-    StackNode* stackNode;
   };
 
   // should use expected, but that's only in c++23
@@ -456,44 +588,106 @@ public:
     return retLoggedObject;
   }
 
-  StackNode& addNewStackNode(
-      OutputLogData&& logData,
-      StackNode* caller,
+  size_t addNewStackNode(
+      const OutputLogData& logData,
+      size_t callerIdx,
       std::optional<InPlace> inPlace) {
     if (!inPlace) {
-      size_t stackNodeIdx = mStackNodeArray.size();
-      mStackNodeArray.emplace_back(std::make_unique<StackNode>(
-        stackNodeIdx, std::move(logData), caller));
-      mProcessToThreadToStackNodeIds[logData.uniqueProcessId][logData.uniqueThreadId].emplace_back(stackNodeIdx);
-      return *mStackNodeArray.back().get();
+      size_t stackNodeIdx = mDepths.size();
+      mDepths.push_back(logData.lineDepth);
+      mUniqueProcessIds.push_back(logData.uniqueProcessId);
+      mUniqueThreadIds.push_back(logData.uniqueThreadId);
+      mLogLineTypes.push_back(logData.logLineType);
+      mCallerIdxs.push_back(callerIdx);
+      mCommonLogTexts.push_back(logData.commonLogText);
+      mBlockTexts.push_back(logData.blockText);
+      mMessageTexts.push_back(logData.messageText);
+      mProcessToThreadToStackNodes[logData.uniqueProcessId][logData.uniqueThreadId].stackNodeIds.emplace_back(stackNodeIdx);
+      return stackNodeIdx;
     } else {
       size_t stackNodeIdx = inPlace.value().index;
-      mStackNodeArray[stackNodeIdx] = std::make_unique<StackNode>(
-        stackNodeIdx, std::move(logData), caller);
-      return *mStackNodeArray[stackNodeIdx].get();
+      mDepths[stackNodeIdx] = logData.lineDepth;
+      mUniqueProcessIds[stackNodeIdx] = logData.uniqueProcessId;
+      mUniqueThreadIds[stackNodeIdx] = logData.uniqueThreadId;
+      mLogLineTypes[stackNodeIdx] = logData.logLineType;
+      mCallerIdxs[stackNodeIdx] = callerIdx;
+      mCommonLogTexts[stackNodeIdx] = logData.commonLogText;
+      mBlockTexts[stackNodeIdx] = logData.blockText;
+      mMessageTexts[stackNodeIdx] = logData.messageText;
+      return stackNodeIdx;
     }
   }
 
-  StackNode* getStackNodeOnLine(size_t lineNumber) {
-    if (lineNumber < mStackNodeArray.size()) {
-      return mStackNodeArray[lineNumber].get();
-    } else {
-      return nullptr;
+  // copies text that a stack node keeps into the arena.
+  std::string_view storeString(std::string_view string) {
+    return mStackNodeArena.storeString(string);
+  }
+
+  // storeString for text that repeats from line to line (channels, functions, files...); each
+  // distinct string is only stored once.
+  std::string_view internString(std::string_view string) {
+    auto internedIter = mInternedStrings.find(string);
+    if (internedIter == mInternedStrings.end()) {
+      internedIter = mInternedStrings.insert(mStackNodeArena.storeString(string)).first;
     }
+    return *internedIter;
   }
 
-  std::tuple<size_t, StackNode*> getLastStackNodeForProcessThread(size_t uniqueProcessId, size_t uniqueThreadId) {
-    assert(mProcessToThreadToStackNodeIds.size() > uniqueProcessId);
-    assert(mProcessToThreadToStackNodeIds[uniqueProcessId].size() > uniqueThreadId);
-    if (!mProcessToThreadToStackNodeIds[uniqueProcessId][uniqueThreadId].empty()) {
-      size_t stackNodeIdx = mProcessToThreadToStackNodeIds[uniqueProcessId][uniqueThreadId].back();
-      return std::tuple<size_t, StackNode*>(stackNodeIdx, mStackNodeArray[stackNodeIdx].get());
+  // the output indentation for inputIndentation (see replaceIndentationChars), made once per
+  // distinct indentation.
+  template <typename ReplaceFunc>
+  std::string_view getReplacedIndentation(std::string_view inputIndentation, ReplaceFunc&& replace) {
+    auto replacedIter = mReplacedIndentations.find(inputIndentation);
+    if (replacedIter == mReplacedIndentations.end()) {
+      replacedIter = mReplacedIndentations.emplace(internString(inputIndentation), replace(inputIndentation, mStackNodeArena)).first;
     }
-    return std::tuple<size_t, StackNode*>(0, nullptr);
+    return replacedIter->second;
+  }
+
+  StackNodeArena& getStackNodeArena() {
+    return mStackNodeArena;
   }
 
-  const StackNodeArray& getNodeArray() const {
-    return mStackNodeArray;
+  size_t getStackNodeCount() const {
+    return mDepths.size();
+  }
+
+  StackNodeView getStackNode(size_t stackNodeIdx) const {
+    return StackNodeView{
+      stackNodeIdx,
+      mDepths[stackNodeIdx],
+      mUniqueProcessIds[stackNodeIdx],
+      mUniqueThreadIds[stackNodeIdx],
+      mLogLineTypes[stackNodeIdx],
+      mCallerIdxs[stackNodeIdx],
+      mCommonLogTexts[stackNodeIdx],
+      mBlockTexts[stackNodeIdx],
+      mMessageTexts[stackNodeIdx]};
+  }
+
+  std::optional<StackNodeView> getStackNodeOnLine(size_t lineNumber) const {
+    if (lineNumber < getStackNodeCount()) {
+      return getStackNode(lineNumber);
+    } else {
+      return std::nullopt;
+    }
+  }
+
+  // the type column, for scans that only need to know what kind of line each node is.
+  const std::vector<CapLogType>& getLogLineTypes() const {
+    return mLogLineTypes;
+  }
+
+  // the last node added for a thread, or noStackNode.
+  size_t getLastStackNodeForProcessThread(size_t uniqueProcessId, size_t uniqueThreadId) const {
+    assert(mProcessToThreadToStackNodes.size() > uniqueProcessId);
+    assert(mProcessToThreadToStackNodes[uniqueProcessId].size() > uniqueThreadId);
+    const IdxArray& stackNodeIds = mProcessToThreadToStackNodes[uniqueProcessId][uniqueThreadId].stackNodeIds;
+    return stackNodeIds.empty() ? noStackNode : stackNodeIds.back();
+  }
+
+  IncompleteLine& getIncompleteLine(size_t uniqueProcessId, size_t uniqueThreadId) {
+    return mProcessToThreadToStackNodes[uniqueProcessId][uniqueThreadId].incompleteLine;
   }
 
   ChannelLine& pushChannelLine(ChannelLine&& channelLine) {
@@ -506,14 +700,22 @@ public:
   }
 
   size_t newUniqueProcessId() {
-    auto retVal = mProcessToThreadToStackNodeIds.size();
-    mProcessToThreadToStackNodeIds.emplace_back();
+    auto retVal = mSharedNextUniqueProcessId ? (*mSharedNextUniqueProcessId)++ : mProcessToThreadToStackNodes.size();
+    // with shared ids this world only has some of them, and the rest are left empty.
+    mProcessToThreadToStackNodes.resize(retVal + 1);
     return retVal;
   }
 
+  // For WorldStates that process one session between them (eg. the socket server's shards, one
+  // per group of processes): they take their process ids from nextUniqueProcessId, so the ids
+  // don't overlap.
+  void shareUniqueProcessIds(std::atomic<size_t>* nextUniqueProcessId) {
+    mSharedNextUniqueProcessId = nextUniqueProcessId;
+  }
+
   size_t newUniqueThreadId(size_t uniqueProcessId) {
-    auto retVal = mProcessToThreadToStackNodeIds[uniqueProcessId].size();
-    mProcessToThreadToStackNodeIds[uniqueProcessId].emplace_back();
+    auto retVal = mProcessToThreadToStackNodes[uniqueProcessId].size();
+    mProcessToThreadToStackNodes[uniqueProcessId].emplace_back();
     return retVal;
   }
 
@@ -522,11 +724,30 @@ private:
 
   UniqueProcessIdToChannelArray mUniqueProcessIdToChannelArray;
 
-  StackNodeArray mStackNodeArray;
+  StackNodeArena mStackNodeArena;
+  // views of the arena.
+  std::unordered_set<std::string_view> mInternedStrings;
+  std::unordered_map<std::string_view, std::string_view> mReplacedIndentations;
+
+  // the stack node columns; all the same size.
+  std::vector<int> mDepths;
+  std::vector<size_t> mUniqueProcessIds;
+  std::vector<size_t> mUniqueThreadIds;
+  std::vector<CapLogType> mLogLineTypes;
+  std::vector<size_t> mCallerIdxs;
+  std::vector<OutputLogTextCommon> mCommonLogTexts;
+  std::vector<OutputLogTextBlock> mBlockTexts;
+  std::vector<OutputLogTextMessage> mMessageTexts;
 
   using IdxArray = std::vector<size_t>;
-  using ProcessToThreadToStackNodeIds = std::vector<std::vector<IdxArray>>;
-  ProcessToThreadToStackNodeIds mProcessToThreadToStackNodeIds;
+  struct ThreadStackNodes {
+    IdxArray stackNodeIds;
+    IncompleteLine incompleteLine;
+  };
+  using ProcessToThreadToStackNodes = std::vector<std::vector<ThreadStackNodes>>;
+  ProcessToThreadToStackNodes mProcessToThreadToStackNodes;
+
+  std::atomic<size_t>* mSharedNextUniqueProcessId = nullptr;
 };
 
 
@@ -534,7 +755,12 @@ class WorldStateWorkingData {
 public:
   // tracks what we've read so far in the file (files start counting from 1)
   size_t intputFileLineNumber = 1;
-  std::string inputLine;
+  // the caplog part of the line being processed; a view of the line read, or of concatenatedLine.
+  std::string_view inputLine;
+  // the line joined from CONCAT pieces, while it's being processed.
+  std::string concatenatedLine;
+  // built for inputLine whenever it's set, so the matchers can look its delimiters up.
+  DelimiterIndex delimiterIndex;
 
   // out lines don't line up with the input fiels for two reasons:
   // 1 - we filter out any non-cap-log messages
@@ -545,9 +771,11 @@ public:
   CapLineType lineType;
 
   // maybe use variants on this to better select the right type
-  std::unique_ptr<InputLogLine> inputLogLine;
-  std::unique_ptr<OutputLogData> outputLogData;
-  StackNode* prevStackNode = nullptr;
+  // reset for each line rather than reallocated.  Their text is views (of inputLine, then of the
+  // arena) and only gets copied when the stack node is added.
+  InputLogLine inputLogLine;
+  OutputLogData outputLogData;
+  size_t prevStackNodeIdx = noStackNode;
 
   // todo channel types.
   std::unique_ptr<ChannelLine> channelLine;
@@ -556,14 +784,14 @@ public:
 
   std::unordered_map<size_t, int> uniqueProcessIdToMaxCharLine;
 
-  size_t getUniqueProcessIdForInputProcessId(const std::string& inputProcessId, WorldState& world) {
+  size_t getUniqueProcessIdForInputProcessId(std::string_view inputProcessId, WorldState& world) {
     size_t retId;
     if (auto findUniqueProcessIdIter = mProcessToUniqueProcessId.find(inputProcessId);
         findUniqueProcessIdIter != mProcessToUniqueProcessId.end()) {
       retId = findUniqueProcessIdIter->second;
     } else {
       retId = world.newUniqueProcessId();
-      mProcessToUniqueProcessId[inputProcessId] = retId;
+      mProcessToUniqueProcessId.emplace(inputProcessId, retId);
       mUniqueProcessIdToInputThreadToUniqueThreadId[retId];
     }
 
@@ -571,7 +799,7 @@ public:
     return retId;
   }
 
-  size_t getUniqueThreadIdForInputThreadId(size_t uniqueProcessId, const std::string& inputThreadId, WorldState& world) {
+  size_t getUniqueThreadIdForInputThreadId(size_t uniqueProcessId, std::string_view inputThreadId, WorldState& world) {
     size_t retId;
     if (auto findThreadMapIter = mUniqueProcessIdToInputThreadToUniqueThreadId.find(uniqueProcessId);
         findThreadMapIter != mUniqueProcessIdToInputThreadToUniqueThreadId.end()) {
@@ -580,7 +808,7 @@ public:
         retId = findUniqueThreadIdIter->second;
       } else {
         retId = world.newUniqueThreadId(uniqueProcessId);
-        findThreadMapIter->second[inputThreadId] = retId;
+        findThreadMapIter->second.emplace(inputThreadId, retId);
       }
     } else {
       std::cerr << "Cannot find inputThreadId to UniqueId map for given uniqueProcessId" << std::endl;
@@ -592,12 +820,21 @@ public:
   }
 
 private:
-  std::unordered_map<std::string, size_t> mProcessToUniqueProcessId;
-  std::unordered_map<size_t, std::unordered_map<std::string, size_t>> mUniqueProcessIdToInputThreadToUniqueThreadId;
+  // so the maps can be looked up with a view of the line.
+  struct StringHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view string) const {
+      return std::hash<std::string_view>{}(string);
+    }
+  };
+  using StringToId = std::unordered_map<std::string, size_t, StringHash, std::equal_to<>>;
+
+  StringToId mProcessToUniqueProcessId;
+  std::unordered_map<size_t, StringToId> mUniqueProcessIdToInputThreadToUniqueThreadId;
 };
 
 struct OutputState {
-  std::ofstream outputFileStream;
+  std::unique_ptr<std::ostream> outputFileStream;
 };
 
 void failWithAbort(const WorldStateWorkingData& workingData, std::string additionalInfo = "") {
@@ -631,85 +868,86 @@ CapLogType getLineType(std::string_view inputIndentation) {
   return retType;
 }
 
-int getLineDepth(const std::string& inputIndentation) {
+int getLineDepth(std::string_view inputIndentation) {
   int retVal = inputIndentation.size();
   // std::cout << retVal << std::endl;
   return retVal;
 }
 
-std::string replaceIndentationChars (std::string inputIndentation) {
-  std::string outputIndentation;
-  for(int i = 0; i < inputIndentation.size(); i++) {
-    switch(inputIndentation[i]) {
-      case ':': outputIndentation += "║"; break;
-      case 'F': outputIndentation += "╔"; break;
-      case 'L': outputIndentation += "╚"; break;
-      case '-': outputIndentation += "╠"; break;
-      case '>': outputIndentation += "╾"; break;
-      default: outputIndentation.push_back(inputIndentation[i]); break;
+// written straight into the arena, so there's no temporary string per line.
+std::string_view replaceIndentationChars (std::string_view inputIndentation, StackNodeArena& arena) {
+  // each box drawing char is 3 bytes of utf-8
+  char* outputIndentation = arena.allocateChars(inputIndentation.size() * 3);
+  size_t outputSize = 0;
+  auto append = [&](std::string_view chars) {
+    std::memcpy(outputIndentation + outputSize, chars.data(), chars.size());
+    outputSize += chars.size();
+  };
+  for (char c : inputIndentation) {
+    switch (c) {
+      case ':': append("║"); break;
+      case 'F': append("╔"); break;
+      case 'L': append("╚"); break;
+      case '-': append("╠"); break;
+      case '>': append("╾"); break;
+      default: append(std::string_view(&c, 1)); break;
     }
   }
-  return outputIndentation;
+  return std::string_view(outputIndentation, outputSize);
 }
 
 void processIncompleteLineBegin (
     WorldStateWorkingData& workingData,
     WorldState& worldState) {
-  InputLogLine& inputLogLine = *workingData.inputLogLine.get();
-  OutputLogData& outputLogData = *workingData.outputLogData.get();
+  InputLogLine& inputLogLine = workingData.inputLogLine;
+  OutputLogData& outputLogData = workingData.outputLogData;
+  IncompleteLine& incompleteLine = worldState.getIncompleteLine(outputLogData.uniqueProcessId, outputLogData.uniqueThreadId);
 
-  outputLogData.isComplete = false;
-  outputLogData.incompleteText = inputLogLine.inputInfoString;
+  incompleteLine.text = inputLogLine.inputInfoString;
 
   int characterLimit = workingData.uniqueProcessIdToMaxCharLine[outputLogData.uniqueProcessId];
 
-  std::string padding;
-  for(int i = inputLogLine.inputFullString.size(); i < characterLimit; i++) {
-    padding += " ";
-  }
-  outputLogData.incompleteSpacePadding += padding;
-  worldState.addNewStackNode(std::move(outputLogData), workingData.prevStackNode, workingData.inPlace);
+  incompleteLine.spacePadding.assign(std::max(characterLimit - static_cast<int>(inputLogLine.inputFullString.size()), 0), ' ');
+  worldState.addNewStackNode(outputLogData, workingData.prevStackNodeIdx, workingData.inPlace);
 }
 
 void processIncompleteLineContinue (
     WorldStateWorkingData& workingData,
-    [[maybe_unused]] WorldState& worldState) {
-  InputLogLine& inputLogLine = *workingData.inputLogLine.get();
-  OutputLogData& outputLogData = *workingData.outputLogData.get();
+    WorldState& worldState) {
+  InputLogLine& inputLogLine = workingData.inputLogLine;
+  OutputLogData& outputLogData = workingData.outputLogData;
+  IncompleteLine& incompleteLine = worldState.getIncompleteLine(outputLogData.uniqueProcessId, outputLogData.uniqueThreadId);
 
-  workingData.prevStackNode->incompleteString += workingData.prevStackNode->incompleteSpacePadding;
-  workingData.prevStackNode->incompleteString += inputLogLine.inputInfoString;
+  incompleteLine.text += incompleteLine.spacePadding;
+  incompleteLine.text += inputLogLine.inputInfoString;
 
   int characterLimit = workingData.uniqueProcessIdToMaxCharLine[outputLogData.uniqueProcessId];
 
-  std::string padding;
-  for(int i = inputLogLine.inputFullString.size(); i < characterLimit; i++) {
-    padding += " ";
-  }
-  workingData.prevStackNode->incompleteSpacePadding = padding;
+  incompleteLine.spacePadding.assign(std::max(characterLimit - static_cast<int>(inputLogLine.inputFullString.size()), 0), ' ');
 }
 
 void processBlockScopeOpen (
     WorldStateWorkingData& workingData,
     WorldState& worldState) {
-  InputLogLine& inputLogLine = *workingData.inputLogLine.get();
-  OutputLogData& outputLogData = *workingData.outputLogData.get();
+  InputLogLine& inputLogLine = workingData.inputLogLine;
+  OutputLogData& outputLogData = workingData.outputLogData;
 
   int selfDepth = inputLogLine.inputLineDepth;
   int expectedSelfDepth = -1;
 
   // determine expected depth first, then do fix up if necessary
   // then get the caller node (which might be newly created)
-  if (workingData.prevStackNode) {
-    switch (workingData.prevStackNode->logLineType) {
+  if (workingData.prevStackNodeIdx != noStackNode) {
+    const StackNodeView prevStackNode = worldState.getStackNode(workingData.prevStackNodeIdx);
+    switch (prevStackNode.logLineType) {
       case CapLogType::BLOCK_SCOPE_OPEN:
-        expectedSelfDepth = workingData.prevStackNode->depth + 1;
+        expectedSelfDepth = prevStackNode.depth + 1;
         break;
       case CapLogType::BLOCK_INNER_LINE:
-        expectedSelfDepth = workingData.prevStackNode->depth;
+        expectedSelfDepth = prevStackNode.depth;
         break;
       case CapLogType::BLOCK_SCOPE_CLOSE:
-        expectedSelfDepth = workingData.prevStackNode->depth;
+        expectedSelfDepth = prevStackNode.depth;
         break;
       case CapLogType::BLOCK_CONCAT_BEGIN:
       case CapLogType::BLOCK_CONCAT_CONTINUE:
@@ -732,57 +970,58 @@ void processBlockScopeOpen (
     failWithAbort(workingData, "selfDepth != expectedSelfDepth || expectedSelfDepth < 1");
   }
 
-  StackNode* callerStackNode = nullptr;
-  if (workingData.prevStackNode) {
-    switch (workingData.prevStackNode->logLineType) {
+  size_t callerStackNodeIdx = noStackNode;
+  if (workingData.prevStackNodeIdx != noStackNode) {
+    const StackNodeView prevStackNode = worldState.getStackNode(workingData.prevStackNodeIdx);
+    switch (prevStackNode.logLineType) {
       case CapLogType::BLOCK_SCOPE_OPEN:
         // intentional fall-through
       case CapLogType::BLOCK_INNER_LINE:
-        callerStackNode = workingData.prevStackNode;
+        callerStackNodeIdx = workingData.prevStackNodeIdx;
         break;
       case CapLogType::BLOCK_SCOPE_CLOSE:
-        callerStackNode = workingData.prevStackNode->caller;
+        callerStackNodeIdx = prevStackNode.callerIdx;
         break;
       default:
         failWithAbort(workingData, "processBlockScopeOpen can't determine prev logline type");
     }
   } else {
-    callerStackNode = nullptr;
+    callerStackNodeIdx = noStackNode;
   }
 
-  CapLogMatcher matcher;
-  if (matcher.infoStringBlock.match(workingData.inputLogLine->inputInfoString)) {
-    outputLogData.blockText.filename = matcher.infoStringBlock.captures[2];
-    outputLogData.blockText.functionName = matcher.infoStringBlock.captures[4];
-    outputLogData.blockText.objectId = matcher.infoStringBlock.captures[6];
+  if (const auto blockCaptures = capLogMatcher.infoStringBlock.match(inputLogLine.inputInfoString, &workingData.delimiterIndex)) {
+    outputLogData.blockText.filename = worldState.internString((*blockCaptures)[2]);
+    outputLogData.blockText.functionName = worldState.internString((*blockCaptures)[4]);
+    outputLogData.blockText.objectId = worldState.internString((*blockCaptures)[6]);
   } else {
     failWithAbort(workingData, "Unable to match infoStringBlockMatch with expected block opening line");
   }
 
-  worldState.addNewStackNode(std::move(outputLogData), callerStackNode, workingData.inPlace);
+  worldState.addNewStackNode(outputLogData, callerStackNodeIdx, workingData.inPlace);
 }
 
 void processBlockScopeClose (
     WorldStateWorkingData& workingData,
     WorldState& worldState) {
-  InputLogLine& inputLogLine = *workingData.inputLogLine.get();
-  OutputLogData& outputLogData = *workingData.outputLogData.get();
+  InputLogLine& inputLogLine = workingData.inputLogLine;
+  OutputLogData& outputLogData = workingData.outputLogData;
 
   int selfDepth = inputLogLine.inputLineDepth;
   int expectedSelfDepth = -1;
 
   // determine expected depth first, then do fix up if necessary
   // then get the caller node (which might be newly created)
-  if (workingData.prevStackNode) {
-    switch (workingData.prevStackNode->logLineType) {
+  if (workingData.prevStackNodeIdx != noStackNode) {
+    const StackNodeView prevStackNode = worldState.getStackNode(workingData.prevStackNodeIdx);
+    switch (prevStackNode.logLineType) {
       case CapLogType::BLOCK_SCOPE_OPEN:
-        expectedSelfDepth = workingData.prevStackNode->depth;
+        expectedSelfDepth = prevStackNode.depth;
         break;
       case CapLogType::BLOCK_INNER_LINE:
-        expectedSelfDepth = workingData.prevStackNode->depth - 1;
+        expectedSelfDepth = prevStackNode.depth - 1;
         break;
       case CapLogType::BLOCK_SCOPE_CLOSE:
-        expectedSelfDepth = workingData.prevStackNode->depth - 1;
+        expectedSelfDepth = prevStackNode.depth - 1;
         break;
       case CapLogType::BLOCK_CONCAT_BEGIN:
       case CapLogType::BLOCK_CONCAT_CONTINUE:
@@ -805,60 +1044,61 @@ void processBlockScopeClose (
     failWithAbort(workingData, "selfDepth != expectedSelfDepth || expectedSelfDepth < 1");
   }
 
-  StackNode* callerStackNode = nullptr;
-  if (workingData.prevStackNode) {
-    switch (workingData.prevStackNode->logLineType) {
+  size_t callerStackNodeIdx = noStackNode;
+  if (workingData.prevStackNodeIdx != noStackNode) {
+    const StackNodeView prevStackNode = worldState.getStackNode(workingData.prevStackNodeIdx);
+    switch (prevStackNode.logLineType) {
       case CapLogType::BLOCK_SCOPE_OPEN:
         // intentional fall-through
       case CapLogType::BLOCK_INNER_LINE:
-        callerStackNode = workingData.prevStackNode->caller;
+        callerStackNodeIdx = prevStackNode.callerIdx;
         break;
       case CapLogType::BLOCK_SCOPE_CLOSE:
-        if (workingData.prevStackNode->caller == nullptr) {
+        if (prevStackNode.callerIdx == noStackNode) {
           failWithAbort(workingData, "workingData.prevStackNode->caller == nullptr");
         }
-        callerStackNode = workingData.prevStackNode->caller->caller;
+        callerStackNodeIdx = worldState.getStackNode(prevStackNode.callerIdx).callerIdx;
         break;
       default:
         failWithAbort(workingData, "processBlockScopeClose can't determine prev logline type");
     }
   } else {
-    callerStackNode = nullptr;
+    callerStackNodeIdx = noStackNode;
   }
     
-  CapLogMatcher matcher;
-  if (matcher.infoStringBlock.match(workingData.inputLogLine->inputInfoString)) {
-    outputLogData.blockText.filename = matcher.infoStringBlock.captures[2];
-    outputLogData.blockText.functionName = matcher.infoStringBlock.captures[4];
-    outputLogData.blockText.objectId = matcher.infoStringBlock.captures[6];
+  if (const auto blockCaptures = capLogMatcher.infoStringBlock.match(inputLogLine.inputInfoString, &workingData.delimiterIndex)) {
+    outputLogData.blockText.filename = worldState.internString((*blockCaptures)[2]);
+    outputLogData.blockText.functionName = worldState.internString((*blockCaptures)[4]);
+    outputLogData.blockText.objectId = worldState.internString((*blockCaptures)[6]);
   } else {
     failWithAbort(workingData, "processBlockScopeClose Unable to match infoStringBlockMatch with expected block opening line");
   }
 
-  worldState.addNewStackNode(std::move(outputLogData), callerStackNode, workingData.inPlace);
+  worldState.addNewStackNode(outputLogData, callerStackNodeIdx, workingData.inPlace);
 }
 
 void processBlockInnerLine (
     WorldStateWorkingData& workingData,
     WorldState& worldState) {
-  InputLogLine& inputLogLine = *workingData.inputLogLine.get();
-  OutputLogData& outputLogData = *workingData.outputLogData.get();
+  InputLogLine& inputLogLine = workingData.inputLogLine;
+  OutputLogData& outputLogData = workingData.outputLogData;
 
   int selfDepth = inputLogLine.inputLineDepth;
   int expectedSelfDepth = -1;
 
   // determine expected depth first, then do fix up if necessary
   // then get the caller node (which might be newly created)
-  if (workingData.prevStackNode) {
-    switch (workingData.prevStackNode->logLineType) {
+  if (workingData.prevStackNodeIdx != noStackNode) {
+    const StackNodeView prevStackNode = worldState.getStackNode(workingData.prevStackNodeIdx);
+    switch (prevStackNode.logLineType) {
       case CapLogType::BLOCK_SCOPE_OPEN:
-        expectedSelfDepth = workingData.prevStackNode->depth + 1;
+        expectedSelfDepth = prevStackNode.depth + 1;
         break;
       case CapLogType::BLOCK_INNER_LINE:
-        expectedSelfDepth = workingData.prevStackNode->depth;
+        expectedSelfDepth = prevStackNode.depth;
         break;
       case CapLogType::BLOCK_SCOPE_CLOSE:
-        expectedSelfDepth = workingData.prevStackNode->depth;
+        expectedSelfDepth = prevStackNode.depth;
         break;
       case CapLogType::BLOCK_CONCAT_BEGIN:
       case CapLogType::BLOCK_CONCAT_CONTINUE:
@@ -881,66 +1121,63 @@ void processBlockInnerLine (
     failWithAbort(workingData, "selfDepth != expectedSelfDepth || expectedSelfDepth < 1");
   }
 
-  StackNode* callerStackNode = nullptr;
-  if (workingData.prevStackNode) {
-    switch (workingData.prevStackNode->logLineType) {
+  size_t callerStackNodeIdx = noStackNode;
+  if (workingData.prevStackNodeIdx != noStackNode) {
+    const StackNodeView prevStackNode = worldState.getStackNode(workingData.prevStackNodeIdx);
+    switch (prevStackNode.logLineType) {
       case CapLogType::BLOCK_SCOPE_OPEN:
         // intentional fall-through
       case CapLogType::BLOCK_INNER_LINE:
-        callerStackNode = workingData.prevStackNode->caller;
+        callerStackNodeIdx = prevStackNode.callerIdx;
         break;
       case CapLogType::BLOCK_SCOPE_CLOSE:
-        if (workingData.prevStackNode->caller == nullptr) {
+        if (prevStackNode.callerIdx == noStackNode) {
           failWithAbort(workingData, "workingData.prevStackNode->caller == nullptr");
         }
-        callerStackNode = workingData.prevStackNode->caller->caller;
+        callerStackNodeIdx = worldState.getStackNode(prevStackNode.callerIdx).callerIdx;
         break;
       default:
         failWithAbort(workingData, "processBlockInnerLine can't determine prev logline type");
     }
   } else {
-    callerStackNode = nullptr;
+    callerStackNodeIdx = noStackNode;
   }
 
-  CapLogMatcher matcher;
-  if (matcher.infoStringInner.match(workingData.inputLogLine->inputInfoString)) {
-    outputLogData.messageText.innerTypeString = matcher.infoStringInner.captures[2];
-    outputLogData.messageText.innerPayload = matcher.infoStringInner.captures[4];
+  if (const auto innerCaptures = capLogMatcher.infoStringInner.match(inputLogLine.inputInfoString, &workingData.delimiterIndex)) {
+    outputLogData.messageText.innerTypeString = worldState.internString((*innerCaptures)[2]);
+    outputLogData.messageText.innerPayload = worldState.storeString((*innerCaptures)[4]);
   } else {
     failWithAbort(workingData, "processBlockInnerLine Unable to match infoStringBlockMatch with expected block opening line");
   }
 
-  worldState.addNewStackNode(std::move(outputLogData), callerStackNode, workingData.inPlace);
+  worldState.addNewStackNode(outputLogData, callerStackNodeIdx, workingData.inPlace);
 }
 
 bool processLogLine(
+    const CapLogLineHead& lineHead,
     WorldStateWorkingData& workingData,
     WorldState& worldState) {
-  CapLogMatcher matcher;
-  if (!matcher.processId.match(workingData.inputLine)) {
+  if (!lineHead.threadId) {
     return false;
   }
 
-  if (!matcher.threadId.match(matcher.processId.captures[4])) {
-    return false;
-  }
-  
-  if (!matcher.logLine.match(matcher.threadId.captures[4])) {
+  const auto logLineCaptures = capLogMatcher.logLine.match((*lineHead.threadId)[4], &workingData.delimiterIndex);
+  if (!logLineCaptures) {
     return false;
   }
 
   workingData.lineType = CapLineType::CAPLOG;
-  workingData.inputLogLine = std::make_unique<InputLogLine>();
-  workingData.outputLogData = std::make_unique<OutputLogData>();
-  InputLogLine& inputLogLine = *workingData.inputLogLine.get();
-  OutputLogData& outputLogData = *workingData.outputLogData.get();
+  InputLogLine& inputLogLine = workingData.inputLogLine;
+  OutputLogData& outputLogData = workingData.outputLogData;
+  inputLogLine = InputLogLine();
+  outputLogData = OutputLogData();
 
   inputLogLine.inputFullString = workingData.inputLine;
-  inputLogLine.inputProcessId = matcher.processId.captures[2];
-  inputLogLine.inputThreadId = matcher.threadId.captures[2];
-  inputLogLine.inputChannelId = matcher.logLine.captures[2];
-  inputLogLine.inputIndentation = matcher.logLine.captures[4];
-  inputLogLine.inputInfoString = matcher.logLine.captures[6];
+  inputLogLine.inputProcessId = lineHead.processId[2];
+  inputLogLine.inputThreadId = (*lineHead.threadId)[2];
+  inputLogLine.inputChannelId = (*logLineCaptures)[2];
+  inputLogLine.inputIndentation = (*logLineCaptures)[4];
+  inputLogLine.inputInfoString = (*logLineCaptures)[6];
 
   inputLogLine.inputLineType = getLineType(inputLogLine.inputIndentation);
   outputLogData.uniqueProcessId = workingData.getUniqueProcessIdForInputProcessId(inputLogLine.inputProcessId, worldState);
@@ -948,23 +1185,22 @@ bool processLogLine(
   outputLogData.logLineType = inputLogLine.inputLineType;
 
   // inputLogLine.inputLineDepth can resolve to a block open/close or inner log/error/set
-  auto&& [prevStackNodeIdx, prevStackNode] = worldState.getLastStackNodeForProcessThread(outputLogData.uniqueProcessId,
-                                                                                        outputLogData.uniqueThreadId);
-  workingData.prevStackNode = prevStackNode;
+  size_t prevStackNodeIdx = worldState.getLastStackNodeForProcessThread(outputLogData.uniqueProcessId,
+                                                                        outputLogData.uniqueThreadId);
+  workingData.prevStackNodeIdx = prevStackNodeIdx;
 
   if (workingData.inPlace) {
-    if (workingData.inPlace.value().stackNode != prevStackNode) {
-      failWithAbort(workingData, "AFTER INCOMPLETE LINE: workingData.inPlace.stackNode != prevStackNode");
-    } else if (workingData.inPlace.value().index != prevStackNodeIdx) {
+    const StackNodeView inPlaceStackNode = worldState.getStackNode(workingData.inPlace.value().index);
+    if (workingData.inPlace.value().index != prevStackNodeIdx) {
       failWithAbort(workingData, "AFTER INCOMPLETE LINE: workingData.inPlace.index != prevStackNodeIdx");
-    } else if (workingData.inPlace.value().stackNode->uniqueProcessId != outputLogData.uniqueProcessId) {
+    } else if (inPlaceStackNode.uniqueProcessId != outputLogData.uniqueProcessId) {
       failWithAbort(workingData, "AFTER INCOMPLETE LINE: workingData.inPlace.value().stackNode->uniqueProcessId != outputLogData.uniqueProcessId");
-    } else if (workingData.inPlace.value().stackNode->uniqueThreadId != outputLogData.uniqueThreadId) {
+    } else if (inPlaceStackNode.uniqueThreadId != outputLogData.uniqueThreadId) {
       failWithAbort(workingData, "AFTER INCOMPLETE LINE: workingData.inPlace.value().stackNode->uniqueThreadId != outputLogData.uniqueThreadId");
     }
 
     // since the "last stack node" in this case is the inplace one we're modifying, we need to set the previous stack node to it's previous.
-    workingData.prevStackNode = workingData.inPlace.value().stackNode->caller;
+    workingData.prevStackNodeIdx = inPlaceStackNode.callerIdx;
   }
 
   bool isCompleteLine = false;
@@ -973,36 +1209,44 @@ bool processLogLine(
       processIncompleteLineBegin(workingData, worldState);
       break;
     case CapLogType::BLOCK_CONCAT_CONTINUE:
-      if (!prevStackNode) {
+      if (prevStackNodeIdx == noStackNode) {
         failWithAbort(workingData, "Cannot concat; no previous node to concat to");
       }
       processIncompleteLineContinue(workingData, worldState);
       break;
-    case CapLogType::BLOCK_CONCAT_END:
-      workingData.inPlace = {prevStackNodeIdx, prevStackNode};
-      if(matcher.caplog.match(workingData.prevStackNode->incompleteString)) {
-        workingData.inputLine = matcher.caplog.captures[2];
+    case CapLogType::BLOCK_CONCAT_END: {
+      workingData.inPlace = {prevStackNodeIdx};
+      IncompleteLine& incompleteLine = worldState.getIncompleteLine(outputLogData.uniqueProcessId, outputLogData.uniqueThreadId);
+      workingData.concatenatedLine = std::move(incompleteLine.text);
+      if (const auto caplogCaptures = capLogMatcher.caplog.match(workingData.concatenatedLine)) {
+        workingData.inputLine = (*caplogCaptures)[2];
       } else {
-        workingData.inputLine = std::move(workingData.prevStackNode->incompleteString);
+        workingData.inputLine = workingData.concatenatedLine;
+      }
+      incompleteLine = IncompleteLine();
+      // the joined line is a new line, so it gets matched from the start.
+      workingData.delimiterIndex.build(workingData.inputLine);
+      if (const auto joinedLineHead = matchLineHead(workingData.inputLine, &workingData.delimiterIndex)) {
+        processLogLine(*joinedLineHead, workingData, worldState);
       }
-      processLogLine(workingData, worldState);
       break;
+    }
     default:
       isCompleteLine = true;
   }
 
   if (isCompleteLine) {
-    if (matcher.infoStringCommon.match(inputLogLine.inputInfoString)) {
-      inputLogLine.inputFunctionId = matcher.infoStringCommon.captures[0];
-      inputLogLine.inputSourceFileLine = matcher.infoStringCommon.captures[2];
-      inputLogLine.inputInfoString = matcher.infoStringCommon.captures[4]; //overwrite infoString with common part removed
+    if (const auto commonCaptures = capLogMatcher.infoStringCommon.match(inputLogLine.inputInfoString, &workingData.delimiterIndex)) {
+      inputLogLine.inputFunctionId = (*commonCaptures)[0];
+      inputLogLine.inputSourceFileLine = (*commonCaptures)[2];
+      inputLogLine.inputInfoString = (*commonCaptures)[4]; //overwrite infoString with common part removed
       inputLogLine.inputLineDepth = getLineDepth(inputLogLine.inputIndentation);
 
       outputLogData.lineDepth = inputLogLine.inputLineDepth;
-      outputLogData.commonLogText.channelId = inputLogLine.inputChannelId;
-      outputLogData.commonLogText.indentation = replaceIndentationChars(inputLogLine.inputIndentation);
-      outputLogData.commonLogText.functionId = inputLogLine.inputFunctionId;
-      outputLogData.commonLogText.sourceFileLine = inputLogLine.inputSourceFileLine;
+      outputLogData.commonLogText.channelId = worldState.internString(inputLogLine.inputChannelId);
+      outputLogData.commonLogText.indentation = worldState.getReplacedIndentation(inputLogLine.inputIndentation, replaceIndentationChars);
+      outputLogData.commonLogText.functionId = worldState.internString(inputLogLine.inputFunctionId);
+      outputLogData.commonLogText.sourceFileLine = worldState.internString(inputLogLine.inputSourceFileLine);
 
       switch (inputLogLine.inputLineType) {
         case CapLogType::BLOCK_SCOPE_OPEN:
@@ -1026,18 +1270,15 @@ bool processLogLine(
 }
 
 bool processChannelLine(
+    const CapLogLineHead& lineHead,
     WorldStateWorkingData& workingData,
     WorldState& worldState) {
-  CapLogMatcher matcher;
-  if (!matcher.processId.match(workingData.inputLine)) {
+  if (!lineHead.threadId) {
     return false;
   }
 
-  if (!matcher.threadId.match(matcher.processId.captures[4])) {
-    return false;
-  }
-  
-  if (!matcher.channelLine.match(matcher.threadId.captures[4])) {
+  const auto channelCaptures = capLogMatcher.channelLine.match((*lineHead.threadId)[4], &workingData.delimiterIndex);
+  if (!channelCaptures) {
     return false;
   }
 
@@ -1046,12 +1287,12 @@ bool processChannelLine(
   ChannelLine& channelLine = *workingData.channelLine.get();
 
   channelLine.fullString = workingData.inputLine;
-  channelLine.uniqueProcessId = workingData.getUniqueProcessIdForInputProcessId(std::string(matcher.processId.captures[2]), worldState);
-  channelLine.uniqueThreadId = workingData.getUniqueThreadIdForInputThreadId(channelLine.uniqueProcessId, std::string(matcher.threadId.captures[2]), worldState);
-  channelLine.channelId = matcher.channelLine.captures[2];
-  channelLine.enabledMode = matcher.channelLine.captures[4];
-  channelLine.verbosityLevel = matcher.channelLine.captures[6];
-  channelLine.channelName = matcher.channelLine.captures[8];
+  channelLine.uniqueProcessId = workingData.getUniqueProcessIdForInputProcessId(lineHead.processId[2], worldState);
+  channelLine.uniqueThreadId = workingData.getUniqueThreadIdForInputThreadId(channelLine.uniqueProcessId, (*lineHead.threadId)[2], worldState);
+  channelLine.channelId = (*channelCaptures)[2];
+  channelLine.enabledMode = (*channelCaptures)[4];
+  channelLine.verbosityLevel = (*channelCaptures)[6];
+  channelLine.channelName = (*channelCaptures)[8];
 
   worldState.pushChannelLine(std::move(channelLine));
 
@@ -1059,19 +1300,16 @@ bool processChannelLine(
 }
 
 bool processLogLineCharLimit(
+    const CapLogLineHead& lineHead,
     WorldStateWorkingData& workingData,
     WorldState& worldState) {
-  CapLogMatcher matcher;
-  if (!matcher.processId.match(workingData.inputLine)) {
+  const auto maxCharsCaptures = capLogMatcher.maxCharsLine.match(lineHead.processId[4], &workingData.delimiterIndex);
+  if (!maxCharsCaptures) {
     return false;
   }
 
-  if (!matcher.maxCharsLine.match(matcher.processId.captures[4])) {
-    return false;
-  }
-
-  size_t uniqueProcessId = workingData.getUniqueProcessIdForInputProcessId(std::string(matcher.processId.captures[4]), worldState);
-  workingData.uniqueProcessIdToMaxCharLine[uniqueProcessId] = std::stoi(std::string(matcher.maxCharsLine.captures[2]));
+  size_t uniqueProcessId = workingData.getUniqueProcessIdForInputProcessId(lineHead.processId[4], worldState);
+  workingData.uniqueProcessIdToMaxCharLine[uniqueProcessId] = std::stoi(std::string((*maxCharsCaptures)[2]));
   return true;
 }
 
@@ -1112,21 +1350,21 @@ struct FileReadProgress {
 
 void ProcessCaplogLine(const std::string& inputString, WorldStateWorkingData& workingData, WorldState& worldState) {
   // printf("Processing line %zu: %s\n", workingData.intputFileLineNumber, inputString.c_str());
-  CapLogMatcher matcher;
-  if(!matcher.caplog.match(inputString)) {
+  const auto caplogCaptures = capLogMatcher.caplog.match(inputString);
+  if (!caplogCaptures) {
     return;
   }
-  workingData.inputLine = matcher.caplog.captures[2];
-  if (matcher.processId.match(workingData.inputLine)) {
-    matcher.threadId.match(matcher.processId.captures[4]);
-  }
-
-  if (processLogLine(workingData, worldState)) {
-    //
-  } else if (processChannelLine(workingData, worldState)) {
-    //
-  } else if (processLogLineCharLimit(workingData, worldState)) {
-    //
+  workingData.inputLine = (*caplogCaptures)[2];
+  workingData.delimiterIndex.build(workingData.inputLine);
+
+  if (const auto lineHead = matchLineHead(workingData.inputLine, &workingData.delimiterIndex)) {
+    if (processLogLine(*lineHead, workingData, worldState)) {
+      //
+    } else if (processChannelLine(*lineHead, workingData, worldState)) {
+      //
+    } else if (processLogLineCharLimit(*lineHead, workingData, worldState)) {
+      //
+    }
   }
   workingData.inPlace = std::nullopt;
   workingData.inputLine = "";
@@ -0,0 +1,198 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// A run of lines for the socket server's processing, numbered in the order it was received.
+struct LineBatch {
+  uint64_t sequence;
+  std::vector<std::string> lines;
+};
+
+/**
+ * Line batches kept on disk rather than in memory, for when the processing they're queued for is
+ * full and nothing received is to be dropped or held up.  Batches are read back in the order they
+ * were written, a bounded amount at a time, and the file is emptied whenever everything in it has
+ * been read back.
+ *
+ * The file's unlinked as soon as it's opened, so it goes away with the process however that ends.
+ * Safe to use from any thread.
+ **/
+class LineBatchSpill {
+public:
+  explicit LineBatchSpill(const std::string& path) {
+    mFd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (mFd < 0) {
+      perror(("Unable to open " + path).c_str());
+      return;
+    }
+    unlink(path.c_str());
+  }
+
+  ~LineBatchSpill() {
+    if (mFd >= 0) {
+      close(mFd);
+    }
+  }
+
+  LineBatchSpill(const LineBatchSpill&) = delete;
+  LineBatchSpill& operator=(const LineBatchSpill&) = delete;
+
+  bool isOpen() const {
+    return mFd >= 0;
+  }
+
+  enum class AppendResult {
+    // there weren't any batches on disk, so batch wasn't written.
+    Empty,
+    Appended,
+    // there are batches on disk, but batch couldn't be written after them.
+    Failed,
+  };
+
+  // Writes batch if there are batches on disk that haven't been read back yet; so once one batch
+  // has been spilled, the ones after it are spilled too, and stay in order, until they've all been
+  // read back.
+  AppendResult appendIfNotEmpty(const LineBatch& batch) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mReadOffset == mWriteOffset) {
+      return AppendResult::Empty;
+    }
+    return write(batch) ? AppendResult::Appended : AppendResult::Failed;
+  }
+
+  // returns false if it couldn't be written.
+  bool append(const LineBatch& batch) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return write(batch);
+  }
+
+  // Replaces the contents of batches with the oldest batches on disk, stopping once they add up to
+  // maxBytes of lines.  Returns false if there weren't any.
+  bool read(std::vector<LineBatch>& batches, size_t maxBytes) {
+    batches.clear();
+    std::lock_guard<std::mutex> lock(mMutex);
+    size_t readBytes = 0;
+    while (mReadOffset < mWriteOffset && readBytes < maxBytes) {
+      uint64_t recordHeader[2];
+      if (!readFully(recordHeader, sizeof(recordHeader))) {
+        break;
+      }
+      const uint64_t sequence = recordHeader[0];
+      const size_t recordSize = recordHeader[1];
+      mRecord.resize(recordSize);
+      if (!readFully(mRecord.data(), recordSize)) {
+        break;
+      }
+
+      LineBatch& batch = batches.emplace_back(LineBatch{sequence, {}});
+      std::string_view remaining(mRecord);
+      while (remaining.size() >= sizeof(uint32_t)) {
+        uint32_t lineSize;
+        std::memcpy(&lineSize, remaining.data(), sizeof(lineSize));
+        remaining.remove_prefix(sizeof(lineSize));
+        batch.lines.emplace_back(remaining.substr(0, lineSize));
+        remaining.remove_prefix(lineSize);
+      }
+      readBytes += recordSize;
+    }
+
+    // everything's been read back, so the file's started over.
+    if (mReadOffset >= mWriteOffset) {
+      if (ftruncate(mFd, 0) != 0) {
+        perror("Unable to empty spill file");
+      }
+      mReadOffset = 0;
+      mWriteOffset = 0;
+    }
+    return !batches.empty();
+  }
+
+  // how much is waiting on disk, and the most that's waited at once.
+  size_t getSize() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mWriteOffset - mReadOffset;
+  }
+
+  size_t getHighWaterMark() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mHighWaterMark;
+  }
+
+private:
+  // a record is the batch's sequence number and the size of the rest, then each line as a 32 bit
+  // size and its text.
+  bool write(const LineBatch& batch) {
+    if (mFd < 0) {
+      return false;
+    }
+
+    mRecord.assign(2 * sizeof(uint64_t), '\0');
+    for (const std::string& line : batch.lines) {
+      const uint32_t lineSize = line.size();
+      mRecord.append(reinterpret_cast<const char*>(&lineSize), sizeof(lineSize));
+      mRecord.append(line);
+    }
+    const uint64_t recordHeader[2] = {batch.sequence, mRecord.size() - sizeof(recordHeader)};
+    std::memcpy(mRecord.data(), recordHeader, sizeof(recordHeader));
+
+    std::string_view remaining(mRecord);
+    off_t offset = mWriteOffset;
+    while (!remaining.empty()) {
+      ssize_t written = pwrite(mFd, remaining.data(), remaining.size(), offset);
+      if (written < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        perror("Unable to write spill file");
+        return false;
+      }
+      remaining.remove_prefix(written);
+      offset += written;
+    }
+
+    mWriteOffset = offset;
+    mHighWaterMark = std::max<size_t>(mHighWaterMark, mWriteOffset - mReadOffset);
+    return true;
+  }
+
+  bool readFully(void* data, size_t size) {
+    char* dataChars = static_cast<char*>(data);
+    while (size > 0) {
+      ssize_t readChars = pread(mFd, dataChars, size, mReadOffset);
+      if (readChars <= 0) {
+        if (readChars < 0 && errno == EINTR) {
+          continue;
+        }
+        perror("Unable to read spill file");
+        // what's left can't be read back; it's dropped rather than read again forever.
+        mReadOffset = mWriteOffset;
+        return false;
+      }
+      dataChars += readChars;
+      size -= readChars;
+      mReadOffset += readChars;
+    }
+    return true;
+  }
+
+  int mFd = -1;
+
+  mutable std::mutex mMutex;
+  // where the next batch is read from and written to.
+  off_t mReadOffset = 0;
+  off_t mWriteOffset = 0;
+  size_t mHighWaterMark = 0;
+  // the record being written or read; kept to reuse its storage.
+  std::string mRecord;
+};
@@ -2,9 +2,12 @@
 
 #include "ingest.hpp"
 #include "behaviorTree.hpp"
+#include "groupCommit.hpp"
+
+#include <functional>
 
 struct Processor {
-  Processor(std::ofstream&& outputStream, BehaviorTree* tree = nullptr) : validationTree(tree) {
+  Processor(std::unique_ptr<std::ostream> outputStream, BehaviorTree* tree = nullptr) : validationTree(tree) {
     output.outputFileStream = std::move(outputStream);
   }
 
@@ -13,16 +16,18 @@ struct Processor {
   }
 
   void printOutputIfAvailable() {
-    auto& stackNodeArray = worldState.getNodeArray();
-
-    while (stackNodeArray.size() > mSizePrinted ) {
-      const auto& node = *stackNodeArray[mSizePrinted].get();
+    const std::vector<CapLogType>& logLineTypes = worldState.getLogLineTypes();
 
-      if ((node.logLineType == CapLogType::BLOCK_CONCAT_BEGIN) || (node.logLineType == CapLogType::BLOCK_CONCAT_CONTINUE) || (node.logLineType == CapLogType::BLOCK_CONCAT_END)) {
+    while (logLineTypes.size() > mSizePrinted ) {
+      const CapLogType logLineType = logLineTypes[mSizePrinted];
+      if ((logLineType == CapLogType::BLOCK_CONCAT_BEGIN) || (logLineType == CapLogType::BLOCK_CONCAT_CONTINUE) || (logLineType == CapLogType::BLOCK_CONCAT_END)) {
         break;
       }
 
-      output.outputFileStream
+      const StackNodeView node = worldState.getStackNode(mSizePrinted);
+
+      std::ostream& outputStream = *output.outputFileStream;
+      outputStream
       << "P=" << node.uniqueProcessId
       << " T=" << node.uniqueThreadId
       << " C=" << node.commonLogText.channelId
@@ -34,13 +39,13 @@ struct Processor {
         case CapLogType::BLOCK_SCOPE_OPEN:
           // intentional fall through
         case CapLogType::BLOCK_SCOPE_CLOSE:
-          output.outputFileStream << "::["
+          outputStream << "::["
             << node.blockText.filename << "]::["
             << node.blockText.functionName << "] "
             << node.blockText.objectId;
           break;
         case CapLogType::BLOCK_INNER_LINE:
-          output.outputFileStream << " "
+          outputStream << " "
             << node.messageText.innerTypeString
             << ": " << node.messageText.innerPayload;
           break;
@@ -51,13 +56,18 @@ struct Processor {
       }
       
       ++mSizePrinted;
-      output.outputFileStream << std::endl;
+      outputStream << std::endl;
 
       if (validationTree) {
         validationTree->state.lineIndex = worldWorkingData.intputFileLineNumber;
         auto result = validationTree->execute(node);
         if (result == NodeStatus::FAILED) {
           std::cerr << "Validation failed at line " << worldWorkingData.intputFileLineNumber << std::endl;
+          if (onValidationFailed) {
+            onValidationFailed();
+          }
+          // the outputs are written in the background; get what led up to the failure on disk.
+          GroupCommitWriter::get().flushAll();
           std::abort();
         }
       }
@@ -73,4 +83,8 @@ struct Processor {
   WorldStateWorkingData worldWorkingData;
 
   BehaviorTree* validationTree = nullptr;
+
+  // called before aborting on a failed validation, for outputs that are held back before being
+  // written (see the socket server's ProcessingShards).
+  std::function<void()> onValidationFailed;
 };
\ No newline at end of file
@@ -0,0 +1,100 @@
+#include "ingest.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+// Checks DelimiterIndex against plain searches, and the StringExtractors that use it against the
+// same extractors without it, on every line of the given clogs.
+//   delimiterIndexTest.out [clogfile.clog]...
+
+namespace {
+
+size_t gFailures = 0;
+
+void fail(std::string_view what, std::string_view line) {
+  if (++gFailures <= 10) {
+    std::cerr << "FAILED: " << what << " on line: " << line << std::endl;
+  }
+}
+
+template <int Slot>
+void checkDelimiter(const DelimiterIndex& index, std::string_view line, std::string_view implementationName) {
+  constexpr char delimiter = DelimiterIndex::delimiters[Slot];
+  for (size_t from = 0; from <= line.size(); ++from) {
+    if (index.findNext<Slot>(from, line.size()) != line.find(delimiter, from)) {
+      fail(std::string(implementationName) + " findNext for '" + delimiter + "'", line);
+      return;
+    }
+  }
+}
+
+template <typename Extractor>
+void checkExtractor(const Extractor& extractor, std::string_view input, const DelimiterIndex& index, std::string_view extractorName) {
+  if (extractor.match(input, &index) != extractor.match(input)) {
+    fail(extractorName, input);
+  }
+}
+
+// Every extractor is tried on every suffix of the line that starts at a delimiter, not just the
+// part of the line it'd normally see, so it also runs into lines it doesn't match.
+void checkExtractors(std::string_view line, const DelimiterIndex& index) {
+  for (size_t begin = 0; begin < line.size(); ++begin) {
+    if (begin != 0 && DelimiterIndex::delimiterSlot(line[begin - 1]) < 0) {
+      continue;
+    }
+    std::string_view input = line.substr(begin);
+    checkExtractor(capLogMatcher.processId, input, index, "processId");
+    checkExtractor(capLogMatcher.maxCharsLine, input, index, "maxCharsLine");
+    checkExtractor(capLogMatcher.threadId, input, index, "threadId");
+    checkExtractor(capLogMatcher.channelLine, input, index, "channelLine");
+    checkExtractor(capLogMatcher.logLine, input, index, "logLine");
+    checkExtractor(capLogMatcher.infoStringCommon, input, index, "infoStringCommon");
+    checkExtractor(capLogMatcher.infoStringBlock, input, index, "infoStringBlock");
+    checkExtractor(capLogMatcher.infoStringInner, input, index, "infoStringInner");
+  }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  const std::pair<DelimiterIndex::Implementation, std::string_view> implementations[] = {
+    {DelimiterIndex::Implementation::Scalar, "Scalar"},
+    {DelimiterIndex::Implementation::Sse2, "SSE2"},
+    {DelimiterIndex::Implementation::Avx2, "AVX2"},
+  };
+  for (auto&& [implementation, implementationName] : implementations) {
+    std::cout << implementationName << (DelimiterIndex::isSupported(implementation) ? " supported" : " not supported") << std::endl;
+  }
+
+  size_t lineCount = 0;
+  DelimiterIndex index;
+  for (int argIdx = 1; argIdx < argc; ++argIdx) {
+    std::ifstream inputStream(argv[argIdx]);
+    if (!inputStream.is_open()) {
+      std::cerr << "Unable to open " << argv[argIdx] << std::endl;
+      return 1;
+    }
+
+    std::string line;
+    while (std::getline(inputStream, line)) {
+      ++lineCount;
+      for (auto&& [implementation, implementationName] : implementations) {
+        if (!DelimiterIndex::isSupported(implementation)) {
+          continue;
+        }
+        index.build(line, implementation);
+        checkDelimiter<0>(index, line, implementationName);
+        checkDelimiter<1>(index, line, implementationName);
+        checkDelimiter<2>(index, line, implementationName);
+      }
+
+      index.build(line);
+      checkExtractors(line, index);
+    }
+  }
+
+  std::cout << lineCount << " lines checked, " << gFailures << " failures" << std::endl;
+  return gFailures == 0 ? 0 : 1;
+}
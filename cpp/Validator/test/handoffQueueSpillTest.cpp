@@ -0,0 +1,143 @@
+#include "handoffQueue.hpp"
+#include "lineBatchSpill.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Pushes batches from several threads through a small HandoffQueue that overflows into a
+// LineBatchSpill, the way the socket server's shards do with kSocketSpillToDisk, and checks that
+// every batch comes out once, each thread's batches in the order it pushed them, and that the
+// popping thread never sleeps through a spilled batch.  Now and then a spill write is made to fail,
+// as if the disk were full, to check that a batch isn't queued ahead of the ones already spilled.
+//   handoffQueueSpillTest.out [batches per thread]
+
+namespace {
+
+constexpr size_t kProducerCount = 4;
+// small enough that the queue's full (and batches get spilled) most of the time.
+constexpr size_t kQueueBytes = 256;
+constexpr size_t kSpillReadBytes = 256;
+// how long the popping thread can go without a batch before it's taken to be stuck.
+constexpr std::chrono::seconds kStuckTimeout{5};
+
+// one in this many writes to a spill that has batches in it fails.
+constexpr uint64_t kFailedAppendInterval = 97;
+
+// A LineBatchSpill whose appendIfNotEmpty fails every kFailedAppendInterval times it has batches.
+class FailingSpill {
+public:
+  using AppendResult = LineBatchSpill::AppendResult;
+
+  explicit FailingSpill(LineBatchSpill& spill) : mSpill(spill) {}
+
+  AppendResult appendIfNotEmpty(const LineBatch& batch) {
+    if (mSpill.getSize() != 0 && ++mAppendCount % kFailedAppendInterval == 0) {
+      ++failedCount;
+      return AppendResult::Failed;
+    }
+    return mSpill.appendIfNotEmpty(batch);
+  }
+
+  bool append(const LineBatch& batch) {
+    return mSpill.append(batch);
+  }
+
+  size_t getSize() const {
+    return mSpill.getSize();
+  }
+
+  std::atomic<uint64_t> failedCount = 0;
+
+private:
+  LineBatchSpill& mSpill;
+  std::atomic<uint64_t> mAppendCount = 0;
+};
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  const uint64_t batchesPerProducer = argc > 1 ? std::stoull(argv[1]) : 200000;
+  const uint64_t batchCount = batchesPerProducer * kProducerCount;
+
+  HandoffQueue<LineBatch> queue(kQueueBytes);
+  LineBatchSpill spill("handoffQueueSpillTest.spill");
+  if (!spill.isOpen()) {
+    return 1;
+  }
+  FailingSpill failingSpill(spill);
+
+  // each batch is one line: the thread that pushed it, and how many it had pushed before.
+  auto producer = [&](size_t producerIdx) {
+    for (uint64_t batchIdx = 0; batchIdx < batchesPerProducer; ++batchIdx) {
+      LineBatch batch{batchIdx, {std::to_string(producerIdx)}};
+      if (!queue.pushOrOverflow(batch, 32, failingSpill)) {
+        std::cerr << "FAILED: spill file couldn't be written" << std::endl;
+        std::_Exit(1);
+      }
+    }
+  };
+
+  std::atomic<uint64_t> poppedCount = 0;
+  std::atomic<size_t> failures = 0;
+  std::thread consumer([&]() {
+    std::vector<uint64_t> nextBatchIdx(kProducerCount, 0);
+    std::vector<LineBatch> batches;
+    uint64_t roundCount = 0;
+    while (poppedCount < batchCount) {
+      // the same as ProcessingShards::popShardBatches.
+      queue.popAllOrOverflow(batches, failingSpill);
+      if (batches.empty()) {
+        spill.read(batches, kSpillReadBytes);
+      }
+
+      for (const LineBatch& batch : batches) {
+        const size_t producerIdx = std::stoul(batch.lines.at(0));
+        if (batch.sequence != nextBatchIdx[producerIdx] && ++failures <= 10) {
+          std::cerr << "FAILED: thread " << producerIdx << "'s batch " << batch.sequence
+            << " came out when " << nextBatchIdx[producerIdx] << " was next" << std::endl;
+        }
+        nextBatchIdx[producerIdx] = batch.sequence + 1;
+      }
+      poppedCount += batches.size();
+
+      // falls behind now and then, so the spill file fills up and is read back over and over.
+      if (++roundCount % 64 == 0) {
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+      }
+    }
+  });
+
+  std::vector<std::thread> producers;
+  for (size_t producerIdx = 0; producerIdx < kProducerCount; ++producerIdx) {
+    producers.emplace_back(producer, producerIdx);
+  }
+  for (auto& producerThread : producers) {
+    producerThread.join();
+  }
+
+  uint64_t lastPoppedCount = poppedCount;
+  auto lastProgress = std::chrono::steady_clock::now();
+  while (poppedCount < batchCount) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    if (poppedCount != lastPoppedCount) {
+      lastPoppedCount = poppedCount;
+      lastProgress = std::chrono::steady_clock::now();
+    } else if (std::chrono::steady_clock::now() - lastProgress > kStuckTimeout) {
+      std::cerr << "FAILED: stuck after " << poppedCount << " of " << batchCount << " batches, with "
+        << spill.getSize() << " bytes spilled" << std::endl;
+      // the popping thread's asleep for good, so it can't be joined.
+      std::_Exit(1);
+    }
+  }
+  consumer.join();
+
+  const auto metrics = queue.getMetrics();
+  std::cout << batchCount << " batches checked, queue full " << metrics.fullCount << " times, spill high water mark: "
+    << spill.getHighWaterMark() << " bytes, " << failingSpill.failedCount << " failed spill writes, " << failures
+    << " failures" << std::endl;
+  return failures == 0 ? 0 : 1;
+}
@@ -1,16 +1,33 @@
 #include <netinet/in.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <cstring>
+#include <functional>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
 #include <vector>
 #include <thread>
 #include <string_view>
 #include <filesystem>
 
+#include "binaryDumpFiles.hpp"
+#include "groupCommit.hpp"
+#include "handoffQueue.hpp"
+#include "lineBatchSpill.hpp"
 #include "process.hpp"
 
+#include "CaptainsLog/include/compression.hpp"
+#include "CaptainsLog/include/recordframing.hpp"
+
 #include "behaviorTree.hpp"
 
 #include <fcntl.h>
@@ -30,8 +47,44 @@ constexpr const char* kRawSocketInputDir = "rawsocketinput";
 // all the binary files that get dumped are written in this directory.
 constexpr const char* kBinaryFileDumpDir = "binaryfiles";
 
+// In SOCKET mode, clients are spread over this many I/O threads.
+constexpr const size_t kSocketIoThreadCount = 2;
+
+// In SOCKET mode, the most events an I/O thread handles per wait.
+constexpr const int kSocketMaxEvents = 64;
+
+// In SOCKET mode, lines are processed by one shard per core, up to this many.
+constexpr const size_t kSocketMaxProcessingShards = 8;
+
+// In SOCKET mode, the most bytes of lines that can wait for each processing shard.  Once a shard's
+// queue is full, the I/O threads stop reading their sockets until there's room, which holds the
+// clients up through TCP flow control (or see kSocketSpillToDisk).
+constexpr const size_t kSocketShardQueueBytes = 64 * 1024 * 1024;
+
+// In SOCKET mode, whether lines that don't fit in a full shard queue are written to a spill file in
+// this directory instead, to be processed once the shard catches up.  Clients aren't held up by a
+// full queue, and disk is used rather than memory.
+constexpr const bool kSocketSpillToDisk = false;
+constexpr const char* kSocketSpillDir = "spill";
+
+// In SOCKET mode, the most runs of lines that can be handed to the shards ahead of the oldest one
+// whose output hasn't been written.  A shard that falls behind holds the I/O threads up once
+// there are this many, rather than the other shards' outputs piling up waiting for its own.
+constexpr const size_t kSocketMaxWaitingRuns = 4096;
+
+// In FILE mode, the outputs of every file but the first are written to part files (eg.
+// validatorReport.txt.part1) until they're appended to the real ones.
+constexpr const char* kPartFileSuffix = ".part";
+
+// In FILE mode, the processed output is written every this many input lines.
+constexpr const size_t kFileOutputWindowLines = 4096;
+
 namespace {
 
+// Makes the validation tree for one input, reporting to validationOStream.  A tree keeps state
+// about what it's seen, so inputs that are processed separately each need their own.
+using MakeTreeFunc = std::function<std::unique_ptr<BehaviorTree>(std::ostream* validationOStream)>;
+
 // Data driven; this can be replaced with json or deserialized in any other way.
 //   This example works with artemis and validates some audio functionality.
 BehaviorTree makeTreeExample() {
@@ -73,127 +126,558 @@ std::string getTimestampString() {
   return ss.str();
 }
 
+// A binary dump from a client: the file it's for and the bytes to add to it.  Both are views of the
+// StreamParser's buffer, so they're only valid until the parser's next getReceiveSpace.
+struct BinaryDump {
+  std::string_view filename;
+  std::string_view bytes;
+};
+
+/**
+ * Splits a client's stream into records: a 16 byte header (the 8 byte delimiter, the payload type
+ * and the payload length; see CAP::SocketLogger::Header) followed by the payload.  The length says
+ * where a record ends, so each record is emitted as soon as all of it has arrived.  The delimiter
+ * is only searched for to find the next header again when the stream is corrupt.
+ *
+ * The socket is read straight into the parser's buffer (see getReceiveSpace) and records are
+ * parsed where they land; only a record that hasn't all arrived yet gets moved, to the front.
+ **/
 struct StreamParser {
   constexpr static uint32_t headerDelimiter[2] = {0x12345678, 0x87654321};
-  // doubled size becaue we store additional 8 bytes in the header for payload type and length
   constexpr static size_t headerDelimiterSize = sizeof(uint32_t) * 2;
+  // the delimiter, then the payload type and length.
+  constexpr static size_t headerSize = headerDelimiterSize + 2 * sizeof(uint32_t);
+  // the least that's read from the socket at a time.
+  constexpr static size_t minReceiveSize = 64 * 1024;
+  // a header with a longer payload than this is taken to be corrupt.
+  constexpr static uint32_t maxPayloadSize = 256 * 1024 * 1024;
+
+  static std::string_view delimiter() {
+    return std::string_view(reinterpret_cast<const char*>(headerDelimiter), headerDelimiterSize);
+  }
 
-  enum class State {
-    HeaderDelim,
-    HeaderPayloadType,
-    HeaderPaylodNumBytes,
-    TextPayload,
-    BinaryFilenamePayload,
-    BinaryDataPayload,
-  };
+  // Where to receive the next bytes into; at least minReceiveSize bytes, or enough for the rest of
+  // the record being waited on.  Pass how much of it was filled to parseReceived.
+  std::pair<char*, size_t> getReceiveSpace() {
+    if (mParsedEnd > 0) {
+      std::memmove(mBuffer.data(), mBuffer.data() + mParsedEnd, mReceivedEnd - mParsedEnd);
+      mReceivedEnd -= mParsedEnd;
+      mParsedEnd = 0;
+    }
 
-  State currentState = State::HeaderDelim;
-
-  // lineLeftovers should always start with the full header (including the delimiter)
-  std::string accumulatedLine = "";
-
-  void parseLine(const char* buffer, size_t numBytes, std::vector<std::string>& stringsOut, std::vector<std::pair<std::string, std::vector<unsigned char>>>& bytesOut){
-    // printf("parsing \n");
-    std::string_view delim((const char*)headerDelimiter, (const char*)headerDelimiter + headerDelimiterSize);
-
-    // These are the starting points of each deliminter.  We use these starting points
-    // because we scan from the end of the "current" delimiter to the start of the next
-    // deliminter.
-    std::vector<size_t> delimiterIndices{};
-    std::string_view line(buffer, buffer + numBytes);
-    
-    size_t lenthBeforeAppend = accumulatedLine.size();
-    accumulatedLine += line;
-    
-    // delimiter may span across the end of the accumulated line and the new line, so we need to 
-    // start our search "header size" before the accumulation point, (or 0, if the accumulated line is too small)
-    // However, we also assume that the start of the accumulated line is a header.
-    
-    // We do our search slightly delayed because because we only take the text between delimiters.
-    // TODO: Consider adding an end delimiter (eg. reversed bytes of current delim so that we can 
-    // print the line as soon as we have the whole thing currently we need to do a hacky 
-    // check at the very end where we grab the remaining text.
-    
-    // we move the search cursor a maximum of headerDelimiterSize bytes back to catch deliminters which may have
-    // been partially transferred in the previous iteration.  Any complete delimiters would have been extracted however.
-    
-    // we also guarantee that the first set of bytes is the delimiter.  We know this because we currently buffer the string
-    // until we hit a delimiter, then print it.  Thus, we always accumulate starting with a delimiter.
-    size_t from = (lenthBeforeAppend < headerDelimiterSize) ? 0 : (lenthBeforeAppend - headerDelimiterSize);
-    from = std::max(from, headerDelimiterSize); // skip first delimiter, since we know accumulator starts with it.
-
-    // we want to find the first deliminter **unless** the first 
-    // delimiter is at the very start of the line.
-    from = accumulatedLine.find(delim, from);
-    while(from != std::string::npos) {
-      // printf("delim: %zu \n", from);
-      delimiterIndices.push_back(from);
-      from = accumulatedLine.find(delim, from + 1);
-    }
-
-    // examine each line between delimiters.  lineleftovers should always start with the delimiter.
-    size_t rangeStart = 0;
-    for(size_t index : delimiterIndices) {
-      size_t rangeEnd = index;
-      
-      size_t bodyTypeStart = rangeStart + headerDelimiterSize;
-      size_t bodyLengthStart = bodyTypeStart + sizeof(uint32_t);
-      size_t bodyStart = bodyLengthStart + sizeof(uint32_t);
-      // printf("rangeStart: %zu | bodyTypeStart: %zu | bodyLengthStart: %zu | bodyStart: %zu | rangeEnd: %zu\n", rangeStart, bodyTypeStart, bodyLengthStart, bodyStart, rangeEnd);
-      rangeStart = rangeEnd;
-
-      if (bodyStart > rangeEnd) {
-        assert(bodyStart < rangeEnd);
+    const size_t neededSize = std::max(mReceivedEnd + minReceiveSize, mIncompleteRecordSize);
+    if (mBuffer.size() < neededSize) {
+      mBuffer.resize(neededSize);
+    }
+    return {mBuffer.data() + mReceivedEnd, mBuffer.size() - mReceivedEnd};
+  }
+
+  void parseReceived(size_t numBytes, std::vector<std::string>& stringsOut, std::vector<BinaryDump>& bytesOut) {
+    mReceivedEnd += numBytes;
+    mIncompleteRecordSize = 0;
+
+    while (true) {
+      std::string_view unparsed(mBuffer.data() + mParsedEnd, mReceivedEnd - mParsedEnd);
+      if (!isStartOfHeader(unparsed)) {
+        if (!skipToNextHeader(unparsed)) {
+          break;
+        }
+        continue;
+      }
+
+      if (unparsed.size() < headerSize) {
+        break;
       }
 
       uint32_t payloadType = 0;
-      memcpy(&payloadType, accumulatedLine.data() + bodyTypeStart, sizeof(uint32_t));
+      memcpy(&payloadType, unparsed.data() + headerDelimiterSize, sizeof(uint32_t));
 
       uint32_t payloadLength = 0;
-      memcpy(&payloadLength, accumulatedLine.data() + bodyLengthStart, sizeof(uint32_t));
-      
-      if (bodyStart == rangeEnd) {
-        printf("empty body, likely an error.  bodyType = %zu | bodyPayloadLength = %zu \n", (size_t)payloadType, (size_t)payloadLength);
-        assert(payloadLength == 0);
-      }
+      memcpy(&payloadLength, unparsed.data() + headerDelimiterSize + sizeof(uint32_t), sizeof(uint32_t));
 
-      if (rangeEnd < bodyStart) {
-        printf("MALFORMED \n");
+      if (payloadLength > maxPayloadSize) {
+        printf("MALFORMED HEADER.  bodyType = %zu | bodyPayloadLength = %zu \n", (size_t)payloadType, (size_t)payloadLength);
+        // skips this delimiter; the next one starts the next good record.
+        if (!skipToNextHeader(unparsed)) {
+          break;
+        }
         continue;
       }
-      size_t length = rangeEnd - bodyStart;
-
-      // printf("printing lines \n");
-      // for(int i = bodyStart; i < rangeEnd; i++) {
-      //   printf("%c", accumulatedLine[i]);
-      // }
-
-      // assume string for now
-      if (payloadType == 0) {
-        stringsOut.push_back(accumulatedLine.substr(bodyStart, length));
-      } else if (payloadType == 1) {
-        std::string_view substr = std::string_view(accumulatedLine).substr(bodyStart, length);
-        if(size_t delim = substr.find("||"); delim != std::string::npos) {
-          std::string_view filename = substr.substr(0, delim);
-          std::string_view bytesStr = substr.substr(delim + 2);
-          std::pair<std::string, std::vector<unsigned char>> filenameAndBytes;
-          filenameAndBytes.first = filename;
-          filenameAndBytes.second.resize(bytesStr.size());
-          memcpy(filenameAndBytes.second.data(), bytesStr.data(), bytesStr.size());
-          bytesOut.push_back(std::move(filenameAndBytes));
-        }
+
+      if (unparsed.size() - headerSize < payloadLength) {
+        mIncompleteRecordSize = headerSize + payloadLength;
+        break;
+      }
+
+      emitPayload(payloadType, unparsed.substr(headerSize, payloadLength), stringsOut, bytesOut);
+      mParsedEnd += headerSize + payloadLength;
+    }
+  }
+
+  // Call once the connection's closed.  Every complete record has been emitted by then, so anything
+  // left is a record that was cut off.
+  void finish() {
+    if (mReceivedEnd > mParsedEnd) {
+      printf("CONNECTION CLOSED MID RECORD.  Dropped %zu bytes \n", mReceivedEnd - mParsedEnd);
+    }
+    mParsedEnd = mReceivedEnd = 0;
+  }
+
+  void emitPayload(uint32_t payloadType, std::string_view body, std::vector<std::string>& stringsOut, std::vector<BinaryDump>& bytesOut) {
+    // payload types match CAP::SocketLogger::PayloadType
+    if (payloadType == 0) {
+      stringsOut.push_back(std::string(body));
+    } else if (payloadType == 1) {
+      if(size_t delim = body.find("||"); delim != std::string::npos) {
+        bytesOut.push_back(BinaryDump{body.substr(0, delim), body.substr(delim + 2)});
+      }
+    } else if (payloadType == 2) {
+      emitCompressedTextBatch(body, stringsOut);
+    }
+  }
+
+  // body is [uint32_t decompressed size][compressed block], and the decompressed block is a
+  // sequence of [uint32_t length][text] records.
+  void emitCompressedTextBatch(std::string_view body, std::vector<std::string>& stringsOut) {
+    if (body.size() < sizeof(uint32_t)) {
+      printf("MALFORMED COMPRESSED BATCH \n");
+      return;
+    }
+
+    uint32_t decompressedSize = 0;
+    memcpy(&decompressedSize, body.data(), sizeof(uint32_t));
+    // the size comes from the client; a corrupt one mustn't allocate gigabytes.  decompress also
+    // checks it against what the block could possibly hold.
+    if (decompressedSize > maxPayloadSize) {
+      printf("MALFORMED COMPRESSED BATCH.  Decompressed size: %u \n", decompressedSize);
+      return;
+    }
+
+    decompressedBatch.clear();
+    if (!CAP::Compression::decompress(body.substr(sizeof(uint32_t)), decompressedSize, decompressedBatch)) {
+      printf("FAILED TO DECOMPRESS BATCH \n");
+      return;
+    }
+
+    std::string_view records(decompressedBatch);
+    while (records.size() >= sizeof(uint32_t)) {
+      uint32_t recordLength = 0;
+      memcpy(&recordLength, records.data(), sizeof(uint32_t));
+      records.remove_prefix(sizeof(uint32_t));
+      if (recordLength > records.size()) {
+        printf("MALFORMED COMPRESSED BATCH RECORD \n");
+        return;
+      }
+      stringsOut.push_back(std::string(records.substr(0, recordLength)));
+      records.remove_prefix(recordLength);
+    }
+  }
+
+  // reused between batches to avoid reallocating
+  std::string decompressedBatch;
+
+private:
+  // whether unparsed starts with (as much as it has of) the delimiter.
+  static bool isStartOfHeader(std::string_view unparsed) {
+    const size_t comparedSize = std::min(unparsed.size(), headerDelimiterSize);
+    return unparsed.substr(0, comparedSize) == delimiter().substr(0, comparedSize);
+  }
+
+  // Drops the bytes before the next delimiter after the start of unparsed.  If there isn't one yet,
+  // drops all but the last few bytes (they could be the start of one) and returns false.
+  bool skipToNextHeader(std::string_view unparsed) {
+    size_t skipped = unparsed.find(delimiter(), 1);
+    const bool isFound = skipped != std::string_view::npos;
+    if (!isFound) {
+      skipped = unparsed.size() - std::min(unparsed.size(), headerDelimiterSize - 1);
+    }
+    mParsedEnd += skipped;
+    mSkippedBytes += skipped;
+
+    if (isFound) {
+      printf("MALFORMED STREAM.  Skipped %zu bytes to the next header \n", mSkippedBytes);
+      mSkippedBytes = 0;
+    }
+    return isFound;
+  }
+
+  // received bytes are [0, mReceivedEnd) of mBuffer, and the ones from mParsedEnd on haven't been
+  // parsed yet.
+  std::vector<char> mBuffer;
+  size_t mParsedEnd = 0;
+  size_t mReceivedEnd = 0;
+  // the size of the record at mParsedEnd, if its header's arrived but not all of it.
+  size_t mIncompleteRecordSize = 0;
+  // bytes skipped looking for the next header, since the last one.
+  size_t mSkippedBytes = 0;
+};
+
+// A connected client.  It belongs to the I/O thread it was given to when it was accepted, and only
+// that thread touches it.
+struct ClientConnection {
+  ClientConnection(int socketId, int uniqueClientId, const std::string& rawOutputFilename)
+    : socketId(socketId), uniqueClientId(uniqueClientId), rawOutput(rawOutputFilename) {}
+
+  int socketId;
+  int uniqueClientId;
+  GroupCommitFile rawOutput;
+  StreamParser parser;
+};
+
+// Reads what's available on a connection.  The sockets are edge triggered, so that's everything
+// until EAGAIN, or the connection closes.  Returns false if it closed.
+//
+// Binary dumps are written as they're parsed, from the receive buffer they arrived in, and the
+// lines are handed off after each receive, so they don't pile up here.  Handing them off can wait
+// (see kSocketShardQueueBytes), and the socket isn't read in the meantime.
+bool readClientConnection(
+    ClientConnection& connection,
+    std::vector<std::string>& stringsOut,
+    std::vector<BinaryDump>& bytesOut,
+    BinaryDumpFiles& binaryDumpFiles,
+    const std::function<void(std::vector<std::string>& lines)>& handOffLines) {
+  while (true) {
+    auto [receiveBuffer, receiveSize] = connection.parser.getReceiveSpace();
+    ssize_t readChars = recv(connection.socketId, receiveBuffer, receiveSize, 0);
+    if (readChars > 0) {
+      connection.rawOutput.append(std::string_view(receiveBuffer, readChars));
+      connection.parser.parseReceived(readChars, stringsOut, bytesOut);
+
+      for (const BinaryDump& binaryDump : bytesOut) {
+        binaryDumpFiles.write(binaryDump.filename, binaryDump.bytes);
+      }
+      bytesOut.clear();
+      handOffLines(stringsOut);
+    } else if (readChars < 0 && errno == EINTR) {
+      continue;
+    } else if (readChars < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      return true;
+    } else {
+      // 0 is eof; closed connection
+      if (readChars < 0) {
+        perror("read");
+      }
+
+      connection.parser.finish();
+      return false;
+    }
+  }
+}
+
+/**
+ * Puts the processing shards' outputs back in the order their lines were received.  Each run of
+ * lines is numbered here when it's handed to a shard, and the processed output and report text it
+ * made are written once every run numbered before it has been; until then they wait here.
+ *
+ * At most maxWaiting runs are numbered past the oldest one that hasn't been written, so that's the
+ * most outputs that can wait.
+ **/
+class OrderedOutputMerger {
+public:
+  OrderedOutputMerger(std::ostream& processedOutput, std::ostream& validationReport, size_t maxWaiting)
+    : mProcessedOutput(processedOutput), mValidationReport(validationReport), mMaxWaiting(maxWaiting) {}
+
+  // Numbers the next run of lines.  Waits while maxWaiting runs are ahead of the oldest one that
+  // hasn't been written; it's being processed, so that's never for long.
+  uint64_t nextSequence() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mWindowOpen.wait(lock, [this]() { return mNumberedSequence - mNextSequence < mMaxWaiting; });
+    return mNumberedSequence++;
+  }
+
+  // every sequence number has to be submitted, even if it made no output, or the ones after it
+  // are never written.
+  void submit(uint64_t sequence, std::string processedText, std::string reportText) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mWaiting.emplace(sequence, Output{std::move(processedText), std::move(reportText)});
+    const uint64_t firstSequence = mNextSequence;
+    while (!mWaiting.empty() && mWaiting.begin()->first == mNextSequence) {
+      write(mWaiting.begin()->second);
+      mWaiting.erase(mWaiting.begin());
+      ++mNextSequence;
+    }
+    if (mNextSequence != firstSequence) {
+      mWindowOpen.notify_all();
+    }
+  }
+
+  // Writes everything that's waiting and then this output, out of order; for a shard that's about
+  // to abort, so what led up to it still gets written.
+  void writeNow(std::string processedText, std::string reportText) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (auto& [sequence, output] : mWaiting) {
+      write(output);
+    }
+    mWaiting.clear();
+    write(Output{std::move(processedText), std::move(reportText)});
+  }
+
+private:
+  struct Output {
+    std::string processedText;
+    std::string reportText;
+  };
+
+  void write(const Output& output) {
+    if (!output.processedText.empty()) {
+      mProcessedOutput << output.processedText << std::flush;
+    }
+    if (!output.reportText.empty()) {
+      mValidationReport << output.reportText << std::flush;
+    }
+  }
+
+  std::ostream& mProcessedOutput;
+  std::ostream& mValidationReport;
+  const size_t mMaxWaiting;
+
+  std::mutex mMutex;
+  std::condition_variable mWindowOpen;
+  // the next run to be numbered, and the next one to be written.
+  uint64_t mNumberedSequence = 0;
+  uint64_t mNextSequence = 0;
+  std::map<uint64_t, Output> mWaiting;
+};
+
+/**
+ * The socket server's processing, split by the process that logged each line (its P= id), so
+ * processes are processed on as many threads as there are shards.  Each shard has its own
+ * Processor and tree on its own thread, and a process's lines always go to the same shard, in the
+ * order they were received.  The shards number their process ids from one shared counter, so the
+ * ids in the outputs are unique across shards.
+ *
+ * A tree only sees its shard's processes, and its report counts lines per shard.
+ *
+ * Each shard's queue holds at most queueBytes of lines.  Once it's full, push waits for room, unless
+ * the shards were given a spillDirectory: then what doesn't fit is written to the shard's spill file
+ * and read back when the shard catches up.  Either way, push also waits once maxWaitingRuns runs
+ * have been pushed ahead of the oldest one whose output hasn't been written (see
+ * OrderedOutputMerger).
+ *
+ * The shards run until finish, which processes everything already pushed (queued or spilled) and
+ * writes all of its output.
+ **/
+class ProcessingShards {
+public:
+  ProcessingShards(
+      size_t shardCount,
+      size_t queueBytes,
+      size_t maxWaitingRuns,
+      const std::string& spillDirectory,
+      const MakeTreeFunc& makeTree,
+      std::ostream& processedOutput,
+      std::ostream& validationReport)
+    : mQueueBytes(queueBytes), mMerger(processedOutput, validationReport, maxWaitingRuns) {
+    for (size_t shardIdx = 0; shardIdx < shardCount; ++shardIdx) {
+      auto shard = std::make_unique<Shard>(queueBytes);
+      if (!spillDirectory.empty()) {
+        shard->spill = std::make_unique<LineBatchSpill>(spillDirectory + "/shard" + std::to_string(shardIdx) + ".spill");
+      }
+      shard->tree = makeTree(&shard->reportText);
+      auto processedText = std::make_unique<std::ostringstream>();
+      shard->processedText = processedText.get();
+      shard->processor = std::make_unique<Processor>(std::move(processedText), shard->tree.get());
+      shard->processor->worldState.shareUniqueProcessIds(&mNextUniqueProcessId);
+      shard->processor->onValidationFailed = [this, shard = shard.get()]() {
+        mMerger.writeNow(shard->processedText->str(), shard->reportText.str());
+      };
+      mShards.push_back(std::move(shard));
+    }
+    for (auto& shard : mShards) {
+      shard->thread = std::thread([this, shard = shard.get()]() { runShard(*shard); });
+    }
+  }
+
+  ProcessingShards(const ProcessingShards&) = delete;
+  ProcessingShards& operator=(const ProcessingShards&) = delete;
+
+  // hands lines to their shards, and leaves lines empty.  Lines in a row for the same shard are
+  // handed over together.
+  void push(std::vector<std::string>& lines) {
+    auto runBegin = lines.begin();
+    while (runBegin != lines.end()) {
+      const size_t shardIdx = getShardIdx(*runBegin);
+      auto runEnd = std::find_if(runBegin + 1, lines.end(), [&](const std::string& line) {
+        return getShardIdx(line) != shardIdx;
+      });
+
+      LineBatch batch{mMerger.nextSequence(), {}};
+      batch.lines.assign(std::make_move_iterator(runBegin), std::make_move_iterator(runEnd));
+      pushToShard(*mShards[shardIdx], std::move(batch));
+      runBegin = runEnd;
+    }
+    lines.clear();
+  }
+
+  // Processes everything pushed so far and writes its output, then stops the shards.  Nothing can
+  // be pushed once this has been called.
+  void finish() {
+    for (auto& shard : mShards) {
+      pushToShard(*shard, LineBatch{kStopSequence, {}});
+    }
+    for (auto& shard : mShards) {
+      shard->thread.join();
+    }
+    // every run that was numbered was pushed, so nothing should be left waiting; but whatever is,
+    // it's written rather than dropped.
+    mMerger.writeNow(std::string(), std::string());
+  }
+
+  void printMetrics(std::ostream& outputStream) const {
+    for (size_t shardIdx = 0; shardIdx < mShards.size(); ++shardIdx) {
+      const Shard& shard = *mShards[shardIdx];
+      const auto metrics = shard.batches.getMetrics();
+      outputStream << "Processing shard: [" << shardIdx << "]"
+        << " | queue bytes: [" << metrics.depth << "]"
+        << " | high water mark: [" << metrics.highWaterMark << "]"
+        << " | times full: [" << metrics.fullCount << "]"
+        << " | waited for room: [" << std::chrono::duration_cast<std::chrono::milliseconds>(metrics.fullWaitTime).count() << " ms]";
+      if (shard.spill) {
+        outputStream << " | spilled bytes: [" << shard.spill->getSize() << "]"
+          << " | spill high water mark: [" << shard.spill->getHighWaterMark() << "]";
+      }
+      outputStream << std::endl;
+    }
+  }
+
+private:
+  // the sequence of the batch finish hands each shard, after everything else it's been pushed.
+  static constexpr uint64_t kStopSequence = UINT64_MAX;
+
+  struct Shard {
+    explicit Shard(size_t queueBytes) : batches(queueBytes) {}
+
+    HandoffQueue<LineBatch> batches;
+    std::unique_ptr<LineBatchSpill> spill;
+    std::ostringstream reportText;
+    std::unique_ptr<BehaviorTree> tree;
+    // the processor's output stream.
+    std::ostringstream* processedText = nullptr;
+    std::unique_ptr<Processor> processor;
+    std::thread thread;
+  };
+
+  // lines without a process (eg. the log's version line) go to the first shard.
+  size_t getShardIdx(std::string_view line) const {
+    if (mShards.size() == 1) {
+      return 0;
+    }
+    size_t processIdBegin = line.find("P=");
+    if (processIdBegin == std::string_view::npos) {
+      return 0;
+    }
+    processIdBegin += 2;
+    std::string_view processId = line.substr(processIdBegin, line.find(' ', processIdBegin) - processIdBegin);
+    return std::hash<std::string_view>{}(processId) % mShards.size();
+  }
+
+  static size_t getBatchBytes(const LineBatch& batch) {
+    size_t batchBytes = 0;
+    for (const std::string& line : batch.lines) {
+      batchBytes += line.size();
+    }
+    return batchBytes;
+  }
+
+  void pushToShard(Shard& shard, LineBatch&& batch) {
+    const size_t batchBytes = getBatchBytes(batch);
+    if (shard.spill) {
+      // once a batch is spilled, the ones after it go to the spill file too, so they stay in order.
+      if (shard.batches.pushOrOverflow(batch, batchBytes, *shard.spill)) {
+        return;
       }
+      // the spill file was empty and couldn't be written, so it's back to waiting for room.
+    }
+    shard.batches.push(std::move(batch), batchBytes);
+  }
+
+  // Waits for the shard's next batches.  Anything in the queue was pushed before anything in the
+  // spill file, so the queue's emptied first.
+  void popShardBatches(Shard& shard, std::vector<LineBatch>& batches) {
+    if (!shard.spill) {
+      shard.batches.popAll(batches);
+      return;
     }
+    shard.batches.popAllOrOverflow(batches, *shard.spill);
+    if (batches.empty()) {
+      shard.spill->read(batches, mQueueBytes);
+    }
+  }
 
-    if (rangeStart != 0) {
-      accumulatedLine = accumulatedLine.substr(rangeStart);
+  void runShard(Shard& shard) {
+    std::vector<LineBatch> batches;
+    while (true) {
+      popShardBatches(shard, batches);
+      for (LineBatch& batch : batches) {
+        if (batch.sequence == kStopSequence) {
+          return;
+        }
+        for (const std::string& line : batch.lines) {
+          shard.processor->readLine(line);
+          shard.processor->printOutputIfAvailable();
+        }
+
+        mMerger.submit(batch.sequence, shard.processedText->str(), shard.reportText.str());
+        shard.processedText->str(std::string());
+        shard.reportText.str(std::string());
+      }
     }
   }
+
+  const size_t mQueueBytes;
+  std::atomic<size_t> mNextUniqueProcessId = 0;
+  OrderedOutputMerger mMerger;
+  std::vector<std::unique_ptr<Shard>> mShards;
 };
 
-void runAsSocketServer(Processor&& processor) {
-  std::ofstream parsedOutput;
-  parsedOutput.open(kParsedRawOutputFile);
+// One of the socket server's I/O threads: waits on its epoll set and reads whichever of its
+// connections have data.  It returns once the server's stop eventfd (the one entry in the set
+// without a connection) is signalled.
+void runSocketIoThread(int epollFd, GroupCommitFile& parsedOutput, ProcessingShards& processingShards, BinaryDumpFiles& binaryDumpFiles) {
+  epoll_event events[kSocketMaxEvents];
+  std::vector<std::string> stringsOut{};
+  std::vector<BinaryDump> bytesOut{};
+  auto handOffLines = [&](std::vector<std::string>& lines) {
+    for (const std::string& line : lines) {
+      parsedOutput.append(line);
+    }
+    processingShards.push(lines);
+  };
+
+  while (true) {
+    int eventCount = epoll_wait(epollFd, events, kSocketMaxEvents, -1);
+    if (eventCount < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      perror("epoll_wait");
+      return;
+    }
+
+    for (int eventIdx = 0; eventIdx < eventCount; ++eventIdx) {
+      ClientConnection* connection = static_cast<ClientConnection*>(events[eventIdx].data.ptr);
+      if (!connection) {
+        return;
+      }
+      bool isOpen = readClientConnection(*connection, stringsOut, bytesOut, binaryDumpFiles, handOffLines);
+
+      if (!isOpen) {
+        std::cout << std::endl << "EOF.  Closing connection for Unique Client ID: [" << connection->uniqueClientId << "] | socket ID: ["
+        << connection->socketId << "]. " << std::endl;
+
+        // closing it also takes it out of the epoll set.
+        close(connection->socketId);
+        delete connection;
+      }
+    }
+  }
+}
+
+void runAsSocketServer(const MakeTreeFunc& makeTree, std::ostream& validationReport) {
+  // written straight to the file rather than through a stream, so nothing's held back in a stream
+  // buffer when the server's stopped.
+  GroupCommitFile parsedOutput(kParsedRawOutputFile);
+  GroupCommitOStream processedOutput(kProcessedOutputFile);
 
   std::filesystem::create_directory(kRawSocketInputDir);
   std::filesystem::create_directory(kBinaryFileDumpDir);
@@ -226,86 +710,89 @@ void runAsSocketServer(Processor&& processor) {
 
   std::cout << "Listening to client " << std::endl;
 
-  // Listen
-  if (listen(server_fd, 3) < 0) {
+  // Listen; many instrumented processes can start (and connect) at once.
+  if (listen(server_fd, SOMAXCONN) < 0) {
     perror("listen");
     exit(EXIT_FAILURE);
   }
 
-  std::vector<std::unique_ptr<std::thread>> threads;
-
-  std::mutex clientLinesMut;
-  std::mutex clientBytesMut;
-
-  
-
-  std::vector<std::string> clientLines{};
-  std::vector<std::pair<std::string, std::vector<unsigned char>>> clientBytes{};
-
-  // Thread that processes text and also executes the behavior tree
-  threads.push_back(std::make_unique<std::thread>([&]() {
-    std::vector<std::string> swapBuffer{};
-    while (true) {
-      {
-        std::lock_guard<std::mutex> lock(clientLinesMut);
-        if (clientLines.size() > 0) {
-          swapBuffer = std::move(clientLines);
-          clientLines = {};
-        }
-      }
-
-      if (swapBuffer.size() > 0) {
-        // std::cout << "swapBuffer lines to process: " << swapBuffer.size() << std::endl;
-        for (auto& line : swapBuffer) {
-          parsedOutput.write(line.c_str(), line.size());
-          parsedOutput.flush();
-          processor.readLine(line);
-          processor.printOutputIfAvailable();
-        }
-        // std::cout << "swapBuffer Finished processing lines" << std::endl;
-        swapBuffer = {};
-      }
-
-      std::this_thread::sleep_for(std::chrono::milliseconds(1));
-    } 
-  }));
-
-  // Thread that processes binary data and writes it to the requested file.
-  threads.push_back(std::make_unique<std::thread>([&]() {
-    std::vector<std::pair<std::string, std::vector<unsigned char>>> swapBuffer{};
-    while (true) {
-      {
-        std::lock_guard<std::mutex> lock(clientBytesMut);
-        if (clientBytes.size() > 0) {
-          swapBuffer = std::move(clientBytes);
-          clientBytes = {};
-        }
-      }
+  BinaryDumpFiles binaryDumpFiles(kBinaryFileDumpDir);
+
+  // Stopping the server (SIGINT/SIGTERM) is handled by a thread of its own, so the outputs that are
+  // still waiting to be written get written first.  The signals are blocked here before any other
+  // thread starts, so the others inherit that and only this thread gets them.
+  sigset_t shutdownSignals;
+  sigemptyset(&shutdownSignals);
+  sigaddset(&shutdownSignals, SIGINT);
+  sigaddset(&shutdownSignals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &shutdownSignals, nullptr);
+
+  // Threads that process text and also execute the behavior tree
+  std::string spillDirectory;
+  if (kSocketSpillToDisk) {
+    spillDirectory = kSocketSpillDir;
+    std::filesystem::create_directory(spillDirectory);
+  }
+  const size_t shardCount = std::clamp<size_t>(std::thread::hardware_concurrency(), 1, kSocketMaxProcessingShards);
+  ProcessingShards processingShards(shardCount, kSocketShardQueueBytes, kSocketMaxWaitingRuns, spillDirectory, makeTree, processedOutput, validationReport);
+
+  // A fixed number of I/O threads, each with its own epoll set, however many clients connect.  Each
+  // set also has ioStopFd in it, which stops them all once it's signalled.
+  int ioStopFd = eventfd(0, EFD_CLOEXEC);
+  if (ioStopFd < 0) {
+    perror("eventfd");
+    exit(EXIT_FAILURE);
+  }
+  std::vector<int> ioEpollFds;
+  std::vector<std::unique_ptr<std::thread>> ioThreads;
+  for (size_t ioThreadIdx = 0; ioThreadIdx < kSocketIoThreadCount; ++ioThreadIdx) {
+    int epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd < 0) {
+      perror("epoll_create1");
+      exit(EXIT_FAILURE);
+    }
+    epoll_event stopEvent{};
+    stopEvent.events = EPOLLIN;
+    stopEvent.data.ptr = nullptr;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, ioStopFd, &stopEvent) < 0) {
+      perror("epoll_ctl");
+      exit(EXIT_FAILURE);
+    }
+    ioEpollFds.push_back(epollFd);
+    ioThreads.push_back(std::make_unique<std::thread>([&, epollFd]() {
+      runSocketIoThread(epollFd, parsedOutput, processingShards, binaryDumpFiles);
+    }));
+  }
 
-      if (swapBuffer.size() > 0) {
-        // std::cout << "swapBuffer lines to process: " << swapBuffer.size() << std::endl;
-        for (const auto& filenameAndBytes : swapBuffer) {
-          std::string binaryFilename = std::string(kBinaryFileDumpDir) + "/" + filenameAndBytes.first;
-          std::ofstream binaryFileStream;
-          binaryFileStream.open(binaryFilename, std::ios_base::app);
-          binaryFileStream.write(reinterpret_cast<const char*>(filenameAndBytes.second.data()), filenameAndBytes.second.size());
-          binaryFileStream.flush();
-        }
-        // std::cout << "swapBuffer Finished processing lines" << std::endl;
-        swapBuffer = {};
-      }
-      std::this_thread::sleep_for(std::chrono::milliseconds(1));
-    } 
-  }));
+  // Started once the I/O threads are, so it can stop them.  They're stopped first so nothing more is
+  // handed to the shards, then the shards process everything they've been handed, and then what's
+  // been written is flushed.
+  std::thread shutdownThread([&, shutdownSignals]() {
+    int shutdownSignal = 0;
+    sigwait(&shutdownSignals, &shutdownSignal);
+    std::cout << "Shutting down.  Writing outputs." << std::endl;
+    const uint64_t stopCount = 1;
+    if (write(ioStopFd, &stopCount, sizeof(stopCount)) != sizeof(stopCount)) {
+      perror("eventfd write");
+    }
+    for (auto& ioThread : ioThreads) {
+      ioThread->join();
+    }
+    processingShards.printMetrics(std::cout);
+    processingShards.finish();
+    GroupCommitWriter::get().flushAll();
+    binaryDumpFiles.syncAll();
+    std::_Exit(128 + shutdownSignal);
+  });
 
   // sockets can end up reused so we need to use a different id to ensure that the ids are unique.
-  std::atomic<int> nextUniqueClientId = 0;
+  int nextUniqueClientId = 0;
 
   // Accept a connection
   while (true) {
     std::cout << "Checking for a new connection"  << std::endl;
     int new_socket =
-        accept(server_fd, (struct sockaddr *)&address, (socklen_t *)&addrlen);
+        accept4(server_fd, (struct sockaddr *)&address, (socklen_t *)&addrlen, SOCK_NONBLOCK | SOCK_CLOEXEC);
 
     if (new_socket < 0) {
       perror("accept");
@@ -313,99 +800,133 @@ void runAsSocketServer(Processor&& processor) {
       continue;
     }
 
-    threads.push_back(std::make_unique<std::thread>([&, socketID = new_socket]() {
-      int uniqueClientId = nextUniqueClientId++;
-
-      std::string rawSocketFile = std::string(kRawSocketInputDir) + "/" + kSocketRawOutputFile + std::to_string(uniqueClientId) + ".txt";
-      std::ofstream rawoutput;
-      rawoutput.open(rawSocketFile);
+    int uniqueClientId = nextUniqueClientId++;
+    std::string rawSocketFile = std::string(kRawSocketInputDir) + "/" + kSocketRawOutputFile + std::to_string(uniqueClientId) + ".txt";
+    auto connection = std::make_unique<ClientConnection>(new_socket, uniqueClientId, rawSocketFile);
 
-      std::cout << "New connection accepted.  Unique Client ID: [" << uniqueClientId << "] | socket ID: [" 
-      << socketID << "]. " << std::endl;
+    std::cout << "New connection accepted.  Unique Client ID: [" << connection->uniqueClientId << "] | socket ID: ["
+    << new_socket << "]. " << std::endl;
 
-      // extra bytes to add a newline to a read string for the purposes to dumping the line
-      // to raw socket input file.
-      char buffer[1024] = {0};
-      int readChars = 0;
+    // the I/O thread owns the connection from here, and deletes it when it closes.
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+    event.data.ptr = connection.get();
+    if (epoll_ctl(ioEpollFds[connection->uniqueClientId % ioEpollFds.size()], EPOLL_CTL_ADD, new_socket, &event) < 0) {
+      perror("epoll_ctl");
+      close(new_socket);
+      continue;
+    }
+    connection.release();
+  }
+  
+  close(server_fd);
+}
 
-      StreamParser parser;
+void processFile(
+    const std::string& filename,
+    const MakeTreeFunc& makeTree,
+    std::ostream& parsedOutput,
+    std::unique_ptr<std::ostream> processedOutput,
+    std::ostream& validationReport,
+    bool nameInOutputs) {
+  std::cout << "Processing filename: " << filename << std::endl;
+  // each file's process ids start over from 0, so with several files the marker is what tells
+  // which file (and so which process) a line came from.
+  if (nameInOutputs) {
+    validationReport << "[File] | Name: [" << filename << "]" << std::endl;
+    *processedOutput << "[File] | Name: [" << filename << "]" << std::endl;
+  }
 
-      while ((readChars = read(socketID, buffer, 1024)) > 0) { // 0 is eof; closed connection
-        rawoutput.write(buffer, readChars); 
-        std::vector<std::string> stringsOut{};
-        std::vector<std::pair<std::string, std::vector<unsigned char>>> bytesOut{};
+  std::ifstream fileStream(filename);
+  if (!fileStream.is_open()) {
+    std::cerr << "Error opening file: " << std::endl;
+    if (fileStream.bad()) {
+      std::cerr << "Fatal error: badbit is set." << std::endl;
+    }
 
-        parser.parseLine(buffer, readChars, stringsOut, bytesOut);
-        
-        if (!stringsOut.empty()) {
-          std::lock_guard<std::mutex> lock(clientLinesMut);
-          for(auto& line : stringsOut) {
-            clientLines.push_back(std::move(line));
-          }
-        }
+    if (fileStream.fail()) {
+     std::cerr << "Error details: " << strerror(errno) << std::endl;
+    }
 
-        if (!bytesOut.empty()) {
-          std::lock_guard<std::mutex> lock(clientBytesMut);
-          for(auto& filenameAndBytes : bytesOut) {
-            clientBytes.push_back(std::move(filenameAndBytes));
-          }
-        }
-      }
+    return;
+  }
 
-      // TODO: if we add a delimiter to mark the end of the line, we won't need this hack.
-      // Line accumulator likely has leftover data because we always process the previous lines only when we see a delim
-      // marking the start of a new line.  If the leftover ends in a newline, we will assume it's a complete line that
-      // hasn't been processed yet. 
-      size_t headerSize = StreamParser::headerDelimiterSize + 2 * sizeof(uint32_t);
-      if ((parser.accumulatedLine.size() > headerSize) &&
-        (parser.accumulatedLine.find('\n') != std::string::npos)) {
-          std::string lastLine = parser.accumulatedLine.substr(headerSize);
-        std::lock_guard<std::mutex> lock(clientLinesMut);
-        clientLines.push_back(std::move(lastLine));
-      }
+  std::unique_ptr<BehaviorTree> tree = makeTree(&validationReport);
+  Processor processor(std::move(processedOutput), tree.get());
 
-      std::cout << std::endl << "EOF.  Closing connection for Unique Client ID: [" << uniqueClientId << "] | socket ID: [" 
-      << socketID << "]. " << std::endl;
+  std::string inputLine;
+  size_t linesSinceOutput = 0;
+  // File output captures are length prefixed records; anything else is read line by line.
+  while (CAP::RecordFraming::readRecord(fileStream, inputLine)) {
+    parsedOutput << inputLine << '\n';
+    processor.readLine(inputLine);
 
-      rawoutput.flush();
-      rawoutput.close();
-      close(socketID);
-    }));
+    // the output is written as it goes, so it doesn't pile up until the end.
+    if (++linesSinceOutput == kFileOutputWindowLines) {
+      processor.printOutputIfAvailable();
+      linesSinceOutput = 0;
+    }
   }
-  
-  close(server_fd);
+
+  processor.printOutputIfAvailable();
 }
 
-void runAsFileProcessor(Processor&& processor, const std::vector<std::string>& files) {
-  std::ofstream parsedOutput;
-  parsedOutput.open(kParsedRawOutputFile);
+void appendPartFile(const std::string& partFilename, std::ostream& outputStream) {
+  {
+    std::ifstream partStream(partFilename, std::ios::binary);
+    if (partStream.peek() != std::ifstream::traits_type::eof()) {
+      outputStream << partStream.rdbuf();
+    }
+  }
+  std::filesystem::remove(partFilename);
+}
 
-  for (const auto& filename : files) {
-    std::cout << "Processing filename: " << filename << std::endl;
+// Each file is processed on its own, with its own Processor and tree, so they're processed at the
+// same time (files are expected to be separate captures or processes).  The first file writes
+// straight to the session's outputs and the rest to part files; once all of them are done the
+// parts are appended in the order the files were given, so the outputs are the same no matter
+// which file finished first.
+void runAsFileProcessor(const std::vector<std::string>& files, const MakeTreeFunc& makeTree, std::ostream& validationReportOStream) {
+  const bool nameInOutputs = files.size() > 1;
+  auto partFilename = [](const char* filename, size_t fileIdx) {
+    return std::string(filename) + kPartFileSuffix + std::to_string(fileIdx);
+  };
 
-    std::ifstream fileStream(filename);
-    if (!fileStream.is_open()) {
-      std::cerr << "Error opening file: " << std::endl;
-      if (fileStream.bad()) {
-        std::cerr << "Fatal error: badbit is set." << std::endl;
+  std::atomic<size_t> nextFileIdx = 0;
+  auto processFiles = [&]() {
+    for (size_t fileIdx = nextFileIdx++; fileIdx < files.size(); fileIdx = nextFileIdx++) {
+      if (fileIdx == 0) {
+        GroupCommitOStream parsedOutput(kParsedRawOutputFile);
+        processFile(files[fileIdx], makeTree,
+          parsedOutput, std::make_unique<GroupCommitOStream>(kProcessedOutputFile),
+          validationReportOStream, nameInOutputs);
+      } else {
+        GroupCommitOStream parsedOutputPart(partFilename(kParsedRawOutputFile, fileIdx));
+        GroupCommitOStream validationReportPart(partFilename(kValidatorReportFile, fileIdx));
+        processFile(files[fileIdx], makeTree,
+          parsedOutputPart, std::make_unique<GroupCommitOStream>(partFilename(kProcessedOutputFile, fileIdx)),
+          validationReportPart, nameInOutputs);
       }
- 
-      if (fileStream.fail()) {
-       std::cerr << "Error details: " << strerror(errno) << std::endl;
-      }
-
-      continue;
     }
+  };
 
-    std::string inputLine;
-    while (std::getline(fileStream, inputLine)) {
-      parsedOutput << inputLine << std::endl;
-      parsedOutput.flush();
-      processor.readLine(inputLine);
-    }
+  const size_t threadCount = std::min<size_t>(files.size(), std::max(1u, std::thread::hardware_concurrency()));
+  std::vector<std::thread> threads;
+  for (size_t threadIdx = 1; threadIdx < threadCount; ++threadIdx) {
+    threads.emplace_back(processFiles);
+  }
+  processFiles();
+  for (auto& thread : threads) {
+    thread.join();
   }
 
-  processor.printOutputIfAvailable();
+  GroupCommitOStream parsedOutput(kParsedRawOutputFile, GroupCommitFile::Append);
+  GroupCommitOStream processedOutput(kProcessedOutputFile, GroupCommitFile::Append);
+  for (size_t fileIdx = 1; fileIdx < files.size(); ++fileIdx) {
+    appendPartFile(partFilename(kParsedRawOutputFile, fileIdx), parsedOutput);
+    appendPartFile(partFilename(kProcessedOutputFile, fileIdx), processedOutput);
+    appendPartFile(partFilename(kValidatorReportFile, fileIdx), validationReportOStream);
+  }
 }
 
 } // namespace
@@ -428,34 +949,33 @@ int main(int argc, const char* argv[]) {
   //   std::cout << "argv[" << i << "]: " << argv[i] << std::endl;
   // }
 
-  std::ofstream validationReportOStream;
-  validationReportOStream.open(kValidatorReportFile);
+  GroupCommitOStream validationReportOStream(kValidatorReportFile);
 
-  std::unique_ptr<BehaviorTree> tree = nullptr;
 #define USE_TREE_EXAMPLE 1
+  MakeTreeFunc makeTree = [](std::ostream* validationOStream) -> std::unique_ptr<BehaviorTree> {
 #if USE_TREE_EXAMPLE
-  // tree should be changed to be loaded in through json or some other means.
-  tree = std::make_unique<BehaviorTree>(makeTreeExample());
-  tree->state.validationOStream = &validationReportOStream;
+    // tree should be changed to be loaded in through json or some other means.
+    std::unique_ptr<BehaviorTree> tree = std::make_unique<BehaviorTree>(makeTreeExample());
+    tree->state.validationOStream = validationOStream;
+    return tree;
 #else
+    return nullptr;
+#endif
+  };
+#if !USE_TREE_EXAMPLE
   validationReportOStream << "Nothing to report.  No validation tree loaded." << std::endl;
 #endif
 
-  std::ofstream processedOStream;
-  processedOStream.open(kProcessedOutputFile);
-
-  Processor processor(std::move(processedOStream), tree.get());
-
   if (argc > 1) {
     std::cout << "Mode: FILE processing mode" << std::endl;
     std::vector<std::string> inputFileNames;
     for (int i = 1; i < argc; i++) {
       inputFileNames.push_back(argv[i]);
     }
-    runAsFileProcessor(std::move(processor), inputFileNames);
+    runAsFileProcessor(inputFileNames, makeTree, validationReportOStream);
   } else {
     std::cout << "Mode: SOCKET server mode" << std::endl;
-    runAsSocketServer(std::move(processor));
+    runAsSocketServer(makeTree, validationReportOStream);
   }
 
   return 0;